@@ -63,6 +63,7 @@
 #include "libavutil/time.h"
 #include "libavutil/thread.h"
 #include "libavutil/threadmessage.h"
+#include "libavutil/trace.h"
 #include "libavcodec/mathops.h"
 #include "libavformat/os_support.h"
 
@@ -523,7 +524,9 @@ static void ffmpeg_cleanup(int ret)
 
     for (i = 0; i < nb_filtergraphs; i++) {
         FilterGraph *fg = filtergraphs[i];
+        print_filtergraph_stats(fg);
         avfilter_graph_free(&fg->graph);
+        avfilter_formats_cache_free(&fg->formats_cache);
         for (j = 0; j < fg->nb_inputs; j++) {
             InputFilter *ifilter = fg->inputs[j];
             struct InputStream *ist = ifilter->ist;
@@ -651,6 +654,18 @@ static void ffmpeg_cleanup(int ret)
     }
     av_freep(&vstats_filename);
 
+    if (trace_filename) {
+        int err;
+
+        av_trace_stop();
+        err = av_trace_write_json(trace_filename);
+        if (err < 0)
+            av_log(NULL, AV_LOG_ERROR, "Error writing trace file %s: %s\n",
+                   trace_filename, av_err2str(err));
+        av_trace_free();
+        av_freep(&trace_filename);
+    }
+
     av_freep(&input_streams);
     av_freep(&input_files);
     av_freep(&output_streams);
@@ -1686,6 +1701,17 @@ static void print_final_stats(int64_t total_size)
         av_log(NULL, AV_LOG_VERBOSE, "  Total: %"PRIu64" packets (%"PRIu64" bytes) muxed\n",
                total_packets, total_size);
     }
+
+    for (i = 0; i < nb_filtergraphs; i++) {
+        FilterGraph *fg = filtergraphs[i];
+
+        if (!fg->nb_reinits)
+            continue;
+        av_log(NULL, AV_LOG_VERBOSE, "Filtergraph #%d: %d reconfigurations (%d in place), "
+               "stalled %.3f ms (max %.3f ms)\n", fg->index, fg->nb_reinits,
+               fg->nb_reinits_in_place, fg->reinit_time / 1000.0,
+               fg->reinit_time_max / 1000.0);
+    }
     if(video_size + data_size + audio_size + subtitle_size + extra_size == 0){
         av_log(NULL, AV_LOG_WARNING, "Output file is empty, nothing was encoded ");
         if (pass1_used) {
@@ -2176,7 +2202,8 @@ static int ifilter_has_all_input_formats(FilterGraph *fg)
 static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame)
 {
     FilterGraph *fg = ifilter->graph;
-    int need_reinit, ret, i;
+    int need_reinit, reinit, in_place, ret, i;
+    int64_t stall;
 
     /* determine if the parameters for this input changed */
     need_reinit = ifilter->format != frame->format;
@@ -2233,11 +2260,24 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame)
             return ret;
         }
 
-        ret = configure_filtergraph(fg);
+        stall    = av_gettime_relative();
+        reinit   = !!fg->graph;
+        in_place = reconfigure_filtergraph(fg, ifilter) >= 0;
+        ret = in_place ? 0 : configure_filtergraph(fg);
         if (ret < 0) {
             av_log(NULL, AV_LOG_ERROR, "Error reinitializing filters!\n");
             return ret;
         }
+
+        if (reinit) {
+            stall = av_gettime_relative() - stall;
+            fg->nb_reinits++;
+            fg->nb_reinits_in_place += in_place;
+            fg->reinit_time     += stall;
+            fg->reinit_time_max  = FFMAX(fg->reinit_time_max, stall);
+            av_log(NULL, AV_LOG_VERBOSE, "Filtergraph #%d %s in %"PRId64" us\n",
+                   fg->index, in_place ? "reconfigured in place" : "rebuilt", stall);
+        }
     }
 
     ret = av_buffersrc_add_frame_flags(ifilter->filter, frame, AV_BUFFERSRC_FLAG_PUSH);
@@ -4085,6 +4125,8 @@ static void *input_thread(void *arg)
     unsigned flags = f->non_blocking ? AV_THREAD_MESSAGE_NONBLOCK : 0;
     int ret = 0;
 
+    av_trace_set_thread_name("input");
+
     while (1) {
         AVPacket pkt;
         ret = av_read_frame(f->ctx, &pkt);
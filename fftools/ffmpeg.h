@@ -290,6 +290,14 @@ typedef struct FilterGraph {
 
     AVFilterGraph *graph;
     int reconfiguration;
+    /* formats negotiated by the previous configuration of the graph */
+    AVFilterFormatsCache *formats_cache;
+
+    /* reconfigurations after a change of the input parameters */
+    int     nb_reinits;
+    int     nb_reinits_in_place;
+    int64_t reinit_time;        ///< total time the graph was stalled, in microseconds
+    int64_t reinit_time_max;
 
     InputFilter   **inputs;
     int          nb_inputs;
@@ -595,6 +603,7 @@ extern FilterGraph **filtergraphs;
 extern int        nb_filtergraphs;
 
 extern char *vstats_filename;
+extern char *trace_filename;
 extern char *sdp_filename;
 
 extern float audio_drift_threshold;
@@ -626,6 +635,7 @@ extern float max_error_rate;
 extern char *videotoolbox_pixfmt;
 
 extern int filter_nbthreads;
+extern int filter_stats;
 extern int filter_complex_nbthreads;
 extern int vstats_version;
 extern int auto_conversion_filters;
@@ -651,8 +661,10 @@ void assert_avoptions(AVDictionary *m);
 int guess_input_channel_layout(InputStream *ist);
 
 int configure_filtergraph(FilterGraph *fg);
+int reconfigure_filtergraph(FilterGraph *fg, InputFilter *ifilter);
 void check_filter_outputs(void);
 int filtergraph_is_simple(FilterGraph *fg);
+void print_filtergraph_stats(FilterGraph *fg);
 int init_simple_filtergraph(InputStream *ist, OutputStream *ost);
 int init_complex_filtergraph(FilterGraph *fg);
 
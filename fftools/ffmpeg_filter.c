@@ -970,9 +970,52 @@ static int configure_input_filter(FilterGraph *fg, InputFilter *ifilter,
     }
 }
 
+typedef struct FilterStats {
+    const AVFilterContext *filter;
+    AVFilterStats stats;
+} FilterStats;
+
+static int cmp_filter_stats(const void *a, const void *b)
+{
+    const FilterStats *sa = a, *sb = b;
+    return FFDIFFSIGN(sb->stats.wall_time, sa->stats.wall_time);
+}
+
+void print_filtergraph_stats(FilterGraph *fg)
+{
+    AVFilterGraph *graph = fg->graph;
+    FilterStats *fs;
+    int i;
+
+    if (!graph || !graph->stats || !graph->nb_filters)
+        return;
+
+    fs = av_malloc_array(graph->nb_filters, sizeof(*fs));
+    if (!fs)
+        return;
+    for (i = 0; i < graph->nb_filters; i++) {
+        fs[i].filter = graph->filters[i];
+        avfilter_get_stats(graph->filters[i], &fs[i].stats);
+    }
+    qsort(fs, graph->nb_filters, sizeof(*fs), cmp_filter_stats);
+
+    av_log(NULL, AV_LOG_INFO, "Filtergraph #%d statistics:\n", fg->index);
+    av_log(NULL, AV_LOG_INFO, "%10s %10s %8s %10s %10s %10s  %s\n",
+           "wall ms", "cpu ms", "runs", "frames in", "frames out", "max queued", "filter");
+    for (i = 0; i < graph->nb_filters; i++) {
+        const AVFilterStats *st = &fs[i].stats;
+        av_log(NULL, AV_LOG_INFO, "%10.1f %10.1f %8"PRId64" %10"PRId64" %10"PRId64" %10"PRId64"  %s (%s)\n",
+               st->wall_time / 1000.0, st->cpu_time / 1000.0, st->nb_runs,
+               st->frames_in, st->frames_out, st->max_queued,
+               fs[i].filter->name, fs[i].filter->filter->name);
+    }
+    av_free(fs);
+}
+
 static void cleanup_filtergraph(FilterGraph *fg)
 {
     int i;
+    print_filtergraph_stats(fg);
     for (i = 0; i < fg->nb_outputs; i++)
         fg->outputs[i]->filter = (AVFilterContext *)NULL;
     for (i = 0; i < fg->nb_inputs; i++)
@@ -988,8 +1031,12 @@ int configure_filtergraph(FilterGraph *fg)
                                       fg->graph_desc;
 
     cleanup_filtergraph(fg);
+    if (!fg->formats_cache && !(fg->formats_cache = avfilter_formats_cache_alloc()))
+        return AVERROR(ENOMEM);
     if (!(fg->graph = avfilter_graph_alloc()))
         return AVERROR(ENOMEM);
+    fg->graph->stats = filter_stats;
+    fg->graph->formats_cache = fg->formats_cache;
 
     if (simple) {
         OutputStream *ost = fg->outputs[0]->ost;
@@ -1154,6 +1201,41 @@ fail:
     return ret;
 }
 
+int reconfigure_filtergraph(FilterGraph *fg, InputFilter *ifilter)
+{
+    AVFilterContext *src = ifilter->filter;
+    AVRational sar = ifilter->sample_aspect_ratio;
+    int ret, i;
+
+    /* only a change of the frame size can be applied in place */
+    if (!fg->graph || ifilter->type != AVMEDIA_TYPE_VIDEO ||
+        ifilter->format != src->outputs[0]->format || ifilter->hw_frames_ctx)
+        return AVERROR(ENOSYS);
+
+    if (!sar.den)
+        sar = (AVRational){0,1};
+    if ((ret = av_opt_set_image_size(src, "video_size", ifilter->width, ifilter->height,
+                                     AV_OPT_SEARCH_CHILDREN)) < 0 ||
+        (ret = av_opt_set_q(src, "pixel_aspect", sar, AV_OPT_SEARCH_CHILDREN)) < 0)
+        return ret;
+
+    if ((ret = avfilter_graph_reconfigure(fg->graph, src)) < 0)
+        return ret;
+
+    /* the encoders cannot take frames of another size */
+    for (i = 0; i < fg->nb_outputs; i++) {
+        OutputFilter *ofilter = fg->outputs[i];
+        AVFilterContext *sink = ofilter->filter;
+
+        if (av_buffersink_get_type(sink) == AVMEDIA_TYPE_VIDEO &&
+            (ofilter->width  != av_buffersink_get_w(sink) ||
+             ofilter->height != av_buffersink_get_h(sink)))
+            return AVERROR(ENOSYS);
+    }
+
+    return 0;
+}
+
 int ifilter_parameters_from_frame(InputFilter *ifilter, const AVFrame *frame)
 {
     av_buffer_unref(&ifilter->hw_frames_ctx);
@@ -41,6 +41,7 @@
 #include "libavutil/parseutils.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/pixfmt.h"
+#include "libavutil/trace.h"
 
 #define DEFAULT_PASS_LOGFILENAME_PREFIX "ffmpeg2pass"
 
@@ -145,6 +146,7 @@ const HWAccel hwaccels[] = {
 HWDevice *filter_hw_device;
 
 char *vstats_filename;
+char *trace_filename;
 char *sdp_filename;
 
 float audio_drift_threshold = 0.1;
@@ -172,6 +174,7 @@ int stdin_interaction = 1;
 int frame_bits_per_raw_sample = 0;
 float max_error_rate  = 2.0/3;
 int filter_nbthreads = 0;
+int filter_stats     = 0;
 int filter_complex_nbthreads = 0;
 int vstats_version = 2;
 int auto_conversion_filters = 1;
@@ -2951,6 +2954,24 @@ static int opt_vstats_file(void *optctx, const char *opt, const char *arg)
     return 0;
 }
 
+static int opt_trace_file(void *optctx, const char *opt, const char *arg)
+{
+    int ret;
+
+    av_free(trace_filename);
+    trace_filename = av_strdup(arg);
+    if (!trace_filename)
+        return AVERROR(ENOMEM);
+
+    ret = av_trace_start(0);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Error starting the trace: %s\n", av_err2str(ret));
+        return ret;
+    }
+    av_trace_set_thread_name("main");
+    return 0;
+}
+
 static int opt_vstats(void *optctx, const char *opt, const char *arg)
 {
     char filename[40];
@@ -3496,6 +3517,8 @@ const OptionDef options[] = {
         "add timings for benchmarking" },
     { "benchmark_all",  OPT_BOOL | OPT_EXPERT,                       { &do_benchmark_all },
       "add timings for each task" },
+    { "trace_file",     HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_trace_file },
+      "write a timeline of the processing steps to file in Chrome trace format", "filename" },
     { "progress",       HAS_ARG | OPT_EXPERT,                        { .func_arg = opt_progress },
       "write program-readable progress information", "url" },
     { "stdin",          OPT_BOOL | OPT_EXPERT,                       { &stdin_interaction },
@@ -3565,6 +3588,8 @@ const OptionDef options[] = {
         "set stream filtergraph", "filter_graph" },
     { "filter_threads",  HAS_ARG | OPT_INT,                          { &filter_nbthreads },
         "number of non-complex filter threads" },
+    { "filter_stats",   OPT_BOOL | OPT_EXPERT,                       { &filter_stats },
+        "print the time spent in each filter" },
     { "filter_script",  HAS_ARG | OPT_STRING | OPT_SPEC | OPT_OUTPUT, { .off = OFFSET(filter_scripts) },
         "read stream filtergraph description from a file", "filename" },
     { "reinit_filter",  HAS_ARG | OPT_INT | OPT_SPEC | OPT_INPUT,    { .off = OFFSET(reinit_filters) },
@@ -25,6 +25,7 @@
  */
 
 #include "config.h"
+#include "libavutil/name_table.h"
 #include "libavutil/thread.h"
 #include "avcodec.h"
 #include "version.h"
@@ -916,61 +917,106 @@ static enum AVCodecID remap_deprecated_codec_id(enum AVCodecID id)
     }
 }
 
-static AVCodec *find_codec(enum AVCodecID id, int (*x)(const AVCodec *))
+/* Lookup tables for the encoders and the decoders, built on first use.
+ * They are open addressing tables of indices in codec_list plus one. */
+#define CODEC_HASH_SIZE (2 * FF_ARRAY_ELEMS(codec_list))
+
+typedef struct CodecHash {
+    uint16_t by_name[CODEC_HASH_SIZE];
+    uint16_t by_id[CODEC_HASH_SIZE];
+} CodecHash;
+
+static CodecHash encoder_hash, decoder_hash;
+static AVOnce codec_hash_init = AV_ONCE_INIT;
+
+static int match_codec_name(const char *name, int idx)
 {
-    const AVCodec *p, *experimental = NULL;
-    void *i = 0;
+    return !strcmp(codec_list[idx]->name, name);
+}
+
+static unsigned hash_id(enum AVCodecID id)
+{
+    return (id * 2654435761U) % CODEC_HASH_SIZE;
+}
+
+static void add_codec(CodecHash *h, int idx)
+{
+    const AVCodec *c = codec_list[idx];
+    unsigned pos;
+
+    /* by name, the first registered codec wins */
+    avpriv_name_table_add(h->by_name, CODEC_HASH_SIZE, c->name, 0, idx,
+                          match_codec_name);
+
+    /* by id, the first non experimental codec wins over the experimental ones */
+    for (pos = hash_id(c->id); h->by_id[pos]; pos = (pos + 1) % CODEC_HASH_SIZE)
+        if (codec_list[h->by_id[pos] - 1]->id == c->id)
+            break;
+    if (!h->by_id[pos] ||
+        (codec_list[h->by_id[pos] - 1]->capabilities & AV_CODEC_CAP_EXPERIMENTAL &&
+         !(c->capabilities & AV_CODEC_CAP_EXPERIMENTAL)))
+        h->by_id[pos] = idx + 1;
+}
+
+static void init_codec_hash(void)
+{
+    for (int i = 0; codec_list[i]; i++) {
+        if (av_codec_is_encoder(codec_list[i]))
+            add_codec(&encoder_hash, i);
+        if (av_codec_is_decoder(codec_list[i]))
+            add_codec(&decoder_hash, i);
+    }
+}
+
+static AVCodec *find_codec(enum AVCodecID id, const CodecHash *h)
+{
+    unsigned pos;
 
     id = remap_deprecated_codec_id(id);
 
-    while ((p = av_codec_iterate(&i))) {
-        if (!x(p))
-            continue;
-        if (p->id == id) {
-            if (p->capabilities & AV_CODEC_CAP_EXPERIMENTAL && !experimental) {
-                experimental = p;
-            } else
-                return (AVCodec*)p;
-        }
+    ff_thread_once(&av_codec_static_init, av_codec_init_static);
+    ff_thread_once(&codec_hash_init, init_codec_hash);
+
+    for (pos = hash_id(id); h->by_id[pos]; pos = (pos + 1) % CODEC_HASH_SIZE) {
+        const AVCodec *p = codec_list[h->by_id[pos] - 1];
+        if (p->id == id)
+            return (AVCodec*)p;
     }
 
-    return (AVCodec*)experimental;
+    return NULL;
 }
 
 AVCodec *avcodec_find_encoder(enum AVCodecID id)
 {
-    return find_codec(id, av_codec_is_encoder);
+    return find_codec(id, &encoder_hash);
 }
 
 AVCodec *avcodec_find_decoder(enum AVCodecID id)
 {
-    return find_codec(id, av_codec_is_decoder);
+    return find_codec(id, &decoder_hash);
 }
 
-static AVCodec *find_codec_by_name(const char *name, int (*x)(const AVCodec *))
+static AVCodec *find_codec_by_name(const char *name, const CodecHash *h)
 {
-    void *i = 0;
-    const AVCodec *p;
+    int idx;
 
     if (!name)
         return NULL;
 
-    while ((p = av_codec_iterate(&i))) {
-        if (!x(p))
-            continue;
-        if (strcmp(name, p->name) == 0)
-            return (AVCodec*)p;
-    }
+    ff_thread_once(&av_codec_static_init, av_codec_init_static);
+    ff_thread_once(&codec_hash_init, init_codec_hash);
 
-    return NULL;
+    idx = avpriv_name_table_find(h->by_name, CODEC_HASH_SIZE, name, 0,
+                                 match_codec_name);
+    return idx >= 0 ? (AVCodec*)codec_list[idx] : NULL;
 }
 
 AVCodec *avcodec_find_encoder_by_name(const char *name)
 {
-    return find_codec_by_name(name, av_codec_is_encoder);
+    return find_codec_by_name(name, &encoder_hash);
 }
 
 AVCodec *avcodec_find_decoder_by_name(const char *name)
 {
-    return find_codec_by_name(name, av_codec_is_decoder);
+    return find_codec_by_name(name, &decoder_hash);
 }
@@ -2335,6 +2335,21 @@ typedef struct AVCodecContext {
      * - encoding: set by user
      */
     int export_side_data;
+
+    /**
+     * Maximum number of frames of output delay frame threading may add.
+     * With a non-negative value, a decoded frame is also returned as soon
+     * as its own decoding finished instead of waiting for the pipeline of
+     * frame threads to fill up: avcodec_receive_frame() returns the frames
+     * finished since the last call even when no new packet was sent, so a
+     * caller waiting for input can poll it. Which call returns a given
+     * frame then depends on the timing of the threads. -1 means
+     * thread_count - 1 frames.
+     *
+     * - decoding: Set by user.
+     * - encoding: unused
+     */
+    int frame_thread_delay;
 } AVCodecContext;
 
 #if FF_API_CODEC_GET_SET
@@ -37,6 +37,7 @@
 #include "libavutil/internal.h"
 #include "libavutil/intmath.h"
 #include "libavutil/opt.h"
+#include "libavutil/trace.h"
 
 #include "avcodec.h"
 #include "bytestream.h"
@@ -286,6 +287,19 @@ static inline int decode_simple_internal(AVCodecContext *avctx, AVFrame *frame,
     if (!pkt->data && !avci->draining) {
         av_packet_unref(pkt);
         ret = ff_decode_get_packet(avctx, pkt);
+        if (ret == AVERROR(EAGAIN) && HAVE_THREADS &&
+            avctx->active_thread_type & FF_THREAD_FRAME &&
+            avctx->frame_thread_delay >= 0) {
+            /* no new packet, but a frame may have been decoded meanwhile */
+            ret = ff_thread_get_finished_frame(avctx, frame, &got_frame);
+            if (ret < 0)
+                return ret;
+            if (!got_frame)
+                return AVERROR(EAGAIN);
+            if (frame->flags & AV_FRAME_FLAG_DISCARD)
+                av_frame_unref(frame);
+            return 0;
+        }
         if (ret < 0 && ret != AVERROR_EOF)
             return ret;
     }
@@ -519,12 +533,14 @@ static int decode_receive_frame_internal(AVCodecContext *avctx, AVFrame *frame)
 
     av_assert0(!frame->buf[0]);
 
+    av_trace_begin("decode", avctx->codec->name);
     if (avctx->codec->receive_frame) {
         ret = avctx->codec->receive_frame(avctx, frame);
         if (ret != AVERROR(EAGAIN))
             av_packet_unref(avci->last_pkt_props);
     } else
         ret = decode_simple_receive_frame(avctx, frame);
+    av_trace_end();
 
     if (ret == AVERROR_EOF)
         avci->draining_done = 1;
@@ -24,6 +24,7 @@
 #include "libavutil/imgutils.h"
 #include "libavutil/internal.h"
 #include "libavutil/samplefmt.h"
+#include "libavutil/trace.h"
 
 #include "avcodec.h"
 #include "encode.h"
@@ -244,6 +245,7 @@ static int encode_receive_packet_internal(AVCodecContext *avctx, AVPacket *avpkt
             return AVERROR(EINVAL);
     }
 
+    av_trace_begin("encode", avctx->codec->name);
     if (avctx->codec->receive_packet) {
         ret = avctx->codec->receive_packet(avctx, avpkt);
         if (ret < 0)
@@ -254,6 +256,7 @@ static int encode_receive_packet_internal(AVCodecContext *avctx, AVPacket *avpkt
             av_assert0(!avpkt->data || avpkt->buf);
     } else
         ret = encode_simple_receive_packet(avctx, avpkt);
+    av_trace_end();
 
     if (ret == AVERROR_EOF)
         avci->draining_done = 1;
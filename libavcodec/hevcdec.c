@@ -2501,10 +2501,12 @@ static int hls_decode_entry(AVCodecContext *avctxt, void *isFilterThread)
 
         ctb_addr_ts++;
         ff_hevc_save_states(s, ctb_addr_ts);
-        ff_hevc_hls_filters(s, x_ctb, y_ctb, ctb_size);
+        if (!s->deferred_filter)
+            ff_hevc_hls_filters(s, x_ctb, y_ctb, ctb_size);
     }
 
-    if (x_ctb + ctb_size >= s->ps.sps->width &&
+    if (!s->deferred_filter &&
+        x_ctb + ctb_size >= s->ps.sps->width &&
         y_ctb + ctb_size >= s->ps.sps->height)
         ff_hevc_hls_filter(s, x_ctb, y_ctb, ctb_size);
 
@@ -2707,6 +2709,89 @@ error:
     return res;
 }
 
+static int hls_filter_entry_wpp(AVCodecContext *avctxt, void *input_ctb_row, int job, int self_id)
+{
+    HEVCContext *s1 = avctxt->priv_data, *s;
+    int ctb_size    = 1 << s1->ps.sps->log2_ctb_size;
+    int *ctb_row_p  = input_ctb_row;
+    int ctb_row     = ctb_row_p[job];
+    int y_ctb       = ctb_row << s1->ps.sps->log2_ctb_size;
+    int thread      = ctb_row % s1->threads_number;
+    int ctb_addr_rs = ctb_row * s1->ps.sps->ctb_width;
+    int x_ctb;
+
+    s = s1->sList[self_id];
+
+    /* Same dependency as WPP decoding: row N filters the CTBs of row N - 1
+     * and must stay SHIFT_CTB_WPP CTBs behind the row above it.
+     * As in the serial path, only the CTBs decoded in this picture start
+     * filters, so missing slices and decoding errors leave the same
+     * areas unfiltered. */
+    for (x_ctb = 0; x_ctb < s->ps.sps->width; x_ctb += ctb_size, ctb_addr_rs++) {
+        ff_thread_await_progress2(s->avctx, ctb_row, thread, SHIFT_CTB_WPP);
+        if (s->tab_slice_address[ctb_addr_rs] != -1)
+            ff_hevc_hls_filters(s, x_ctb, y_ctb, ctb_size);
+        ff_thread_report_progress2(s->avctx, ctb_row, thread, 1);
+    }
+
+    if (y_ctb + ctb_size >= s->ps.sps->height &&
+        s->tab_slice_address[ctb_addr_rs - 1] != -1)
+        ff_hevc_hls_filter(s, x_ctb - ctb_size, y_ctb, ctb_size);
+    ff_thread_report_progress2(s->avctx, ctb_row, thread, SHIFT_CTB_WPP);
+
+    return 0;
+}
+
+/**
+ * Run deblocking and SAO over the whole reconstructed picture, with the CTB
+ * rows distributed over the slice threads.
+ */
+static int hls_filter_frame_wpp(HEVCContext *s)
+{
+    int ctb_height = s->ps.sps->ctb_height;
+    int *ret = av_malloc_array(ctb_height, sizeof(int));
+    int *arg = av_malloc_array(ctb_height, sizeof(int));
+    int i, res = 0;
+
+    if (!ret || !arg) {
+        res = AVERROR(ENOMEM);
+        goto error;
+    }
+
+    res = ff_alloc_entries(s->avctx, ctb_height);
+    if (res < 0)
+        goto error;
+
+    for (i = 1; i < s->threads_number; i++) {
+        if (!s->sList[i] || !s->HEVClcList[i]) {
+            av_freep(&s->sList[i]);
+            av_freep(&s->HEVClcList[i]);
+            s->sList[i] = av_malloc(sizeof(HEVCContext));
+            s->HEVClcList[i] = av_mallocz(sizeof(HEVCLocalContext));
+            if (!s->sList[i] || !s->HEVClcList[i]) {
+                res = AVERROR(ENOMEM);
+                goto error;
+            }
+        }
+        memcpy(s->sList[i], s, sizeof(HEVCContext));
+        s->sList[i]->HEVClc = s->HEVClcList[i];
+    }
+
+    ff_reset_entries(s->avctx);
+
+    for (i = 0; i < ctb_height; i++) {
+        arg[i] = i;
+        ret[i] = 0;
+    }
+
+    s->avctx->execute2(s->avctx, hls_filter_entry_wpp, arg, ret, ctb_height);
+
+error:
+    av_free(ret);
+    av_free(arg);
+    return res;
+}
+
 static int set_side_data(HEVCContext *s)
 {
     AVFrame *out = s->ref->frame;
@@ -2910,6 +2995,14 @@ static int hevc_frame_start(HEVCContext *s)
     s->is_decoded        = 0;
     s->first_nal_type    = s->nal_unit_type;
 
+    /* Without entry points the CTBs of a picture can only be parsed
+     * serially, but the in-loop filters can still be spread over the
+     * slice threads once reconstruction is done. */
+    s->deferred_filter   = !s->avctx->hwaccel && s->threads_number > 1 &&
+                           !s->ps.pps->entropy_coding_sync_enabled_flag &&
+                           !s->ps.pps->tiles_enabled_flag &&
+                           s->avctx->skip_loop_filter < AVDISCARD_BIDIR;
+
     s->no_rasl_output_flag = IS_IDR(s) || IS_BLA(s) || (s->nal_unit_type == HEVC_NAL_CRA_NUT && s->last_eos);
 
     if (s->ps.pps->tiles_enabled_flag)
@@ -3193,6 +3286,11 @@ static int decode_nal_units(HEVCContext *s, const uint8_t *buf, int length)
     }
 
 fail:
+    if (s->ref && s->deferred_filter) {
+        int err = hls_filter_frame_wpp(s);
+        if (err < 0 && ret >= 0)
+            ret = err;
+    }
     if (s->ref && s->threads_type == FF_THREAD_FRAME)
         ff_thread_report_progress(&s->ref->tf, INT_MAX, 0);
 
@@ -476,6 +476,9 @@ typedef struct HEVCContext {
 
     uint8_t             threads_type;
     uint8_t             threads_number;
+    /* in-loop filters run as a CTB row wavefront once the whole
+     * picture has been reconstructed, instead of lagging the CTB decode */
+    uint8_t             deferred_filter;
 
     int                 width;
     int                 height;
@@ -356,7 +356,7 @@ static int alloc_picture(MpegEncContext *s, Picture *pic)
                             &s->linesize, &s->uvlinesize);
 }
 
-static int init_duplicate_context(MpegEncContext *s)
+int ff_mpv_init_duplicate_context(MpegEncContext *s)
 {
     int y_size = s->b8_stride * (2 * s->mb_height + 1);
     int c_size = s->mb_stride * (s->mb_height + 1);
@@ -413,7 +413,7 @@ static int init_duplicate_context(MpegEncContext *s)
     return 0;
 }
 
-static void free_duplicate_context(MpegEncContext *s)
+void ff_mpv_free_duplicate_context(MpegEncContext *s)
 {
     if (!s)
         return;
@@ -958,7 +958,7 @@ av_cold int ff_mpv_common_init(MpegEncContext *s)
                 if (!s->thread_context[i])
                     return AVERROR(ENOMEM);
             }
-            if ((ret = init_duplicate_context(s->thread_context[i])) < 0)
+            if ((ret = ff_mpv_init_duplicate_context(s->thread_context[i])) < 0)
                 return ret;
             s->thread_context[i]->start_mb_y =
                 (s->mb_height * (i) + nb_slices / 2) / nb_slices;
@@ -966,7 +966,7 @@ av_cold int ff_mpv_common_init(MpegEncContext *s)
                 (s->mb_height * (i + 1) + nb_slices / 2) / nb_slices;
         }
     } else {
-        if ((ret = init_duplicate_context(s)) < 0)
+        if ((ret = ff_mpv_init_duplicate_context(s)) < 0)
             return ret;
         s->start_mb_y = 0;
         s->end_mb_y   = s->mb_height;
@@ -1040,13 +1040,13 @@ int ff_mpv_common_frame_size_change(MpegEncContext *s)
 
     if (s->slice_context_count > 1) {
         for (i = 0; i < s->slice_context_count; i++) {
-            free_duplicate_context(s->thread_context[i]);
+            ff_mpv_free_duplicate_context(s->thread_context[i]);
         }
         for (i = 1; i < s->slice_context_count; i++) {
             av_freep(&s->thread_context[i]);
         }
     } else
-        free_duplicate_context(s);
+        ff_mpv_free_duplicate_context(s);
 
     free_context_frame(s);
 
@@ -1085,7 +1085,7 @@ int ff_mpv_common_frame_size_change(MpegEncContext *s)
                         return AVERROR(ENOMEM);
                     }
                 }
-                if ((err = init_duplicate_context(s->thread_context[i])) < 0)
+                if ((err = ff_mpv_init_duplicate_context(s->thread_context[i])) < 0)
                     return err;
                 s->thread_context[i]->start_mb_y =
                     (s->mb_height * (i) + nb_slices / 2) / nb_slices;
@@ -1093,7 +1093,7 @@ int ff_mpv_common_frame_size_change(MpegEncContext *s)
                     (s->mb_height * (i + 1) + nb_slices / 2) / nb_slices;
             }
         } else {
-            err = init_duplicate_context(s);
+            err = ff_mpv_init_duplicate_context(s);
             if (err < 0)
                 return err;
             s->start_mb_y = 0;
@@ -1115,13 +1115,13 @@ void ff_mpv_common_end(MpegEncContext *s)
 
     if (s->slice_context_count > 1) {
         for (i = 0; i < s->slice_context_count; i++) {
-            free_duplicate_context(s->thread_context[i]);
+            ff_mpv_free_duplicate_context(s->thread_context[i]);
         }
         for (i = 1; i < s->slice_context_count; i++) {
             av_freep(&s->thread_context[i]);
         }
         s->slice_context_count = 1;
-    } else free_duplicate_context(s);
+    } else ff_mpv_free_duplicate_context(s);
 
     av_freep(&s->parse_context.buffer);
     s->parse_context.buffer_size = 0;
@@ -154,6 +154,8 @@ typedef struct MpegEncContext {
     int end_mb_y;              ///< end   mb_y of this thread (so current thread should process start_mb_y <= row < end_mb_y)
     struct MpegEncContext *thread_context[MAX_THREADS];
     int slice_context_count;   ///< number of used thread_contexts
+    struct MpegEncContext *me_row_context[MAX_THREADS]; ///< per thread contexts for row parallel motion estimation
+    int me_row_context_count;  ///< number of used me_row_contexts, 0 if motion estimation runs per slice
 
     /**
      * copy of the previous picture structure.
@@ -727,6 +729,8 @@ int ff_mpv_export_qp_table(MpegEncContext *s, AVFrame *f, Picture *p, int qp_typ
 
 void ff_write_quant_matrix(PutBitContext *pb, uint16_t *matrix);
 
+int ff_mpv_init_duplicate_context(MpegEncContext *s);
+void ff_mpv_free_duplicate_context(MpegEncContext *s);
 int ff_update_duplicate_context(MpegEncContext *dst, MpegEncContext *src);
 int ff_mpeg_update_thread_context(AVCodecContext *dst, const AVCodecContext *src);
 void ff_set_qscale(MpegEncContext * s, int qscale);
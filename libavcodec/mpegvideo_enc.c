@@ -1064,6 +1064,25 @@ FF_ENABLE_DEPRECATION_WARNINGS
     FF_ENABLE_DEPRECATION_WARNINGS
 #endif
 
+    /* With more threads than slices, run motion estimation as a wavefront
+     * over the macroblock rows so that it still uses all the threads.
+     * The last predictors reach below and right of the top-right neighbour,
+     * which the wavefront may or may not have overwritten yet, so they keep
+     * the per-slice estimation. */
+    if (HAVE_THREADS && avctx->active_thread_type & FF_THREAD_SLICE &&
+        avctx->thread_count > s->slice_context_count &&
+        !avctx->last_predictor_count &&
+        avctx->thread_count <= MAX_THREADS && s->mb_height > 1) {
+        for (i = 0; i < avctx->thread_count; i++) {
+            s->me_row_context[i] = av_memdup(s, sizeof(MpegEncContext));
+            if (!s->me_row_context[i])
+                return AVERROR(ENOMEM);
+            s->me_row_context_count = i + 1;
+            if ((ret = ff_mpv_init_duplicate_context(s->me_row_context[i])) < 0)
+                return ret;
+        }
+    }
+
     if (s->b_frame_strategy == 2) {
         for (i = 0; i < s->max_b_frames + 2; i++) {
             s->tmp_frames[i] = av_frame_alloc();
@@ -1098,6 +1117,12 @@ av_cold int ff_mpv_encode_end(AVCodecContext *avctx)
 
     ff_rate_control_uninit(s);
 
+    for (i = 0; i < s->me_row_context_count; i++) {
+        ff_mpv_free_duplicate_context(s->me_row_context[i]);
+        av_freep(&s->me_row_context[i]);
+    }
+    s->me_row_context_count = 0;
+
     ff_mpv_common_end(s);
     if (CONFIG_MJPEG_ENCODER &&
         s->out_format == FMT_MJPEG)
@@ -1366,7 +1391,11 @@ static int skip_check(MpegEncContext *s, Picture *p, Picture *ref)
     return 0;
 }
 
-static int encode_frame(AVCodecContext *c, AVFrame *frame)
+/**
+ * @param key_pts if not NULL, set to the pts of the first keyframe after
+ *                the first frame, if it is still 0
+ */
+static int encode_frame(AVCodecContext *c, AVFrame *frame, int64_t *key_pts)
 {
     AVPacket pkt = { 0 };
     int ret;
@@ -1382,6 +1411,8 @@ static int encode_frame(AVCodecContext *c, AVFrame *frame)
         ret = avcodec_receive_packet(c, &pkt);
         if (ret >= 0) {
             size += pkt.size;
+            if (key_pts && !*key_pts && pkt.flags & AV_PKT_FLAG_KEY && pkt.pts > 0)
+                *key_pts = pkt.pts;
             av_packet_unref(&pkt);
         } else if (ret < 0 && ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
             return ret;
@@ -1390,16 +1421,127 @@ static int encode_frame(AVCodecContext *c, AVFrame *frame)
     return size;
 }
 
+typedef struct BCountTrial {
+    int b_count;
+    int p_lambda, b_lambda, lambda2;
+    int64_t rd;
+    int64_t scene_cut;  ///< index in the window of the first frame coded as I, 0 if none
+} BCountTrial;
+
+/**
+ * Encode the downscaled lookahead window with trial->b_count B-frames
+ * between references and compute its rate-distortion cost.
+ * Runs through avctx->execute(), so trials for different B-frame counts
+ * are evaluated concurrently when slice threads are available.
+ * The trial without B-frames also finds the first scene cut of the window,
+ * as the first P-frame the trial encoder turned into an I-frame.
+ */
+static int estimate_b_count_rd(AVCodecContext *avctx, void *arg)
+{
+    MpegEncContext *s = avctx->priv_data;
+    BCountTrial *trial = arg;
+    const AVCodec *codec = avcodec_find_encoder(avctx->codec_id);
+    AVFrame *frames[MAX_B_FRAMES + 2] = { NULL };
+    AVCodecContext *c;
+    AVDictionary *opts = NULL;
+    int64_t *scene_cut = trial->b_count ? NULL : &trial->scene_cut;
+    int i, out_size, j = trial->b_count;
+    int64_t rd = 0;
+    int ret = 0;
+
+    /* the trial encoders only read the shared downscaled frames, but
+     * each one needs its own frame properties */
+    for (i = 0; i < s->max_b_frames + 2; i++) {
+        frames[i] = av_frame_clone(s->tmp_frames[i]);
+        if (!frames[i]) {
+            ret = AVERROR(ENOMEM);
+            goto fail_frames;
+        }
+        frames[i]->pts = i;
+    }
+
+    c = avcodec_alloc_context3(NULL);
+    if (!c) {
+        ret = AVERROR(ENOMEM);
+        goto fail_frames;
+    }
+
+    c->width        = s->width  >> s->brd_scale;
+    c->height       = s->height >> s->brd_scale;
+    c->flags        = AV_CODEC_FLAG_QSCALE | AV_CODEC_FLAG_PSNR;
+    c->flags       |= avctx->flags & AV_CODEC_FLAG_QPEL;
+    c->mb_decision  = avctx->mb_decision;
+    c->me_cmp       = avctx->me_cmp;
+    c->mb_cmp       = avctx->mb_cmp;
+    c->me_sub_cmp   = avctx->me_sub_cmp;
+    c->pix_fmt      = AV_PIX_FMT_YUV420P;
+    c->time_base    = avctx->time_base;
+    c->max_b_frames = s->max_b_frames;
+
+    av_dict_set_int(&opts, "sc_threshold", s->scenechange_threshold, 0);
+    ret = avcodec_open2(c, codec, &opts);
+    av_dict_free(&opts);
+    if (ret < 0)
+        goto fail;
+
+    frames[0]->pict_type = AV_PICTURE_TYPE_I;
+    frames[0]->quality   = 1 * FF_QP2LAMBDA;
+
+    out_size = encode_frame(c, frames[0], NULL);
+    if (out_size < 0) {
+        ret = out_size;
+        goto fail;
+    }
+
+    //rd += (out_size * lambda2) >> FF_LAMBDA_SHIFT;
+
+    for (i = 0; i < s->max_b_frames + 1; i++) {
+        int is_p = i % (j + 1) == j || i == s->max_b_frames;
+
+        frames[i + 1]->pict_type = is_p ?
+                                   AV_PICTURE_TYPE_P : AV_PICTURE_TYPE_B;
+        frames[i + 1]->quality   = is_p ? trial->p_lambda : trial->b_lambda;
+
+        out_size = encode_frame(c, frames[i + 1], scene_cut);
+        if (out_size < 0) {
+            ret = out_size;
+            goto fail;
+        }
+
+        rd += (out_size * trial->lambda2) >> (FF_LAMBDA_SHIFT - 3);
+    }
+
+    /* get the delayed frames */
+    out_size = encode_frame(c, NULL, scene_cut);
+    if (out_size < 0) {
+        ret = out_size;
+        goto fail;
+    }
+    rd += (out_size * trial->lambda2) >> (FF_LAMBDA_SHIFT - 3);
+
+    rd += c->error[0] + c->error[1] + c->error[2];
+
+    trial->rd = rd;
+
+fail:
+    avcodec_free_context(&c);
+fail_frames:
+    for (i = 0; i < s->max_b_frames + 2; i++)
+        av_frame_free(&frames[i]);
+
+    return ret;
+}
+
 static int estimate_best_b_count(MpegEncContext *s)
 {
-    const AVCodec *codec = avcodec_find_encoder(s->avctx->codec_id);
+    BCountTrial trials[MAX_B_FRAMES + 1];
+    int trials_ret[MAX_B_FRAMES + 1];
     const int scale = s->brd_scale;
     int width  = s->width  >> scale;
     int height = s->height >> scale;
-    int i, j, out_size, p_lambda, b_lambda, lambda2;
+    int i, j, nb_trials, p_lambda, b_lambda, lambda2;
     int64_t best_rd  = INT64_MAX;
     int best_b_count = -1;
-    int ret = 0;
 
     av_assert0(scale >= 0 && scale <= 3);
 
@@ -1446,79 +1588,38 @@ static int estimate_best_b_count(MpegEncContext *s)
         }
     }
 
-    for (j = 0; j < s->max_b_frames + 1; j++) {
-        AVCodecContext *c;
-        int64_t rd = 0;
-
-        if (!s->input_picture[j])
+    for (nb_trials = 0; nb_trials < s->max_b_frames + 1; nb_trials++) {
+        if (!s->input_picture[nb_trials])
             break;
 
-        c = avcodec_alloc_context3(NULL);
-        if (!c)
-            return AVERROR(ENOMEM);
-
-        c->width        = width;
-        c->height       = height;
-        c->flags        = AV_CODEC_FLAG_QSCALE | AV_CODEC_FLAG_PSNR;
-        c->flags       |= s->avctx->flags & AV_CODEC_FLAG_QPEL;
-        c->mb_decision  = s->avctx->mb_decision;
-        c->me_cmp       = s->avctx->me_cmp;
-        c->mb_cmp       = s->avctx->mb_cmp;
-        c->me_sub_cmp   = s->avctx->me_sub_cmp;
-        c->pix_fmt      = AV_PIX_FMT_YUV420P;
-        c->time_base    = s->avctx->time_base;
-        c->max_b_frames = s->max_b_frames;
-
-        ret = avcodec_open2(c, codec, NULL);
-        if (ret < 0)
-            goto fail;
-
-        s->tmp_frames[0]->pict_type = AV_PICTURE_TYPE_I;
-        s->tmp_frames[0]->quality   = 1 * FF_QP2LAMBDA;
-
-        out_size = encode_frame(c, s->tmp_frames[0]);
-        if (out_size < 0) {
-            ret = out_size;
-            goto fail;
-        }
-
-        //rd += (out_size * lambda2) >> FF_LAMBDA_SHIFT;
-
-        for (i = 0; i < s->max_b_frames + 1; i++) {
-            int is_p = i % (j + 1) == j || i == s->max_b_frames;
-
-            s->tmp_frames[i + 1]->pict_type = is_p ?
-                                     AV_PICTURE_TYPE_P : AV_PICTURE_TYPE_B;
-            s->tmp_frames[i + 1]->quality   = is_p ? p_lambda : b_lambda;
-
-            out_size = encode_frame(c, s->tmp_frames[i + 1]);
-            if (out_size < 0) {
-                ret = out_size;
-                goto fail;
-            }
-
-            rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
-        }
+        trials[nb_trials].b_count  = nb_trials;
+        trials[nb_trials].p_lambda = p_lambda;
+        trials[nb_trials].b_lambda = b_lambda;
+        trials[nb_trials].lambda2  = lambda2;
+        trials[nb_trials].rd       = INT64_MAX;
+        trials[nb_trials].scene_cut = 0;
+    }
 
-        /* get the delayed frames */
-        out_size = encode_frame(c, NULL);
-        if (out_size < 0) {
-            ret = out_size;
-            goto fail;
-        }
-        rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
+    s->avctx->execute(s->avctx, estimate_b_count_rd, trials, trials_ret,
+                      nb_trials, sizeof(*trials));
 
-        rd += c->error[0] + c->error[1] + c->error[2];
+    for (j = 0; j < nb_trials; j++) {
+        if (trials_ret[j] < 0)
+            return trials_ret[j];
 
-        if (rd < best_rd) {
-            best_rd = rd;
+        if (trials[j].rd < best_rd) {
+            best_rd = trials[j].rd;
             best_b_count = j;
         }
+    }
 
-fail:
-        avcodec_free_context(&c);
-        if (ret < 0)
-            return ret;
+    /* Code the scene cut as an I-frame, which also ends the B-frames
+     * before it, unless the user chose the type of that frame. */
+    i = trials[0].scene_cut - 1;
+    if (s->scenechange_threshold < 1000000000 && i >= 0 && i < nb_trials &&
+        s->input_picture[i]->f->pict_type == AV_PICTURE_TYPE_NONE) {
+        ff_dlog(s->avctx, "Lookahead scene cut at frame %d of the window\n", i);
+        s->input_picture[i]->f->pict_type = AV_PICTURE_TYPE_I;
     }
 
     return best_b_count;
@@ -2815,6 +2916,69 @@ static int estimate_motion_thread(AVCodecContext *c, void *arg){
     return 0;
 }
 
+static int estimate_motion_row_thread(AVCodecContext *c, void *arg,
+                                      int jobnr, int threadnr)
+{
+    MpegEncContext *s0 = c->priv_data;
+    MpegEncContext *s  = s0->me_row_context[threadnr];
+    int thread = jobnr % c->thread_count;
+    int i;
+
+    /* predictors are limited to the slice the row belongs to */
+    for (i = 0; i < s0->slice_context_count - 1; i++)
+        if (jobnr < s0->thread_context[i]->end_mb_y)
+            break;
+    s->start_mb_y = s0->thread_context[i]->start_mb_y;
+    s->end_mb_y   = s0->thread_context[i]->end_mb_y;
+
+    s->me.dia_size = s->avctx->dia_size;
+    s->first_slice_line = jobnr == s->start_mb_y;
+    s->mb_y = jobnr;
+    s->mb_x = 0; //for block init below
+    ff_init_block_index(s);
+    for (s->mb_x = 0; s->mb_x < s->mb_width; s->mb_x++) {
+        /* the left, top and top-right neighbours must be done */
+        if (!s->first_slice_line)
+            ff_thread_await_progress2(c, jobnr, thread, 2);
+
+        s->block_index[0] += 2;
+        s->block_index[1] += 2;
+        s->block_index[2] += 2;
+        s->block_index[3] += 2;
+
+        if (s->pict_type == AV_PICTURE_TYPE_B)
+            ff_estimate_b_frame_motion(s, s->mb_x, s->mb_y);
+        else
+            ff_estimate_p_frame_motion(s, s->mb_x, s->mb_y);
+
+        ff_thread_report_progress2(c, jobnr, thread, 1);
+    }
+    ff_thread_report_progress2(c, jobnr, thread, 2);
+
+    return 0;
+}
+
+static int estimate_motion_rows(MpegEncContext *s)
+{
+    int i, ret;
+
+    for (i = 0; i < s->me_row_context_count; i++) {
+        ret = ff_update_duplicate_context(s->me_row_context[i], s);
+        if (ret < 0)
+            return ret;
+    }
+
+    ret = ff_alloc_entries(s->avctx, s->mb_height);
+    if (ret < 0)
+        return ret;
+    ff_reset_entries(s->avctx);
+
+    s->avctx->execute2(s->avctx, estimate_motion_row_thread, NULL, NULL,
+                       s->mb_height);
+
+    return 0;
+}
+
 static int mb_var_thread(AVCodecContext *c, void *arg){
     MpegEncContext *s= *(void**)arg;
     int mb_x, mb_y;
@@ -3756,7 +3920,12 @@ static int encode_picture(MpegEncContext *s, int picture_number)
             }
         }
 
-        s->avctx->execute(s->avctx, estimate_motion_thread, &s->thread_context[0], NULL, context_count, sizeof(void*));
+        if (s->me_row_context_count) {
+            ret = estimate_motion_rows(s);
+            if (ret < 0)
+                return ret;
+        } else
+            s->avctx->execute(s->avctx, estimate_motion_thread, &s->thread_context[0], NULL, context_count, sizeof(void*));
     }else /* if(s->pict_type == AV_PICTURE_TYPE_I) */{
         /* I-Frame */
         for(i=0; i<s->mb_stride*s->mb_height; i++)
@@ -3770,6 +3939,8 @@ static int encode_picture(MpegEncContext *s, int picture_number)
     for(i=1; i<context_count; i++){
         merge_context_after_me(s, s->thread_context[i]);
     }
+    for (i = 0; i < s->me_row_context_count; i++)
+        merge_context_after_me(s, s->me_row_context[i]);
     s->current_picture.mc_mb_var_sum= s->current_picture_ptr->mc_mb_var_sum= s->me.mc_mb_var_sum_temp;
     s->current_picture.   mb_var_sum= s->current_picture_ptr->   mb_var_sum= s->me.   mb_var_sum_temp;
     emms_c();
@@ -44,6 +44,7 @@
 #include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "libavutil/thread.h"
+#include "libavutil/trace.h"
 
 enum {
     ///< Set when the thread is awaiting a packet.
@@ -137,6 +138,8 @@ typedef struct FrameThreadContext {
                                     * Set for the first N packets, where N is the number of threads.
                                     * While it is set, ff_thread_en/decode_frame won't return any results.
                                     */
+
+    int nb_pending;                ///< Packets submitted whose output has not been returned yet.
 } FrameThreadContext;
 
 #if FF_API_THREAD_SAFE_CALLBACKS
@@ -174,6 +177,10 @@ static attribute_align_arg void *frame_worker_thread(void *arg)
     PerThreadContext *p = arg;
     AVCodecContext *avctx = p->avctx;
     const AVCodec *codec = avctx->codec;
+    char name[32];
+
+    snprintf(name, sizeof(name), "%s frame thread %d",
+             codec->name, (int)(p - p->parent->threads));
 
     pthread_mutex_lock(&p->mutex);
     while (1) {
@@ -182,6 +189,8 @@ static attribute_align_arg void *frame_worker_thread(void *arg)
 
         if (p->die) break;
 
+        av_trace_set_thread_name(name);
+
 FF_DISABLE_DEPRECATION_WARNINGS
         if (!codec->update_thread_context
 #if FF_API_THREAD_SAFE_CALLBACKS
@@ -208,7 +217,9 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
         av_frame_unref(p->frame);
         p->got_frame = 0;
+        av_trace_begin("frame_thread", codec->name);
         p->result = codec->decode(avctx, p->frame, &p->got_frame, &p->avpkt);
+        av_trace_end();
 
         if ((p->result < 0 || !p->got_frame) && p->frame->buf[0]) {
             if (avctx->codec->caps_internal & FF_CODEC_CAP_ALLOCATE_PROGRESS)
@@ -500,6 +511,7 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
 {
     FrameThreadContext *fctx = avctx->internal->thread_ctx;
     int finished = fctx->next_finished;
+    int max_delay = avctx->thread_count - 1 - (avctx->codec_id == AV_CODEC_ID_FFV1);
     PerThreadContext *p;
     int err;
 
@@ -515,12 +527,31 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
     err = submit_packet(p, avctx, avpkt);
     if (err)
         goto finish;
+    fctx->nb_pending++;
+
+    if (avctx->frame_thread_delay >= 0) {
+        /*
+         * Bounded delay: return the oldest frame as soon as it is done, and
+         * only block on it once more than frame_thread_delay packets are
+         * waiting for output.
+         */
+        max_delay = FFMIN(max_delay, avctx->frame_thread_delay);
+
+        if (avpkt->size && fctx->nb_pending <= max_delay &&
+            atomic_load(&fctx->threads[finished].state) != STATE_INPUT_READY) {
+            *got_picture_ptr = 0;
+            if (fctx->next_decoding >= avctx->thread_count) fctx->next_decoding = 0;
+            err = avpkt->size;
+            goto finish;
+        }
+        fctx->delaying = 0;
+    }
 
     /*
      * If we're still receiving the initial packets, don't return a frame.
      */
 
-    if (fctx->next_decoding > (avctx->thread_count-1-(avctx->codec_id == AV_CODEC_ID_FFV1)))
+    if (fctx->next_decoding > max_delay)
         fctx->delaying = 0;
 
     if (fctx->delaying) {
@@ -561,6 +592,7 @@ int ff_thread_decode_frame(AVCodecContext *avctx,
          */
         p->got_frame = 0;
         p->result = 0;
+        fctx->nb_pending = FFMAX(fctx->nb_pending - 1, 0);
 
         if (finished >= avctx->thread_count) finished = 0;
     } while (!avpkt->size && !*got_picture_ptr && err >= 0 && finished != fctx->next_finished);
@@ -579,6 +611,40 @@ finish:
     return err;
 }
 
+int ff_thread_get_finished_frame(AVCodecContext *avctx, AVFrame *picture,
+                                 int *got_picture_ptr)
+{
+    FrameThreadContext *fctx = avctx->internal->thread_ctx;
+    PerThreadContext *p = NULL;
+    int err = 0;
+
+    *got_picture_ptr = 0;
+
+    /* take the outputs of the oldest threads as long as they are done,
+     * skipping those which did not produce a frame */
+    while (fctx->nb_pending && !*got_picture_ptr && err >= 0 &&
+           atomic_load(&fctx->threads[fctx->next_finished].state) == STATE_INPUT_READY) {
+        p = &fctx->threads[fctx->next_finished];
+
+        av_frame_move_ref(picture, p->frame);
+        *got_picture_ptr = p->got_frame;
+        picture->pkt_dts = p->avpkt.dts;
+        err = p->result;
+
+        p->got_frame = 0;
+        p->result = 0;
+        fctx->nb_pending--;
+
+        if (++fctx->next_finished >= avctx->thread_count)
+            fctx->next_finished = 0;
+    }
+
+    if (p)
+        update_context_from_thread(avctx, p->avctx, 1);
+
+    return err;
+}
+
 void ff_thread_report_progress(ThreadFrame *f, int n, int field)
 {
     PerThreadContext *p;
@@ -902,6 +968,7 @@ void ff_thread_flush(AVCodecContext *avctx)
 
     fctx->next_decoding = fctx->next_finished = 0;
     fctx->delaying = 1;
+    fctx->nb_pending = 0;
     fctx->prev_thread = NULL;
     for (i = 0; i < avctx->thread_count; i++) {
         PerThreadContext *p = &fctx->threads[i];
@@ -60,6 +60,16 @@ void ff_thread_flush(AVCodecContext *avctx);
 int ff_thread_decode_frame(AVCodecContext *avctx, AVFrame *picture,
                            int *got_picture_ptr, AVPacket *avpkt);
 
+/**
+ * Return the oldest frame decoded by the threads without submitting a new
+ * packet and without waiting, for AVCodecContext.frame_thread_delay.
+ * *got_picture_ptr is set to 0 if the oldest thread is still decoding.
+ *
+ * @return 0 or the error of the decoding of the frame
+ */
+int ff_thread_get_finished_frame(AVCodecContext *avctx, AVFrame *picture,
+                                 int *got_picture_ptr);
+
 /**
  * If the codec defines update_thread_context(), call this
  * when they are ready for the next thread to start decoding
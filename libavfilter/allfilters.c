@@ -19,6 +19,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "libavutil/name_table.h"
 #include "libavutil/thread.h"
 #include "avfilter.h"
 #include "config.h"
@@ -540,19 +541,35 @@ const AVFilter *av_filter_iterate(void **opaque)
     return f;
 }
 
+/* open addressing table of the filter_list indices plus one, by name */
+#define FILTER_HASH_SIZE (2 * FF_ARRAY_ELEMS(filter_list))
+static uint16_t filter_hash[FILTER_HASH_SIZE];
+static AVOnce filter_hash_init = AV_ONCE_INIT;
+
+static int match_filter_name(const char *name, int idx)
+{
+    return !strcmp(filter_list[idx]->name, name);
+}
+
+static void init_filter_hash(void)
+{
+    for (int i = 0; filter_list[i]; i++)
+        avpriv_name_table_add(filter_hash, FILTER_HASH_SIZE, filter_list[i]->name,
+                              0, i, match_filter_name);
+}
+
 const AVFilter *avfilter_get_by_name(const char *name)
 {
-    const AVFilter *f = NULL;
-    void *opaque = 0;
+    int idx;
 
     if (!name)
         return NULL;
 
-    while ((f = av_filter_iterate(&opaque)))
-        if (!strcmp(f->name, name))
-            return f;
+    ff_thread_once(&filter_hash_init, init_filter_hash);
 
-    return NULL;
+    idx = avpriv_name_table_find(filter_hash, FILTER_HASH_SIZE, name, 0,
+                                 match_filter_name);
+    return idx >= 0 ? filter_list[idx] : NULL;
 }
 
 
@@ -294,6 +294,16 @@ static void cqt_calc(FFTComplex *dst, const FFTComplex *src, const Coeffs *coeff
     }
 }
 
+void ff_showcqt_init_cqt(ShowCQTContext *s)
+{
+    s->cqt_align = 1;
+    s->cqt_calc = cqt_calc;
+    s->permute_coeffs = NULL;
+
+    if (ARCH_X86)
+        ff_showcqt_init_x86(s);
+}
+
 static int init_cqt(ShowCQTContext *s)
 {
     const char *var_names[] = { "timeclamp", "tc", "frequency", "freq", "f", NULL };
@@ -755,14 +765,15 @@ static void yuv_from_cqt(ColorFloat *c, const FFTComplex *v, float gamma, int le
 }
 
 static void draw_bar_rgb(AVFrame *out, const float *h, const float *rcp_h,
-                         const ColorFloat *c, int bar_h, float bar_t)
+                         const ColorFloat *c, int bar_h, float bar_t,
+                         int y_start, int y_end)
 {
     int x, y, w = out->width;
     float mul, ht, rcp_bar_h = 1.0f / bar_h, rcp_bar_t = 1.0f / bar_t;
     uint8_t *v = out->data[0], *lp;
     int ls = out->linesize[0];
 
-    for (y = 0; y < bar_h; y++) {
+    for (y = y_start; y < y_end; y++) {
         ht = (bar_h - y) * rcp_bar_h;
         lp = v + y * ls;
         for (x = 0; x < w; x++) {
@@ -808,7 +819,8 @@ do { \
 } while (0)
 
 static void draw_bar_yuv(AVFrame *out, const float *h, const float *rcp_h,
-                         const ColorFloat *c, int bar_h, float bar_t)
+                         const ColorFloat *c, int bar_h, float bar_t,
+                         int y_start, int y_end)
 {
     int x, y, yh, w = out->width;
     float mul, ht, rcp_bar_h = 1.0f / bar_h, rcp_bar_t = 1.0f / bar_t;
@@ -817,7 +829,7 @@ static void draw_bar_yuv(AVFrame *out, const float *h, const float *rcp_h,
     int lsy = out->linesize[0], lsu = out->linesize[1], lsv = out->linesize[2];
     int fmt = out->format;
 
-    for (y = 0; y < bar_h; y += 2) {
+    for (y = y_start; y < y_end; y += 2) {
         yh = (fmt == AV_PIX_FMT_YUV420P) ? y / 2 : y;
         ht = (bar_h - y) * rcp_bar_h;
         lpy = vy + y * lsy;
@@ -858,13 +870,14 @@ static void draw_bar_yuv(AVFrame *out, const float *h, const float *rcp_h,
     }
 }
 
-static void draw_axis_rgb(AVFrame *out, AVFrame *axis, const ColorFloat *c, int off)
+static void draw_axis_rgb(AVFrame *out, AVFrame *axis, const ColorFloat *c, int off,
+                          int y_start, int y_end)
 {
-    int x, y, w = axis->width, h = axis->height;
+    int x, y, w = axis->width;
     float a, rcp_255 = 1.0f / 255.0f;
     uint8_t *lp, *lpa;
 
-    for (y = 0; y < h; y++) {
+    for (y = y_start; y < y_end; y++) {
         lp = out->data[0] + (off + y) * out->linesize[0];
         lpa = axis->data[0] + y * axis->linesize[0];
         for (x = 0; x < w; x++) {
@@ -960,9 +973,10 @@ do { \
     lpau += 2; lpav += 2; lpaa++; lpu++; lpv++; \
 } while (0)
 
-static void draw_axis_yuv(AVFrame *out, AVFrame *axis, const ColorFloat *c, int off)
+static void draw_axis_yuv(AVFrame *out, AVFrame *axis, const ColorFloat *c, int off,
+                          int y_start, int y_end)
 {
-    int fmt = out->format, x, y, yh, w = axis->width, h = axis->height;
+    int fmt = out->format, x, y, yh, w = axis->width;
     int offh = (fmt == AV_PIX_FMT_YUV420P) ? off / 2 : off;
     uint8_t *vy = out->data[0], *vu = out->data[1], *vv = out->data[2];
     uint8_t *vay = axis->data[0], *vau = axis->data[1], *vav = axis->data[2], *vaa = axis->data[3];
@@ -970,7 +984,7 @@ static void draw_axis_yuv(AVFrame *out, AVFrame *axis, const ColorFloat *c, int
     int lsay = axis->linesize[0], lsau = axis->linesize[1], lsav = axis->linesize[2], lsaa = axis->linesize[3];
     uint8_t *lpy, *lpu, *lpv, *lpay, *lpau, *lpav, *lpaa;
 
-    for (y = 0; y < h; y += 2) {
+    for (y = y_start; y < y_end; y += 2) {
         yh = (fmt == AV_PIX_FMT_YUV420P) ? y / 2 : y;
         lpy = vy + (off + y) * lsy;
         lpu = vu + (offh + yh) * lsu;
@@ -1025,7 +1039,8 @@ static void draw_axis_yuv(AVFrame *out, AVFrame *axis, const ColorFloat *c, int
     }
 }
 
-static void draw_sono(AVFrame *out, AVFrame *sono, int off, int idx)
+static void draw_sono(AVFrame *out, AVFrame *sono, int off, int idx,
+                      int y_start, int y_end)
 {
     int fmt = out->format, h = sono->height;
     int nb_planes = (fmt == AV_PIX_FMT_RGB24) ? 1 : 3;
@@ -1034,14 +1049,14 @@ static void draw_sono(AVFrame *out, AVFrame *sono, int off, int idx)
     int ls, i, y, yh;
 
     ls = FFMIN(out->linesize[0], sono->linesize[0]);
-    for (y = 0; y < h; y++) {
+    for (y = y_start; y < y_end; y++) {
         memcpy(out->data[0] + (off + y) * out->linesize[0],
                sono->data[0] + (idx + y) % h * sono->linesize[0], ls);
     }
 
     for (i = 1; i < nb_planes; i++) {
         ls = FFMIN(out->linesize[i], sono->linesize[i]);
-        for (y = 0; y < h; y += inc) {
+        for (y = y_start; y < y_end; y += inc) {
             yh = (fmt == AV_PIX_FMT_YUV420P) ? y / 2 : y;
             memcpy(out->data[i] + (offh + yh) * out->linesize[i],
                    sono->data[i] + (idx + y) % h * sono->linesize[i], ls);
@@ -1126,6 +1141,51 @@ static void process_cqt(ShowCQTContext *s)
         yuv_from_cqt(s->c_buf, s->cqt_result, s->sono_g, s->width, s->cmatrix, s->cscheme_v);
 }
 
+/* first line of a slice, kept even for the chroma subsampled formats */
+#define SLICE_LINE(h, jobnr, nb_jobs) ((h) / 2 * (jobnr) / (nb_jobs) * 2)
+
+static int cqt_calc_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ShowCQTContext *s = ctx->priv;
+    /* the SIMD versions process the coefficients in pairs */
+    const int start = SLICE_LINE(s->cqt_len, jobnr, nb_jobs);
+    const int end   = SLICE_LINE(s->cqt_len, jobnr + 1, nb_jobs);
+
+    s->cqt_calc(s->cqt_result + start, s->fft_result, s->coeffs + start,
+                end - start, s->fft_len);
+    return 0;
+}
+
+static int draw_bar_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ShowCQTContext *s = ctx->priv;
+
+    s->draw_bar(arg, s->h_buf, s->rcp_h_buf, s->c_buf, s->bar_h, s->bar_t,
+                SLICE_LINE(s->bar_h, jobnr, nb_jobs),
+                SLICE_LINE(s->bar_h, jobnr + 1, nb_jobs));
+    return 0;
+}
+
+static int draw_axis_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ShowCQTContext *s = ctx->priv;
+
+    s->draw_axis(arg, s->axis_frame, s->c_buf, s->bar_h,
+                 SLICE_LINE(s->axis_h, jobnr, nb_jobs),
+                 SLICE_LINE(s->axis_h, jobnr + 1, nb_jobs));
+    return 0;
+}
+
+static int draw_sono_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ShowCQTContext *s = ctx->priv;
+
+    s->draw_sono(arg, s->sono_frame, s->bar_h + s->axis_h, s->sono_idx,
+                 SLICE_LINE(s->sono_h, jobnr, nb_jobs),
+                 SLICE_LINE(s->sono_h, jobnr + 1, nb_jobs));
+    return 0;
+}
+
 static int plot_cqt(AVFilterContext *ctx, AVFrame **frameout)
 {
     AVFilterLink *outlink = ctx->outputs[0];
@@ -1153,7 +1213,8 @@ static int plot_cqt(AVFilterContext *ctx, AVFrame **frameout)
     s->fft_result[s->fft_len] = s->fft_result[0];
     UPDATE_TIME(s->fft_time);
 
-    s->cqt_calc(s->cqt_result, s->fft_result, s->coeffs, s->cqt_len, s->fft_len);
+    ctx->internal->execute(ctx, cqt_calc_slice, NULL, NULL,
+                           FFMIN(s->cqt_len / 2, s->nb_threads));
     UPDATE_TIME(s->cqt_time);
 
     process_cqt(s);
@@ -1174,17 +1235,20 @@ static int plot_cqt(AVFilterContext *ctx, AVFrame **frameout)
         UPDATE_TIME(s->alloc_time);
 
         if (s->bar_h) {
-            s->draw_bar(out, s->h_buf, s->rcp_h_buf, s->c_buf, s->bar_h, s->bar_t);
+            ctx->internal->execute(ctx, draw_bar_slice, out, NULL,
+                                   FFMIN(s->bar_h / 2, s->nb_threads));
             UPDATE_TIME(s->bar_time);
         }
 
         if (s->axis_h) {
-            s->draw_axis(out, s->axis_frame, s->c_buf, s->bar_h);
+            ctx->internal->execute(ctx, draw_axis_slice, out, NULL,
+                                   FFMIN(s->axis_h / 2, s->nb_threads));
             UPDATE_TIME(s->axis_time);
         }
 
         if (s->sono_h) {
-            s->draw_sono(out, s->sono_frame, s->bar_h + s->axis_h, s->sono_idx);
+            ctx->internal->execute(ctx, draw_sono_slice, out, NULL,
+                                   FFMIN(s->sono_h / 2, s->nb_threads));
             UPDATE_TIME(s->sono_time);
         }
         out->pts = s->next_pts;
@@ -1402,9 +1466,8 @@ static int config_output(AVFilterLink *outlink)
         }
     }
 
-    s->cqt_align = 1;
-    s->cqt_calc = cqt_calc;
-    s->permute_coeffs = NULL;
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+    ff_showcqt_init_cqt(s);
     s->draw_sono = draw_sono;
     if (s->format == AV_PIX_FMT_RGB24) {
         s->draw_bar = draw_bar_rgb;
@@ -1416,9 +1479,6 @@ static int config_output(AVFilterLink *outlink)
         s->update_sono = update_sono_yuv;
     }
 
-    if (ARCH_X86)
-        ff_showcqt_init_x86(s);
-
     if ((ret = init_cqt(s)) < 0)
         return ret;
 
@@ -1599,4 +1659,5 @@ AVFilter ff_avf_showcqt = {
     .inputs        = showcqt_inputs,
     .outputs       = showcqt_outputs,
     .priv_class    = &showcqt_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
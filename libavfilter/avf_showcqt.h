@@ -68,6 +68,7 @@ typedef struct ShowCQTContext {
     int                 fft_len;
     int                 cqt_len;
     int                 cqt_align;
+    int                 nb_threads;
     ColorFloat          *c_buf;
     float               *h_buf;
     float               *rcp_h_buf;
@@ -79,10 +80,15 @@ typedef struct ShowCQTContext {
     void                (*cqt_calc)(FFTComplex *dst, const FFTComplex *src, const Coeffs *coeffs,
                                     int len, int fft_len);
     void                (*permute_coeffs)(float *v, int len);
+    /* the drawing callbacks render the lines [y_start, y_end) of their area,
+     * y_start and y_end must be even */
     void                (*draw_bar)(AVFrame *out, const float *h, const float *rcp_h,
-                                    const ColorFloat *c, int bar_h, float bar_t);
-    void                (*draw_axis)(AVFrame *out, AVFrame *axis, const ColorFloat *c, int off);
-    void                (*draw_sono)(AVFrame *out, AVFrame *sono, int off, int idx);
+                                    const ColorFloat *c, int bar_h, float bar_t,
+                                    int y_start, int y_end);
+    void                (*draw_axis)(AVFrame *out, AVFrame *axis, const ColorFloat *c, int off,
+                                     int y_start, int y_end);
+    void                (*draw_sono)(AVFrame *out, AVFrame *sono, int off, int idx,
+                                     int y_start, int y_end);
     void                (*update_sono)(AVFrame *sono, const ColorFloat *c, int idx);
     /* performance debugging */
     int64_t             fft_time;
@@ -122,6 +128,7 @@ typedef struct ShowCQTContext {
     char                *cscheme;
 } ShowCQTContext;
 
+void ff_showcqt_init_cqt(ShowCQTContext *s);
 void ff_showcqt_init_x86(ShowCQTContext *s);
 
 #endif
@@ -19,6 +19,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <time.h>
+
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/buffer.h"
@@ -33,6 +35,8 @@
 #include "libavutil/rational.h"
 #include "libavutil/samplefmt.h"
 #include "libavutil/thread.h"
+#include "libavutil/time.h"
+#include "libavutil/trace.h"
 
 #define FF_INTERNAL_FIELDS 1
 #include "framequeue.h"
@@ -891,6 +895,11 @@ int ff_filter_process_command(AVFilterContext *ctx, const char *cmd,
     return av_opt_set(ctx->priv, cmd, arg, 0);
 }
 
+int ff_filter_reconfigure_stateless(AVFilterContext *ctx)
+{
+    return 0;
+}
+
 int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
 {
     int ret = 0;
@@ -1133,6 +1142,7 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
         av_frame_free(&frame);
         return ret;
     }
+    link->max_queued = FFMAX(link->max_queued, ff_framequeue_queued_frames(&link->fifo));
     ff_filter_set_ready(link->dst, 300);
     return 0;
 
@@ -1428,21 +1438,64 @@ static int ff_filter_activate_default(AVFilterContext *filter)
      [buffersrc1][testsrc1][buffersrc2][testsrc2]concat=v=2).
  */
 
+static int64_t thread_cpu_time(void)
+{
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+    if (!clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+    return 0;
+}
+
 int ff_filter_activate(AVFilterContext *filter)
 {
+    const int stats = filter->graph && filter->graph->stats;
+    int64_t wall_time = 0, cpu_time = 0;
     int ret;
 
     /* Generic timeline support is not yet implemented but should be easy */
     av_assert1(!(filter->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC &&
                  filter->filter->activate));
     filter->ready = 0;
+    if (stats) {
+        wall_time = av_gettime_relative();
+        cpu_time  = thread_cpu_time();
+    }
+    av_trace_begin("filter", filter->name);
     ret = filter->filter->activate ? filter->filter->activate(filter) :
           ff_filter_activate_default(filter);
+    av_trace_end();
+    if (stats) {
+        filter->internal->nb_runs++;
+        filter->internal->wall_time += av_gettime_relative() - wall_time;
+        filter->internal->cpu_time  += thread_cpu_time()     - cpu_time;
+    }
     if (ret == FFERROR_NOT_READY)
         ret = 0;
     return ret;
 }
 
+void avfilter_get_stats(const AVFilterContext *filter, AVFilterStats *stats)
+{
+    unsigned i;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->nb_runs   = filter->internal->nb_runs;
+    stats->wall_time = filter->internal->wall_time;
+    stats->cpu_time  = filter->internal->cpu_time;
+    for (i = 0; i < filter->nb_inputs; i++) {
+        const AVFilterLink *link = filter->inputs[i];
+        if (!link)
+            continue;
+        stats->frames_in += link->frame_count_out;
+        stats->max_queued = FFMAX(stats->max_queued, link->max_queued);
+    }
+    for (i = 0; i < filter->nb_outputs; i++)
+        if (filter->outputs[i])
+            stats->frames_out += filter->outputs[i]->frame_count_in;
+}
+
 int ff_inlink_acknowledge_status(AVFilterLink *link, int *rstatus, int64_t *rpts)
 {
     *rpts = link->current_pts;
@@ -328,6 +328,18 @@ typedef struct AVFilter {
      * activation.
      */
     int (*activate)(AVFilterContext *ctx);
+
+    /**
+     * Prepare the filter for avfilter_graph_reconfigure(), after which
+     * the config_props callbacks of its pads are called again.
+     *
+     * Filters that do not set it cannot be reconfigured in place.
+     *
+     * @returns >= 0 on success, AVERROR(ENOSYS) if the filter cannot be
+     *          reconfigured in its current state, in which case it must
+     *          not have been changed.
+     */
+    int (*reconfigure)(AVFilterContext *ctx);
 } AVFilter;
 
 /**
@@ -652,6 +664,11 @@ struct AVFilterLink {
      */
     int status_out;
 
+    /**
+     * Highest number of frames queued in fifo.
+     */
+    int64_t max_queued;
+
 #endif /* FF_INTERNAL_FIELDS */
 
 };
@@ -707,6 +724,55 @@ int avfilter_config_links(AVFilterContext *filter);
  */
 int avfilter_process_command(AVFilterContext *filter, const char *cmd, const char *arg, char *res, int res_len, int flags);
 
+/**
+ * Processing statistics of a filter instance.
+ *
+ * The struct is allocated by the caller, so sizeof(AVFilterStats) is a part
+ * of the public ABI and new fields can only be added with a major bump.
+ */
+typedef struct AVFilterStats {
+    /**
+     * Number of times the filter ran, i.e. its activate() or filter_frame()
+     * callback was called.
+     */
+    int64_t nb_runs;
+
+    /**
+     * Wall clock time spent in the filter, in microseconds.
+     */
+    int64_t wall_time;
+
+    /**
+     * CPU time spent in the filter by the calling thread, in microseconds.
+     * Work done by slice threads is only accounted in wall_time. 0 if the
+     * platform does not provide per-thread CPU time.
+     */
+    int64_t cpu_time;
+
+    /**
+     * Number of frames the filter took from its inputs.
+     */
+    int64_t frames_in;
+
+    /**
+     * Number of frames the filter sent to its outputs.
+     */
+    int64_t frames_out;
+
+    /**
+     * Highest number of frames that waited at once on one of the inputs.
+     */
+    int64_t max_queued;
+} AVFilterStats;
+
+/**
+ * Get the processing statistics of a filter.
+ *
+ * nb_runs, wall_time and cpu_time are only collected while the stats
+ * option of the filtergraph is set.
+ */
+void avfilter_get_stats(const AVFilterContext *filter, AVFilterStats *stats);
+
 /**
  * Iterate over all registered filters.
  *
@@ -818,6 +884,12 @@ const AVClass *avfilter_get_class(void);
 
 typedef struct AVFilterGraphInternal AVFilterGraphInternal;
 
+/**
+ * Formats negotiated by a filter graph, to be reused by a later graph with
+ * the same filters and links, see AVFilterGraph.formats_cache.
+ */
+typedef struct AVFilterFormatsCache AVFilterFormatsCache;
+
 /**
  * A function pointer passed to the @ref AVFilterGraph.execute callback to be
  * executed multiple times, possibly in parallel.
@@ -906,6 +978,26 @@ typedef struct AVFilterGraph {
 
     char *aresample_swr_opts; ///< swr options to use for the auto-inserted aresample filters, Access ONLY through AVOptions
 
+    /**
+     * If set, measure the time spent in each filter of the graph, see
+     * avfilter_get_stats(). May be set by the caller at any point.
+     */
+    int stats;
+
+    /**
+     * If set, avfilter_graph_config() reuses the formats stored in the cache
+     * when the filters of the graph, their links and the formats they
+     * support are the same as in the graph the cache was last filled with,
+     * instead of negotiating them again, and stores the negotiated formats
+     * in it otherwise. This speeds up the reconfiguration of large graphs
+     * which are rebuilt with identical inputs.
+     *
+     * The cache is owned by the caller, allocated with
+     * avfilter_formats_cache_alloc(), and may be shared by successive
+     * graphs but not by graphs configured at the same time.
+     */
+    AVFilterFormatsCache *formats_cache;
+
     /**
      * Private fields
      *
@@ -995,6 +1087,36 @@ enum {
  */
 int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx);
 
+/**
+ * Allocate an empty formats cache, see AVFilterGraph.formats_cache.
+ *
+ * @return the allocated cache or NULL on failure.
+ */
+AVFilterFormatsCache *avfilter_formats_cache_alloc(void);
+
+/**
+ * Free a formats cache and set *cache to NULL.
+ */
+void avfilter_formats_cache_free(AVFilterFormatsCache **cache);
+
+/**
+ * Reconfigure the links following a filter in a configured graph after
+ * the parameters of that filter changed, typically the frame size set on
+ * a buffer source with av_buffersrc_parameters_set().
+ *
+ * Only the filters from src to the sinks are reconfigured, the formats
+ * are not negotiated again. This is only possible if all of them support
+ * it, if only the size and the sample aspect ratio of video links change
+ * and if no frame is queued on these links.
+ *
+ * @return >= 0 in case of success;
+ *         AVERROR(ENOSYS) if the graph cannot be reconfigured in place,
+ *         in which case it is left unchanged;
+ *         another negative AVERROR code on failure, in which case the
+ *         graph must not be used anymore.
+ */
+int avfilter_graph_reconfigure(AVFilterGraph *graph, AVFilterContext *src);
+
 /**
  * Free a graph, destroy its links, and set *graph to NULL.
  * If *graph is NULL, do nothing.
@@ -56,6 +56,8 @@ static const AVOption filtergraph_options[] = {
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|V },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|A },
+    { "stats",       "Measure the time spent in each filter", OFFSET(stats),
+        AV_OPT_TYPE_BOOL,  { .i64 = 0 }, 0, 1, F|V|A },
     { NULL },
 };
 
@@ -422,17 +424,419 @@ static int formats_declared(AVFilterContext *f)
     return 1;
 }
 
+/**
+ * Insert a scale or aresample filter on link and query its formats.
+ */
+static int insert_conversion_filter(AVFilterGraph *graph, AVFilterLink *link,
+                                    int index, AVFilterContext **convert,
+                                    AVClass *log_ctx)
+{
+    const AVFilter *filter;
+    char inst_name[30];
+    int ret;
+
+    switch (link->type) {
+    case AVMEDIA_TYPE_VIDEO:
+        if (!(filter = avfilter_get_by_name("scale"))) {
+            av_log(log_ctx, AV_LOG_ERROR, "'scale' filter "
+                   "not present, cannot convert pixel formats.\n");
+            return AVERROR(EINVAL);
+        }
+
+        snprintf(inst_name, sizeof(inst_name), "auto_scaler_%d", index);
+
+        if ((ret = avfilter_graph_create_filter(convert, filter,
+                                                inst_name, graph->scale_sws_opts, NULL,
+                                                graph)) < 0)
+            return ret;
+        break;
+    case AVMEDIA_TYPE_AUDIO:
+        if (!(filter = avfilter_get_by_name("aresample"))) {
+            av_log(log_ctx, AV_LOG_ERROR, "'aresample' filter "
+                   "not present, cannot convert audio formats.\n");
+            return AVERROR(EINVAL);
+        }
+
+        snprintf(inst_name, sizeof(inst_name), "auto_resampler_%d", index);
+        if ((ret = avfilter_graph_create_filter(convert, filter,
+                                                inst_name, graph->aresample_swr_opts,
+                                                NULL, graph)) < 0)
+            return ret;
+        break;
+    default:
+        return AVERROR(EINVAL);
+    }
+
+    if ((ret = avfilter_insert_filter(link, *convert, 0, 0)) < 0)
+        return ret;
+
+    return filter_query_formats(*convert);
+}
+
+typedef struct FormatsCacheConverter {
+    int link;               ///< index of the link the filter was inserted on
+    int index;              ///< number in the name of the filter
+} FormatsCacheConverter;
+
+typedef struct FormatsCacheLink {
+    int format;
+    int sample_rate;
+    uint64_t channel_layout;
+    int channels;
+} FormatsCacheLink;
+
+struct AVFilterFormatsCache {
+    /**
+     * Description of the graph after its filters were queried for the
+     * first time: the filters, their links, the options of the conversion
+     * filters and the formats lists. The negotiation only depends on it.
+     */
+    char *key;
+    unsigned key_size;
+
+    /* what the negotiation did, in the order it was done */
+    FormatsCacheConverter *converters;
+    int nb_converters;
+    FormatsCacheLink *links;
+    int nb_links;
+};
+
+AVFilterFormatsCache *avfilter_formats_cache_alloc(void)
+{
+    return av_mallocz(sizeof(AVFilterFormatsCache));
+}
+
+static void formats_cache_reset(AVFilterFormatsCache *cache)
+{
+    av_freep(&cache->key);
+    av_freep(&cache->converters);
+    av_freep(&cache->links);
+    cache->key_size = cache->nb_converters = cache->nb_links = 0;
+}
+
+void avfilter_formats_cache_free(AVFilterFormatsCache **cache)
+{
+    if (!*cache)
+        return;
+    formats_cache_reset(*cache);
+    av_freep(cache);
+}
+
+/* Links are numbered in the order of the inputs of the filters. */
+static int get_link_index(AVFilterGraph *graph, AVFilterLink *link)
+{
+    int i, n = 0;
+
+    for (i = 0; i < graph->nb_filters && graph->filters[i] != link->dst; i++)
+        n += graph->filters[i]->nb_inputs;
+    return n + FF_INLINK_IDX(link);
+}
+
+static AVFilterLink *get_link(AVFilterGraph *graph, int index)
+{
+    int i;
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+        if (index < f->nb_inputs)
+            return f->inputs[index];
+        index -= f->nb_inputs;
+    }
+    return NULL;
+}
+
+static int get_filter_index(AVFilterGraph *graph, AVFilterContext *filter)
+{
+    int i;
+
+    for (i = 0; i < graph->nb_filters; i++)
+        if (graph->filters[i] == filter)
+            return i;
+    return -1;
+}
+
+static int formats_cache_add_converter(AVFilterFormatsCache *cache,
+                                       AVFilterGraph *graph,
+                                       AVFilterLink *link, int index)
+{
+    FormatsCacheConverter *conv;
+
+    conv = av_realloc_array(cache->converters, cache->nb_converters + 1,
+                            sizeof(*cache->converters));
+    if (!conv)
+        return AVERROR(ENOMEM);
+    cache->converters = conv;
+    conv[cache->nb_converters].link  = get_link_index(graph, link);
+    conv[cache->nb_converters].index = index;
+    cache->nb_converters++;
+    return 0;
+}
+
+#define NB_LINK_LISTS 6
+
+typedef struct ListRef {
+    const void *list;
+    int first;              ///< first slot the list appears in
+} ListRef;
+
+static int cmp_list_ref_ptr(const void *a, const void *b)
+{
+    const ListRef *ra = a, *rb = b;
+    if (ra->list != rb->list)
+        return (uintptr_t)ra->list < (uintptr_t)rb->list ? -1 : 1;
+    return 0;
+}
+
+static int cmp_list_ref(const void *a, const void *b)
+{
+    const ListRef *ra = a, *rb = b;
+    int ret = cmp_list_ref_ptr(a, b);
+    return ret ? ret : FFDIFFSIGN(ra->first, rb->first);
+}
+
+static void get_link_lists(AVFilterLink *link, const void **lists)
+{
+    lists[0] = link->incfg.formats;
+    lists[1] = link->outcfg.formats;
+    lists[2] = link->incfg.samplerates;
+    lists[3] = link->outcfg.samplerates;
+    lists[4] = link->incfg.channel_layouts;
+    lists[5] = link->outcfg.channel_layouts;
+}
+
+#define KEY_PUT(key, val) av_bprint_append_data(key, (const char *)&(val), sizeof(val))
+
+static void key_put_string(AVBPrint *key, const char *str)
+{
+    str = str ? str : "";
+    av_bprint_append_data(key, str, strlen(str) + 1);
+}
+
+/**
+ * Describe the graph and its formats lists in key. Lists shared by several
+ * links are described once, then referred to, since merging them affects
+ * all these links.
+ */
+static int formats_cache_make_key(AVFilterGraph *graph, AVBPrint *key)
+{
+    ListRef *refs;
+    int i, j, k, n, nb_slots = 0;
+
+    for (i = 0; i < graph->nb_filters; i++)
+        nb_slots += graph->filters[i]->nb_inputs * NB_LINK_LISTS;
+    refs = av_malloc_array(FFMAX(nb_slots, 1), sizeof(*refs));
+    if (!refs)
+        return AVERROR(ENOMEM);
+
+    for (i = n = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+        for (j = 0; j < f->nb_inputs; j++) {
+            const void *lists[NB_LINK_LISTS];
+            get_link_lists(f->inputs[j], lists);
+            for (k = 0; k < NB_LINK_LISTS; k++, n++) {
+                refs[n].list  = lists[k];
+                refs[n].first = n;
+            }
+        }
+    }
+    qsort(refs, nb_slots, sizeof(*refs), cmp_list_ref);
+    for (n = 1; n < nb_slots; n++)
+        if (refs[n].list == refs[n - 1].list)
+            refs[n].first = refs[n - 1].first;
+
+    KEY_PUT(key, graph->disable_auto_convert);
+    key_put_string(key, graph->scale_sws_opts);
+    key_put_string(key, graph->aresample_swr_opts);
+    KEY_PUT(key, graph->nb_filters);
+
+    for (i = n = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+
+        key_put_string(key, f->filter->name);
+        KEY_PUT(key, f->nb_inputs);
+        KEY_PUT(key, f->nb_outputs);
+
+        for (j = 0; j < f->nb_inputs; j++) {
+            AVFilterLink *link = f->inputs[j];
+            const void *lists[NB_LINK_LISTS];
+            int src    = get_filter_index(graph, link->src);
+            int srcpad = FF_OUTLINK_IDX(link);
+
+            KEY_PUT(key, src);
+            KEY_PUT(key, srcpad);
+            KEY_PUT(key, link->type);
+
+            get_link_lists(link, lists);
+            for (k = 0; k < NB_LINK_LISTS; k++, n++) {
+                ListRef ref = { lists[k] }, *found;
+
+                if (!lists[k]) {
+                    KEY_PUT(key, (int){ -1 });
+                    continue;
+                }
+                found = bsearch(&ref, refs, nb_slots, sizeof(*refs),
+                                cmp_list_ref_ptr);
+                KEY_PUT(key, found->first);
+                if (found->first != n)
+                    continue;
+
+                if (k < 4) {
+                    const AVFilterFormats *l = lists[k];
+                    KEY_PUT(key, l->nb_formats);
+                    av_bprint_append_data(key, (const char *)l->formats,
+                                          l->nb_formats * sizeof(*l->formats));
+                } else {
+                    const AVFilterChannelLayouts *l = lists[k];
+                    KEY_PUT(key, l->nb_channel_layouts);
+                    KEY_PUT(key, l->all_layouts);
+                    KEY_PUT(key, l->all_counts);
+                    av_bprint_append_data(key, (const char *)l->channel_layouts,
+                                          l->nb_channel_layouts * sizeof(*l->channel_layouts));
+                }
+            }
+        }
+    }
+    av_free(refs);
+
+    return av_bprint_is_complete(key) ? 0 : AVERROR(ENOMEM);
+}
+
+/**
+ * Set the formats of all the links of the graph from the cache, inserting
+ * the conversion filters the negotiation inserted.
+ */
+static int formats_cache_apply(AVFilterGraph *graph,
+                               const AVFilterFormatsCache *cache,
+                               AVClass *log_ctx)
+{
+    int i, j, n = 0, ret;
+
+    for (i = 0; i < cache->nb_converters; i++) {
+        AVFilterLink *link = get_link(graph, cache->converters[i].link);
+        AVFilterContext *convert;
+
+        if (!link)
+            return AVERROR_BUG;
+        if ((ret = insert_conversion_filter(graph, link, cache->converters[i].index,
+                                            &convert, log_ctx)) < 0)
+            return ret;
+    }
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+
+        for (j = 0; j < f->nb_inputs; j++, n++) {
+            AVFilterLink *link = f->inputs[j];
+
+            if (n >= cache->nb_links)
+                return AVERROR_BUG;
+            link->format         = cache->links[n].format;
+            link->sample_rate    = cache->links[n].sample_rate;
+            link->channel_layout = cache->links[n].channel_layout;
+            link->channels       = cache->links[n].channels;
+
+            ff_formats_unref(&link->incfg.formats);
+            ff_formats_unref(&link->outcfg.formats);
+            ff_formats_unref(&link->incfg.samplerates);
+            ff_formats_unref(&link->outcfg.samplerates);
+            ff_channel_layouts_unref(&link->incfg.channel_layouts);
+            ff_channel_layouts_unref(&link->outcfg.channel_layouts);
+        }
+    }
+    if (n != cache->nb_links)
+        return AVERROR_BUG;
+
+    av_log(graph, AV_LOG_VERBOSE, "Reusing the formats negotiated by a previous graph\n");
+    return 0;
+}
+
+/**
+ * Compute the key of the graph into *pending, and configure the formats
+ * from graph->formats_cache if it matches.
+ * @return 1 if the formats were set from the cache, 0 if they must be
+ *         negotiated, a negative error code on failure
+ */
+static int formats_cache_lookup(AVFilterGraph *graph,
+                                AVFilterFormatsCache **pending,
+                                AVClass *log_ctx)
+{
+    AVFilterFormatsCache *cache = graph->formats_cache;
+    AVBPrint key;
+    int i, ret;
+
+    /* Filters which need the formats of their neighbours are not handled,
+       the lists would not describe the graph completely. */
+    for (i = 0; i < graph->nb_filters; i++) {
+        if (!formats_declared(graph->filters[i])) {
+            avfilter_formats_cache_free(pending);
+            return 0;
+        }
+    }
+
+    av_bprint_init(&key, 0, AV_BPRINT_SIZE_UNLIMITED);
+    ret = formats_cache_make_key(graph, &key);
+    if (ret < 0) {
+        av_bprint_finalize(&key, NULL);
+        return ret;
+    }
+    (*pending)->key_size = key.len;
+    if ((ret = av_bprint_finalize(&key, &(*pending)->key)) < 0)
+        return ret;
+
+    if (cache->key && cache->key_size == (*pending)->key_size &&
+        !memcmp(cache->key, (*pending)->key, cache->key_size)) {
+        avfilter_formats_cache_free(pending);
+        if ((ret = formats_cache_apply(graph, cache, log_ctx)) < 0)
+            return ret;
+        return 1;
+    }
+    return 0;
+}
+
+static int formats_cache_store(AVFilterGraph *graph, AVFilterFormatsCache *pending)
+{
+    int i, j, n = 0;
+
+    for (i = 0; i < graph->nb_filters; i++)
+        pending->nb_links += graph->filters[i]->nb_inputs;
+    pending->links = av_malloc_array(FFMAX(pending->nb_links, 1),
+                                     sizeof(*pending->links));
+    if (!pending->links)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *f = graph->filters[i];
+
+        for (j = 0; j < f->nb_inputs; j++, n++) {
+            AVFilterLink *link = f->inputs[j];
+
+            pending->links[n].format         = link->format;
+            pending->links[n].sample_rate    = link->sample_rate;
+            pending->links[n].channel_layout = link->channel_layout;
+            pending->links[n].channels       = link->channels;
+        }
+    }
+
+    formats_cache_reset(graph->formats_cache);
+    FFSWAP(AVFilterFormatsCache, *graph->formats_cache, *pending);
+    return 0;
+}
+
 /**
  * Perform one round of query_formats() and merging formats lists on the
  * filter graph.
- * @return  >=0 if all links formats lists could be queried and merged;
+ * @param pending if *pending is set, the description of the graph and the
+ *                conversion filters inserted are recorded in it
+ * @return  >=0 if all links formats lists could be queried and merged,
+ *          1 if they were set from graph->formats_cache;
  *          AVERROR(EAGAIN) some progress was made in the queries or merging
  *          and a later call may succeed;
  *          AVERROR(EIO) (may be changed) plus a log message if no progress
  *          was made and the negotiation is stuck;
  *          a negative error code if some other error happened
  */
-static int query_formats(AVFilterGraph *graph, AVClass *log_ctx)
+static int query_formats(AVFilterGraph *graph, AVFilterFormatsCache **pending,
+                         AVClass *log_ctx)
 {
     int i, j, ret;
     int scaler_count = 0, resampler_count = 0;
@@ -455,6 +859,10 @@ static int query_formats(AVFilterGraph *graph, AVClass *log_ctx)
         count_queried += ret >= 0;
     }
 
+    if (*pending && !(*pending)->key &&
+        (ret = formats_cache_lookup(graph, pending, log_ctx)))
+        return ret;
+
     /* go through and merge as many format lists as possible */
     for (i = 0; i < graph->nb_filters; i++) {
         AVFilterContext *filter = graph->filters[i];
@@ -506,9 +914,8 @@ static int query_formats(AVFilterGraph *graph, AVClass *log_ctx)
 
             if (convert_needed) {
                 AVFilterContext *convert;
-                const AVFilter *filter;
                 AVFilterLink *inlink, *outlink;
-                char inst_name[30];
+                int index;
 
                 if (graph->disable_auto_convert) {
                     av_log(log_ctx, AV_LOG_ERROR,
@@ -519,44 +926,13 @@ static int query_formats(AVFilterGraph *graph, AVClass *log_ctx)
                 }
 
                 /* couldn't merge format lists. auto-insert conversion filter */
-                switch (link->type) {
-                case AVMEDIA_TYPE_VIDEO:
-                    if (!(filter = avfilter_get_by_name("scale"))) {
-                        av_log(log_ctx, AV_LOG_ERROR, "'scale' filter "
-                               "not present, cannot convert pixel formats.\n");
-                        return AVERROR(EINVAL);
-                    }
-
-                    snprintf(inst_name, sizeof(inst_name), "auto_scaler_%d",
-                             scaler_count++);
-
-                    if ((ret = avfilter_graph_create_filter(&convert, filter,
-                                                            inst_name, graph->scale_sws_opts, NULL,
-                                                            graph)) < 0)
-                        return ret;
-                    break;
-                case AVMEDIA_TYPE_AUDIO:
-                    if (!(filter = avfilter_get_by_name("aresample"))) {
-                        av_log(log_ctx, AV_LOG_ERROR, "'aresample' filter "
-                               "not present, cannot convert audio formats.\n");
-                        return AVERROR(EINVAL);
-                    }
-
-                    snprintf(inst_name, sizeof(inst_name), "auto_resampler_%d",
-                             resampler_count++);
-                    if ((ret = avfilter_graph_create_filter(&convert, filter,
-                                                            inst_name, graph->aresample_swr_opts,
-                                                            NULL, graph)) < 0)
-                        return ret;
-                    break;
-                default:
-                    return AVERROR(EINVAL);
-                }
-
-                if ((ret = avfilter_insert_filter(link, convert, 0, 0)) < 0)
+                index = link->type == AVMEDIA_TYPE_VIDEO ? scaler_count++ :
+                                                           resampler_count++;
+                if (*pending &&
+                    (ret = formats_cache_add_converter(*pending, graph, link, index)) < 0)
                     return ret;
-
-                if ((ret = filter_query_formats(convert)) < 0)
+                if ((ret = insert_conversion_filter(graph, link, index,
+                                                    &convert, log_ctx)) < 0)
                     return ret;
 
                 inlink  = convert->inputs[0];
@@ -1147,19 +1523,25 @@ static int pick_formats(AVFilterGraph *graph)
  */
 static int graph_config_formats(AVFilterGraph *graph, AVClass *log_ctx)
 {
+    AVFilterFormatsCache *pending = NULL;
     int ret;
 
+    if (graph->formats_cache && !(pending = avfilter_formats_cache_alloc()))
+        return AVERROR(ENOMEM);
+
     /* find supported formats from sub-filters, and merge along links */
-    while ((ret = query_formats(graph, log_ctx)) == AVERROR(EAGAIN))
+    while ((ret = query_formats(graph, &pending, log_ctx)) == AVERROR(EAGAIN))
         av_log(graph, AV_LOG_DEBUG, "query_formats not finished\n");
-    if (ret < 0)
-        return ret;
+    if (ret) {
+        avfilter_formats_cache_free(&pending);
+        return ret < 0 ? ret : 0;
+    }
 
     /* Once everything is merged, it's possible that we'll still have
      * multiple valid media format choices. We try to minimize the amount
      * of format conversion inside filters */
     if ((ret = reduce_formats(graph)) < 0)
-        return ret;
+        goto end;
 
     /* for audio filters, ensure the best format, sample rate and channel layout
      * is selected */
@@ -1168,9 +1550,14 @@ static int graph_config_formats(AVFilterGraph *graph, AVClass *log_ctx)
     swap_channel_layouts(graph);
 
     if ((ret = pick_formats(graph)) < 0)
-        return ret;
+        goto end;
 
-    return 0;
+    if (pending)
+        ret = formats_cache_store(graph, pending);
+
+end:
+    avfilter_formats_cache_free(&pending);
+    return ret;
 }
 
 static int graph_config_pointers(AVFilterGraph *graph,
@@ -1233,6 +1620,86 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
     return 0;
 }
 
+static int can_reconfigure(AVFilterContext *f)
+{
+    unsigned i;
+
+    if (!f->filter->reconfigure) {
+        av_log(f, AV_LOG_VERBOSE, "Filter does not support reconfiguration.\n");
+        return 0;
+    }
+    for (i = 0; i < f->nb_outputs; i++) {
+        AVFilterLink *l = f->outputs[i];
+
+        /* only the frame size may change, and no frame of the previous
+         * size may be left on the way */
+        if (l->type != AVMEDIA_TYPE_VIDEO || l->hw_frames_ctx ||
+            l->status_in || l->status_out ||
+            ff_framequeue_queued_frames(&l->fifo)) {
+            av_log(f, AV_LOG_VERBOSE, "Output %s cannot be reconfigured.\n",
+                   f->output_pads[i].name);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int avfilter_graph_reconfigure(AVFilterGraph *graph, AVFilterContext *src)
+{
+    AVFilterContext **filters;
+    unsigned nb_filters = 0, i, j, k;
+    int ret = 0;
+
+    filters = av_malloc_array(graph->nb_filters, sizeof(*filters));
+    if (!filters)
+        return AVERROR(ENOMEM);
+
+    /* collect src and the filters after it, each once */
+    filters[nb_filters++] = src;
+    for (i = 0; i < nb_filters; i++) {
+        AVFilterContext *f = filters[i];
+
+        if (!can_reconfigure(f)) {
+            ret = AVERROR(ENOSYS);
+            goto end;
+        }
+        for (j = 0; j < f->nb_outputs; j++) {
+            AVFilterContext *dst = f->outputs[j]->dst;
+
+            for (k = 0; k < nb_filters && filters[k] != dst; k++);
+            if (k == nb_filters)
+                filters[nb_filters++] = dst;
+        }
+    }
+
+    for (i = 0; i < nb_filters; i++) {
+        ret = filters[i]->filter->reconfigure(filters[i]);
+        if (ret < 0)
+            goto end;
+    }
+
+    /* the default properties are set again by avfilter_config_links() */
+    for (i = 0; i < nb_filters; i++) {
+        for (j = 0; j < filters[i]->nb_outputs; j++) {
+            AVFilterLink *l = filters[i]->outputs[j];
+
+            l->init_state = AVLINK_UNINIT;
+            l->w = l->h = 0;
+            l->sample_aspect_ratio = (AVRational){ 0, 0 };
+        }
+    }
+    for (i = 0; i < nb_filters; i++) {
+        ret = avfilter_config_links(filters[i]);
+        if (ret < 0)
+            goto end;
+    }
+    ret = graph_check_links(graph, NULL);
+
+end:
+    av_free(filters);
+    return ret;
+}
+
 int avfilter_graph_send_command(AVFilterGraph *graph, const char *target, const char *cmd, const char *arg, char *res, int res_len, int flags)
 {
     int i, r = AVERROR(ENOSYS);
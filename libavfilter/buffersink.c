@@ -231,6 +231,13 @@ MAKE_AVFILTERLINK_ACCESSOR(AVBufferRef *    , hw_frames_ctx      )
                    buf->field ## _size, (int)sizeof(*buf->field)); \
             return AVERROR(EINVAL); \
         }
+static int reconfigure(AVFilterContext *ctx)
+{
+    BufferSinkContext *buf = ctx->priv;
+
+    return buf->peeked_frame ? AVERROR(ENOSYS) : 0;
+}
+
 static int vsink_query_formats(AVFilterContext *ctx)
 {
     BufferSinkContext *buf = ctx->priv;
@@ -343,6 +350,7 @@ AVFilter ff_vsink_buffer = {
     .init          = common_init,
     .query_formats = vsink_query_formats,
     .activate      = activate,
+    .reconfigure   = reconfigure,
     .inputs        = avfilter_vsink_buffer_inputs,
     .outputs       = NULL,
 };
@@ -418,6 +418,20 @@ static int config_props(AVFilterLink *link)
     return 0;
 }
 
+static int reconfigure_video(AVFilterContext *ctx)
+{
+    BufferSourceContext *c = ctx->priv;
+    AVFilterLink *link = ctx->outputs[0];
+
+    /* the formats are not negotiated again */
+    if (c->pix_fmt != link->format || c->hw_frames_ctx ||
+        av_cmp_q(c->time_base, link->time_base) ||
+        av_cmp_q(c->frame_rate, link->frame_rate))
+        return AVERROR(ENOSYS);
+
+    return 0;
+}
+
 static int request_frame(AVFilterLink *link)
 {
     BufferSourceContext *c = link->src->priv;
@@ -446,6 +460,7 @@ AVFilter ff_vsrc_buffer = {
 
     .init      = init_video,
     .uninit    = uninit,
+    .reconfigure = reconfigure_video,
 
     .inputs    = NULL,
     .outputs   = avfilter_vsrc_buffer_outputs,
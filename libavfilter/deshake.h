@@ -52,11 +52,20 @@ typedef struct Transform {
 
 #define MAX_R 64
 
+typedef struct DeshakeSlice {
+    int counts[2*MAX_R+1][2*MAX_R+1]; ///< Motion vector histogram of the slice
+    int nb_angles;             ///< Number of block angles found in the slice
+    int center_x;              ///< Sum of the horizontal block shifts
+    int center_y;              ///< Sum of the vertical block shifts
+} DeshakeSlice;
+
 typedef struct DeshakeContext {
     const AVClass *class;
     int counts[2*MAX_R+1][2*MAX_R+1]; /// < Scratch buffer for motion search
     double *angles;            ///< Scratch buffer for block angles
     unsigned angles_size;
+    DeshakeSlice *slices;      ///< Per-job motion search scratch buffers
+    int nb_threads;
     AVFrame *ref;              ///< Previous frame
     int rx;                    ///< Maximum horizontal shift
     int ry;                    ///< Maximum vertical shift
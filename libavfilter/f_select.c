@@ -154,6 +154,8 @@ typedef struct SelectContext {
     ff_scene_sad_fn sad;            ///< Sum of the absolute difference function (scene detect only)
     double prev_mafd;               ///< previous MAFD                           (scene detect only)
     AVFrame *prev_picref;           ///< previous frame                          (scene detect only)
+    int export_sad;                 ///< export the SAD in the frame metadata    (scene detect only)
+    int reuse_sad;                  ///< use the SAD found in the frame metadata (scene detect only)
     double select;
     int select_out;                 ///< mark the selected output pad index
     int nb_outputs;
@@ -166,6 +168,8 @@ static const AVOption filt_name##_options[] = {                     \
     { "e",    "set an expression to use for selecting frames", OFFSET(expr_str), AV_OPT_TYPE_STRING, { .str = "1" }, .flags=FLAGS }, \
     { "outputs", "set the number of outputs", OFFSET(nb_outputs), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, .flags=FLAGS }, \
     { "n",       "set the number of outputs", OFFSET(nb_outputs), AV_OPT_TYPE_INT, {.i64 = 1}, 1, INT_MAX, .flags=FLAGS }, \
+    { "export_sad", "export the frame SAD in the metadata", OFFSET(export_sad), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, .flags=FLAGS }, \
+    { "reuse_sad",  "use the frame SAD found in the metadata", OFFSET(reuse_sad), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, .flags=FLAGS }, \
     { NULL }                                                            \
 }
 
@@ -279,20 +283,18 @@ static double get_scene_score(AVFilterContext *ctx, AVFrame *frame)
     if (prev_picref &&
         frame->height == prev_picref->height &&
         frame->width  == prev_picref->width) {
-        uint64_t sad = 0;
+        uint64_t sad;
         double mafd, diff;
         uint64_t count = 0;
 
-        for (int plane = 0; plane < select->nb_planes; plane++) {
-            uint64_t plane_sad;
-            select->sad(prev_picref->data[plane], prev_picref->linesize[plane],
-                    frame->data[plane], frame->linesize[plane],
-                    select->width[plane], select->height[plane], &plane_sad);
-            sad += plane_sad;
+        for (int plane = 0; plane < select->nb_planes; plane++)
             count += select->width[plane] * select->height[plane];
-        }
+        sad = ff_scene_sad_frame(ctx, select->sad, frame, prev_picref,
+                                 select->width, select->height,
+                                 select->nb_planes,
+                                 select->export_sad * SCENE_SAD_EXPORT |
+                                 select->reuse_sad  * SCENE_SAD_REUSE);
 
-        emms_c();
         mafd = (double)sad / count / (1ULL << (select->bitdepth - 8));
         diff = fabs(mafd - select->prev_mafd);
         ret  = av_clipf(FFMIN(mafd, diff) / 100., 0, 1);
@@ -549,6 +551,6 @@ AVFilter ff_vf_select = {
     .priv_size     = sizeof(SelectContext),
     .priv_class    = &select_class,
     .inputs        = avfilter_vf_select_inputs,
-    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS | AVFILTER_FLAG_SLICE_THREADS,
 };
 #endif /* CONFIG_SELECT_FILTER */
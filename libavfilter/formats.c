@@ -93,16 +93,13 @@ do {                                                                       \
     MERGE_REF(a, b, fmts, type, return AVERROR(ENOMEM););                  \
 } while (0)
 
-static int merge_formats_internal(AVFilterFormats *a, AVFilterFormats *b,
+static int merge_formats_pairwise(AVFilterFormats *a, AVFilterFormats *b,
                                   enum AVMediaType type, int check)
 {
     int i, j;
     int alpha1=0, alpha2=0;
     int chroma1=0, chroma2=0;
 
-    if (a == b)
-        return 1;
-
     /* Do not lose chroma or alpha in merging.
        It happens if both lists have formats with chroma (resp. alpha), but
        the only formats in common do not have it (e.g. YUV+gray vs.
@@ -132,6 +129,73 @@ static int merge_formats_internal(AVFilterFormats *a, AVFilterFormats *b,
     return 1;
 }
 
+#define FORMATS_SET_WORDS ((FFMAX((int)AV_PIX_FMT_NB, (int)AV_SAMPLE_FMT_NB) + 63) / 64)
+
+static int in_formats_set(const uint64_t *set, int fmt)
+{
+    return (unsigned)fmt < FORMATS_SET_WORDS * 64 &&
+           set[fmt >> 6] >> (fmt & 63) & 1;
+}
+
+/**
+ * Same as merge_formats_pairwise(), but the formats of b are looked up in
+ * a bitset, which makes merging large lists linear instead of quadratic.
+ */
+static int merge_formats_internal(AVFilterFormats *a, AVFilterFormats *b,
+                                  enum AVMediaType type, int check)
+{
+    uint64_t set[FORMATS_SET_WORDS] = { 0 };
+    int i, k = 0;
+    int alpha_a = 0, alpha_b = 0, alpha1 = 0;
+    int chroma_a = 0, chroma_b = 0, chroma1 = 0;
+
+    if (a == b)
+        return 1;
+
+    for (i = 0; i < b->nb_formats; i++) {
+        unsigned fmt = b->formats[i];
+        if (fmt >= FORMATS_SET_WORDS * 64)
+            return merge_formats_pairwise(a, b, type, check);
+        set[fmt >> 6] |= UINT64_C(1) << (fmt & 63);
+    }
+
+    /* Do not lose chroma or alpha in merging, see merge_formats_pairwise() */
+    if (type == AVMEDIA_TYPE_VIDEO && a->nb_formats && b->nb_formats) {
+        for (i = 0; i < b->nb_formats; i++) {
+            const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(b->formats[i]);
+            alpha_b  |= desc->flags & AV_PIX_FMT_FLAG_ALPHA;
+            chroma_b |= desc->nb_components > 1;
+        }
+        for (i = 0; i < a->nb_formats; i++) {
+            const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(a->formats[i]);
+            alpha_a  |= desc->flags & AV_PIX_FMT_FLAG_ALPHA;
+            chroma_a |= desc->nb_components > 1;
+            if (in_formats_set(set, a->formats[i])) {
+                alpha1  |= desc->flags & AV_PIX_FMT_FLAG_ALPHA;
+                chroma1 |= desc->nb_components > 1;
+            }
+        }
+        if ((alpha_a & alpha_b) > alpha1 || (chroma_a & chroma_b) > chroma1)
+            return 0;
+    }
+
+    for (i = 0; i < a->nb_formats; i++)
+        if (in_formats_set(set, a->formats[i])) {
+            if (check)
+                return 1;
+            a->formats[k++] = a->formats[i];
+        }
+    /* Notice that both a and b are unchanged if there is no common format. */
+    if (!k)
+        return 0;
+    av_assert2(!check);
+    a->nb_formats = k;
+
+    MERGE_REF(a, b, formats, AVFilterFormats, return AVERROR(ENOMEM););
+
+    return 1;
+}
+
 int ff_can_merge_formats(const AVFilterFormats *a, const AVFilterFormats *b,
                          enum AVMediaType type)
 {
@@ -100,9 +100,14 @@ int ff_framesync_init(FFFrameSync *fs, AVFilterContext *parent, unsigned nb_in)
 
 static void framesync_eof(FFFrameSync *fs)
 {
+    int ret = 0;
+
     fs->eof = 1;
     fs->frame_ready = 0;
-    ff_outlink_set_status(fs->parent->outputs[0], AVERROR_EOF, AV_NOPTS_VALUE);
+    if (fs->on_eof)
+        ret = fs->on_eof(fs);
+    ff_outlink_set_status(fs->parent->outputs[0], ret < 0 ? ret : AVERROR_EOF,
+                          AV_NOPTS_VALUE);
 }
 
 static void framesync_sync_level_update(FFFrameSync *fs)
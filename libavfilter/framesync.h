@@ -171,6 +171,14 @@ typedef struct FFFrameSync {
      */
     int (*on_event)(struct FFFrameSync *fs);
 
+    /**
+     * Callback called when the end of the output is reached, before the
+     * EOF status is set on the output; optional. Filters which delay frames
+     * can output them from it. A negative return value is set as the
+     * status of the output instead of EOF.
+     */
+    int (*on_eof)(struct FFFrameSync *fs);
+
     /**
      * Opaque pointer, not used by the API
      */
@@ -134,6 +134,10 @@ struct AVFilterGraphInternal {
 
 struct AVFilterInternal {
     avfilter_execute_func *execute;
+
+    int64_t nb_runs;
+    int64_t wall_time;
+    int64_t cpu_time;
 };
 
 /**
@@ -374,6 +378,12 @@ int ff_filter_get_nb_threads(AVFilterContext *ctx);
 int ff_filter_process_command(AVFilterContext *ctx, const char *cmd,
                               const char *arg, char *res, int res_len, int flags);
 
+/**
+ * Reconfiguration callback for the filters whose state is entirely set up
+ * by the config_props callbacks of their pads, see AVFilter.reconfigure.
+ */
+int ff_filter_reconfigure_stateless(AVFilterContext *ctx);
+
 /**
  * Perform any additional setup required for hardware frames.
  *
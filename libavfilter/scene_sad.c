@@ -21,6 +21,11 @@
  * Scene SAD functions
  */
 
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libavutil/dict.h"
+#include "internal.h"
 #include "scene_sad.h"
 
 void ff_scene_sad16_c(SCENE_SAD_PARAMS)
@@ -70,3 +75,109 @@ ff_scene_sad_fn ff_scene_sad_get_fn(int depth)
     return sad;
 }
 
+
+#define MAX_JOBS 64
+
+typedef struct ThreadData {
+    ff_scene_sad_fn sad;
+    const AVFrame *frame, *ref;
+    const ptrdiff_t *width, *height;
+    int plane_mask;                 ///< planes to compute
+    uint64_t sum[MAX_JOBS][4];
+} ThreadData;
+
+static int sad_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ThreadData *td = arg;
+
+    for (int plane = 0; plane < 4; plane++) {
+        const int slice_start = (td->height[plane] *  jobnr   ) / nb_jobs;
+        const int slice_end   = (td->height[plane] * (jobnr+1)) / nb_jobs;
+        const ptrdiff_t linesize1 = td->frame->linesize[plane];
+        const ptrdiff_t linesize2 = td->ref->linesize[plane];
+
+        td->sum[jobnr][plane] = 0;
+        if (!(td->plane_mask & (1 << plane)) || slice_start >= slice_end)
+            continue;
+
+        td->sad(td->frame->data[plane] + slice_start * linesize1, linesize1,
+                td->ref->data[plane]   + slice_start * linesize2, linesize2,
+                td->width[plane], slice_end - slice_start, &td->sum[jobnr][plane]);
+    }
+    emms_c();
+    return 0;
+}
+
+uint64_t ff_scene_sad_frame(AVFilterContext *ctx, ff_scene_sad_fn sad,
+                            AVFrame *frame, const AVFrame *ref,
+                            const ptrdiff_t *width, const ptrdiff_t *height,
+                            int nb_planes, int flags)
+{
+    ThreadData td = { .sad = sad, .frame = frame, .ref = ref,
+                      .width = width, .height = height };
+    uint64_t plane_sad[4] = { 0 }, sum = 0;
+    char key[32];
+    int reuse = 0, nb_jobs = 0;
+
+    if (flags & SCENE_SAD_REUSE && ref->pts != AV_NOPTS_VALUE) {
+        /* the SAD is only valid for the frame it was computed on */
+        AVDictionaryEntry *pts = av_dict_get(frame->metadata, "lavfi.scene_sad.ref_pts", NULL, 0);
+        AVDictionaryEntry *w   = av_dict_get(frame->metadata, "lavfi.scene_sad.w",       NULL, 0);
+        AVDictionaryEntry *h   = av_dict_get(frame->metadata, "lavfi.scene_sad.h",       NULL, 0);
+        AVDictionaryEntry *fmt = av_dict_get(frame->metadata, "lavfi.scene_sad.format",  NULL, 0);
+
+        reuse = pts && w && h && fmt &&
+                strtoll(pts->value, NULL, 10) == ref->pts &&
+                strtol(w->value,   NULL, 10) == frame->width  &&
+                strtol(h->value,   NULL, 10) == frame->height &&
+                strtol(fmt->value, NULL, 10) == frame->format;
+    }
+
+    for (int plane = 0; plane < nb_planes; plane++) {
+        AVDictionaryEntry *e;
+
+        if (!width[plane])
+            continue;
+        snprintf(key, sizeof(key), "lavfi.scene_sad.%d", plane);
+        if (reuse && (e = av_dict_get(frame->metadata, key, NULL, 0))) {
+            plane_sad[plane] = strtoull(e->value, NULL, 10);
+        } else {
+            td.plane_mask |= 1 << plane;
+            nb_jobs = FFMAX(nb_jobs, height[plane]);
+        }
+    }
+
+    if (td.plane_mask) {
+        nb_jobs = FFMIN3(nb_jobs, ff_filter_get_nb_threads(ctx), MAX_JOBS);
+        ctx->internal->execute(ctx, sad_slice, &td, NULL, nb_jobs);
+        for (int plane = 0; plane < nb_planes; plane++) {
+            if (!(td.plane_mask & (1 << plane)))
+                continue;
+            for (int j = 0; j < nb_jobs; j++)
+                plane_sad[plane] += td.sum[j][plane];
+        }
+    }
+
+    if (flags & SCENE_SAD_EXPORT && ref->pts != AV_NOPTS_VALUE) {
+        if (!reuse) {
+            for (int plane = 0; plane < 4; plane++) {
+                snprintf(key, sizeof(key), "lavfi.scene_sad.%d", plane);
+                av_dict_set(&frame->metadata, key, NULL, 0);
+            }
+        }
+        av_dict_set_int(&frame->metadata, "lavfi.scene_sad.ref_pts", ref->pts, 0);
+        av_dict_set_int(&frame->metadata, "lavfi.scene_sad.w",       frame->width,  0);
+        av_dict_set_int(&frame->metadata, "lavfi.scene_sad.h",       frame->height, 0);
+        av_dict_set_int(&frame->metadata, "lavfi.scene_sad.format",  frame->format, 0);
+        for (int plane = 0; plane < nb_planes; plane++) {
+            if (!width[plane])
+                continue;
+            snprintf(key, sizeof(key), "lavfi.scene_sad.%d", plane);
+            av_dict_set_int(&frame->metadata, key, plane_sad[plane], 0);
+        }
+    }
+
+    for (int plane = 0; plane < nb_planes; plane++)
+        sum += plane_sad[plane];
+    return sum;
+}
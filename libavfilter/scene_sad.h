@@ -41,4 +41,25 @@ ff_scene_sad_fn ff_scene_sad_get_fn_x86(int depth);
 
 ff_scene_sad_fn ff_scene_sad_get_fn(int depth);
 
+/**
+ * Compute the sum of absolute differences of the planes of two frames, each
+ * plane being split in slices over the threads of the filter. Planes with a
+ * width of 0 are skipped.
+ *
+ * With SCENE_SAD_REUSE, the SAD of a plane is taken from the
+ * "lavfi.scene_sad.<plane>" metadata of frame instead when an earlier filter
+ * exported it against a reference with the same pts as ref, as given by
+ * "lavfi.scene_sad.ref_pts", and for a frame of the same size and format.
+ *
+ * @param flags a combination of SCENE_SAD_EXPORT and SCENE_SAD_REUSE
+ * @return the sum of the SAD of all the planes
+ */
+uint64_t ff_scene_sad_frame(AVFilterContext *ctx, ff_scene_sad_fn sad,
+                            AVFrame *frame, const AVFrame *ref,
+                            const ptrdiff_t *width, const ptrdiff_t *height,
+                            int nb_planes, int flags);
+
+#define SCENE_SAD_EXPORT (1 << 0) ///< export the SAD of the planes to the frame metadata
+#define SCENE_SAD_REUSE  (1 << 1) ///< use the SAD found in the frame metadata
+
 #endif /* AVFILTER_SCENE_SAD_H */
@@ -0,0 +1,160 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Configure graphs through one AVFilterFormatsCache and check that the
+ * formats reused from the cache are the ones a negotiation finds.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/bprint.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/log.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/samplefmt.h"
+
+#include "libavfilter/avfilter.h"
+
+static const char *const graphs[] = {
+    /* a scaler is inserted before format and hflip, an aresample before aformat */
+    "buffer=video_size=64x48:pix_fmt=yuv420p:time_base=1/25:pixel_aspect=1/1,"
+    "format=rgb24,hflip,format=gray,buffersink;"
+    "abuffer=sample_rate=48000:sample_fmt=s16:channel_layout=stereo:time_base=1/48000,"
+    "aformat=sample_fmts=fltp:sample_rates=44100:channel_layouts=mono,abuffersink",
+    /* the same graph but for a different source format */
+    "buffer=video_size=64x48:pix_fmt=nv12:time_base=1/25:pixel_aspect=1/1,"
+    "format=rgb24,hflip,format=gray,buffersink;"
+    "abuffer=sample_rate=48000:sample_fmt=s16:channel_layout=stereo:time_base=1/48000,"
+    "aformat=sample_fmts=fltp:sample_rates=44100:channel_layouts=mono,abuffersink",
+};
+
+static int nb_reused;
+
+static void log_callback(void *ptr, int level, const char *fmt, va_list vl)
+{
+    if (level <= AV_LOG_VERBOSE && strstr(fmt, "Reusing the formats"))
+        nb_reused++;
+    if (level <= AV_LOG_ERROR)
+        av_log_default_callback(ptr, level, fmt, vl);
+}
+
+/* describe the filters of the graph and the negotiated formats of their inputs */
+static void describe(AVBPrint *bp, const AVFilterGraph *graph)
+{
+    int i, j;
+
+    for (i = 0; i < graph->nb_filters; i++) {
+        const AVFilterContext *f = graph->filters[i];
+
+        av_bprintf(bp, "%s (%s)", f->name, f->filter->name);
+        for (j = 0; j < f->nb_inputs; j++) {
+            const AVFilterLink *l = f->inputs[j];
+            char layout[64];
+
+            if (l->type == AVMEDIA_TYPE_VIDEO) {
+                av_bprintf(bp, " <- %s %s", l->src->name,
+                           av_get_pix_fmt_name(l->format));
+            } else {
+                av_get_channel_layout_string(layout, sizeof(layout),
+                                             l->channels, l->channel_layout);
+                av_bprintf(bp, " <- %s %s %dHz %s", l->src->name,
+                           av_get_sample_fmt_name(l->format),
+                           l->sample_rate, layout);
+            }
+        }
+        av_bprintf(bp, "\n");
+    }
+}
+
+static int configure(const char *desc, AVFilterFormatsCache *cache, AVBPrint *bp)
+{
+    AVFilterGraph *graph = avfilter_graph_alloc();
+    int ret;
+
+    if (!graph)
+        return AVERROR(ENOMEM);
+    graph->formats_cache = cache;
+
+    ret = avfilter_graph_parse_ptr(graph, desc, NULL, NULL, NULL);
+    if (ret >= 0)
+        ret = avfilter_graph_config(graph, NULL);
+    if (ret >= 0)
+        describe(bp, graph);
+
+    avfilter_graph_free(&graph);
+    return ret;
+}
+
+/* configure the graph through the cache and compare to a negotiation */
+static int test_graph(int idx, AVFilterFormatsCache *cache)
+{
+    AVBPrint ref, bp;
+    int ret, reused;
+
+    av_bprint_init(&ref, 0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprint_init(&bp,  0, AV_BPRINT_SIZE_UNLIMITED);
+
+    ret = configure(graphs[idx], NULL, &ref);
+    if (ret < 0)
+        goto end;
+
+    reused = nb_reused;
+    ret = configure(graphs[idx], cache, &bp);
+    if (ret < 0)
+        goto end;
+
+    printf("graph %d: %s, %s\n", idx,
+           nb_reused > reused ? "reused" : "negotiated",
+           strcmp(ref.str, bp.str) ? "differs" : "identical");
+    if (strcmp(ref.str, bp.str))
+        printf("%s", bp.str);
+
+end:
+    av_bprint_finalize(&ref, NULL);
+    av_bprint_finalize(&bp,  NULL);
+    return ret;
+}
+
+int main(void)
+{
+    static const int order[] = { 0, 0, 1, 1, 0 };
+    AVFilterFormatsCache *cache;
+    AVBPrint bp;
+    int i, ret = 0;
+
+    av_log_set_callback(log_callback);
+    av_log_set_level(AV_LOG_VERBOSE);
+
+    cache = avfilter_formats_cache_alloc();
+    if (!cache)
+        return 1;
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    ret = configure(graphs[0], NULL, &bp);
+    if (ret >= 0)
+        printf("%s", bp.str);
+    av_bprint_finalize(&bp, NULL);
+
+    for (i = 0; ret >= 0 && i < FF_ARRAY_ELEMS(order); i++)
+        ret = test_graph(order[i], cache);
+
+    avfilter_formats_cache_free(&cache);
+    return ret < 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Change the frame size of the source of configured graphs with
+ * avfilter_graph_reconfigure(), and rebuild the graph as a caller must when
+ * it returns AVERROR(ENOSYS).
+ */
+
+#include <stdio.h>
+
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/mem.h"
+
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/buffersrc.h"
+
+typedef struct Test {
+    const char *name;
+    const char *filters;
+    enum AVPixelFormat format;  ///< of the frames after the change
+    int queue_frame;            ///< leave a frame of the previous size queued
+} Test;
+
+static const Test tests[] = {
+    { "in place",            "hflip,vflip",        AV_PIX_FMT_YUV420P },
+    { "in place, scaled",    "hflip,scale=64:48",  AV_PIX_FMT_YUV420P },
+    { "unsupported filter",  "crop=32:24",         AV_PIX_FMT_YUV420P },
+    { "pixel format change", "hflip",              AV_PIX_FMT_YUV444P },
+    { "frame queued",        "hflip",              AV_PIX_FMT_YUV420P, 1 },
+};
+
+static int build_graph(AVFilterGraph **graph, AVFilterContext **src, AVFilterContext **sink,
+                       const char *filters, int w, int h, enum AVPixelFormat format)
+{
+    char desc[256];
+    int ret;
+
+    avfilter_graph_free(graph);
+    *graph = avfilter_graph_alloc();
+    if (!*graph)
+        return AVERROR(ENOMEM);
+
+    snprintf(desc, sizeof(desc),
+             "buffer@in=video_size=%dx%d:pix_fmt=%d:time_base=1/25:pixel_aspect=1/1,"
+             "%s,buffersink@out", w, h, format, filters);
+    if ((ret = avfilter_graph_parse_ptr(*graph, desc, NULL, NULL, NULL)) < 0 ||
+        (ret = avfilter_graph_config(*graph, NULL)) < 0)
+        return ret;
+
+    *src  = avfilter_graph_get_filter(*graph, "buffer@in");
+    *sink = avfilter_graph_get_filter(*graph, "buffersink@out");
+    return *src && *sink ? 0 : AVERROR_BUG;
+}
+
+static int send_frame(AVFilterContext *src, int w, int h, enum AVPixelFormat format,
+                      int64_t pts, int flags)
+{
+    AVFrame *frame = av_frame_alloc();
+    ptrdiff_t linesize[4];
+    int ret, i;
+
+    if (!frame)
+        return AVERROR(ENOMEM);
+    frame->width  = w;
+    frame->height = h;
+    frame->format = format;
+    frame->pts    = pts;
+    frame->sample_aspect_ratio = (AVRational){ 1, 1 };
+    ret = av_frame_get_buffer(frame, 0);
+    if (ret >= 0) {
+        for (i = 0; i < 4; i++)
+            linesize[i] = frame->linesize[i];
+        ret = av_image_fill_black(frame->data, linesize, format, AVCOL_RANGE_MPEG, w, h);
+    }
+    if (ret >= 0)
+        ret = av_buffersrc_add_frame_flags(src, frame, flags);
+    av_frame_free(&frame);
+    return ret;
+}
+
+static int receive_frame(AVFilterContext *sink, int *w, int *h)
+{
+    AVFrame *frame = av_frame_alloc();
+    int ret;
+
+    if (!frame)
+        return AVERROR(ENOMEM);
+    ret = av_buffersink_get_frame(sink, frame);
+    *w = frame->width;
+    *h = frame->height;
+    av_frame_free(&frame);
+    return ret;
+}
+
+static int run_test(const Test *t)
+{
+    AVFilterGraph *graph = NULL;
+    AVFilterContext *src, *sink;
+    AVBufferSrcParameters *par = NULL;
+    int w, h, ret;
+
+    ret = build_graph(&graph, &src, &sink, t->filters, 32, 24, AV_PIX_FMT_YUV420P);
+    if (ret < 0)
+        goto end;
+    if ((ret = send_frame(src, 32, 24, AV_PIX_FMT_YUV420P, 0, 0)) < 0)
+        goto end;
+    if (!t->queue_frame && (ret = receive_frame(sink, &w, &h)) < 0)
+        goto end;
+
+    par = av_buffersrc_parameters_alloc();
+    if (!par) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    par->format = t->format;
+    par->width  = 96;
+    par->height = 72;
+    if ((ret = av_buffersrc_parameters_set(src, par)) < 0)
+        goto end;
+
+    ret = avfilter_graph_reconfigure(graph, src);
+    if (ret == AVERROR(ENOSYS)) {
+        /* the fallback: build a new graph for the new parameters */
+        printf("%s: ENOSYS", t->name);
+        ret = build_graph(&graph, &src, &sink, t->filters, 96, 72, t->format);
+        if (ret < 0)
+            goto end;
+        printf(", rebuilt");
+    } else if (ret < 0) {
+        goto end;
+    } else {
+        printf("%s: reconfigured", t->name);
+    }
+
+    if ((ret = send_frame(src, 96, 72, t->format, 1, 0)) < 0 ||
+        (ret = receive_frame(sink, &w, &h)) < 0)
+        goto end;
+    printf(", output %dx%d, sink %dx%d\n", w, h,
+           av_buffersink_get_w(sink), av_buffersink_get_h(sink));
+
+end:
+    if (ret < 0)
+        printf("%s: failed: %s\n", t->name, av_err2str(ret));
+    av_free(par);
+    avfilter_graph_free(&graph);
+    return ret;
+}
+
+int main(void)
+{
+    int i, ret = 0;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(tests); i++)
+        if (run_test(&tests[i]) < 0)
+            ret = 1;
+
+    return ret;
+}
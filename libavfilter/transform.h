@@ -132,4 +132,22 @@ int avfilter_transform(const uint8_t *src, uint8_t *dst,
                         enum InterpolateMethod interpolate,
                         enum FillMethod fill);
 
+/**
+ * Do an affine transformation of the rows [slice_start, slice_end) of the
+ * destination image. Apart from the row range this behaves exactly like
+ * avfilter_transform(), so disjoint slices can be processed in parallel
+ * from the same source image.
+ *
+ * @param slice_start first destination row to transform
+ * @param slice_end   row after the last destination row to transform
+ * @see avfilter_transform()
+ * @return negative on error
+ */
+int ff_transform_slice(const uint8_t *src, uint8_t *dst,
+                       int src_stride, int dst_stride,
+                       int width, int height, int slice_start, int slice_end,
+                       const float *matrix,
+                       enum InterpolateMethod interpolate,
+                       enum FillMethod fill);
+
 #endif /* AVFILTER_TRANSFORM_H */
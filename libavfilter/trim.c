@@ -215,6 +215,7 @@ AVFilter ff_vf_trim = {
     .priv_class  = &trim_class,
     .inputs      = trim_inputs,
     .outputs     = trim_outputs,
+    .reconfigure = ff_filter_reconfigure_stateless,
 };
 #endif // CONFIG_TRIM_FILTER
 
@@ -42,6 +42,11 @@ typedef struct CropDetectContext {
     int frame_nb;
     int max_pixsteps[4];
     int max_outliers;
+
+    int *row_total;     ///< checkline() result of each row still to be scanned
+    int *col_total;     ///< checkline() result of each column still to be scanned
+    int *col_sums;      ///< per-slice partial column sums
+    int nb_threads;
 } CropDetectContext;
 
 static int query_formats(AVFilterContext *ctx)
@@ -69,7 +74,7 @@ static int query_formats(AVFilterContext *ctx)
     return ff_set_common_formats(ctx, fmts_list);
 }
 
-static int checkline(void *ctx, const unsigned char *src, int stride, int len, int bpp)
+static int checkline(const unsigned char *src, int stride, int len, int bpp)
 {
     int total = 0;
     int div = len;
@@ -120,10 +125,79 @@ static int checkline(void *ctx, const unsigned char *src, int stride, int len, i
     }
     total /= div;
 
-    av_log(ctx, AV_LOG_DEBUG, "total:%d\n", total);
     return total;
 }
 
+static void sum_columns(int *sums, const uint8_t *src, int x_start, int x_end, int bpp)
+{
+    const uint16_t *src16 = (const uint16_t *)src;
+    int x;
+
+    switch (bpp) {
+    case 1:
+        for (x = x_start; x < x_end; x++)
+            sums[x] += src[x];
+        break;
+    case 2:
+        for (x = x_start; x < x_end; x++)
+            sums[x] += src16[x];
+        break;
+    case 3:
+    case 4:
+        for (x = x_start; x < x_end; x++)
+            sums[x] += src[x*bpp] + src[x*bpp + 1] + src[x*bpp + 2];
+        break;
+    }
+}
+
+/**
+ * Compute the totals of the rows and the partial sums of the columns which
+ * may be visited when scanning for the borders, i.e. the ones outside of
+ * the current crop area.
+ */
+static int analyze_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    CropDetectContext *s = ctx->priv;
+    const AVFrame *frame = arg;
+    const int bpp = s->max_pixsteps[0];
+    const int w = frame->width;
+    const int slice_start = (frame->height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (frame->height * (jobnr+1)) / nb_jobs;
+    const int x1 = FFMIN(s->x1, w), x2 = FFMAX(s->x2 + 1, x1);
+    int *col_sums = s->col_sums + jobnr * w;
+    int y;
+
+    memset(col_sums,      0, x1       * sizeof(*col_sums));
+    memset(col_sums + x2, 0, (w - x2) * sizeof(*col_sums));
+
+    for (y = slice_start; y < slice_end; y++) {
+        const uint8_t *src = frame->data[0] + y * frame->linesize[0];
+
+        if (y < s->y1 || y > s->y2)
+            s->row_total[y] = checkline(src, bpp, w, bpp);
+
+        sum_columns(col_sums, src, 0,  x1, bpp);
+        sum_columns(col_sums, src, x2, w,  bpp);
+    }
+
+    return 0;
+}
+
+static void merge_columns(CropDetectContext *s, int x_start, int x_end,
+                          int w, int h, int nb_jobs)
+{
+    const int div = h * (s->max_pixsteps[0] >= 3 ? 3 : 1);
+    int x, j;
+
+    for (x = x_start; x < x_end; x++) {
+        int total = 0;
+        for (j = 0; j < nb_jobs; j++)
+            total += s->col_sums[j * w + x];
+        s->col_total[x] = total / div;
+    }
+}
+
+
 static av_cold int init(AVFilterContext *ctx)
 {
     CropDetectContext *s = ctx->priv;
@@ -152,9 +226,28 @@ static int config_input(AVFilterLink *inlink)
     s->x2 = 0;
     s->y2 = 0;
 
+    s->nb_threads = FFMAX(ff_filter_get_nb_threads(ctx), 1);
+    av_freep(&s->row_total);
+    av_freep(&s->col_total);
+    av_freep(&s->col_sums);
+    s->row_total = av_calloc(inlink->h, sizeof(*s->row_total));
+    s->col_total = av_calloc(inlink->w, sizeof(*s->col_total));
+    s->col_sums  = av_calloc(inlink->w, s->nb_threads * sizeof(*s->col_sums));
+    if (!s->row_total || !s->col_total || !s->col_sums)
+        return AVERROR(ENOMEM);
+
     return 0;
 }
 
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    CropDetectContext *s = ctx->priv;
+
+    av_freep(&s->row_total);
+    av_freep(&s->col_total);
+    av_freep(&s->col_sums);
+}
+
 #define SET_META(key, value) \
     av_dict_set_int(metadata, key, value, 0)
 
@@ -162,10 +255,9 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
 {
     AVFilterContext *ctx = inlink->dst;
     CropDetectContext *s = ctx->priv;
-    int bpp = s->max_pixsteps[0];
     int w, h, x, y, shrink_by;
     AVDictionary **metadata;
-    int outliers, last_y;
+    int outliers, last_y, nb_jobs;
     int limit = lrint(s->limit);
 
     // ignore first s->skip frames
@@ -181,10 +273,16 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
             s->frame_nb = 1;
         }
 
-#define FIND(DST, FROM, NOEND, INC, STEP0, STEP1, LEN) \
+        nb_jobs = FFMIN(frame->height, s->nb_threads);
+        ctx->internal->execute(ctx, analyze_slice, frame, NULL, nb_jobs);
+        merge_columns(s, 0, FFMIN(s->x1, frame->width), frame->width, frame->height, nb_jobs);
+        merge_columns(s, FFMAX(s->x2 + 1, s->x1), frame->width, frame->width, frame->height, nb_jobs);
+
+#define FIND(DST, FROM, NOEND, INC, TOTAL) \
         outliers = 0;\
         for (last_y = y = FROM; NOEND; y = y INC) {\
-            if (checkline(ctx, frame->data[0] + STEP0 * y, STEP1, LEN, bpp) > limit) {\
+            av_log(ctx, AV_LOG_DEBUG, "total:%d\n", TOTAL[y]);\
+            if (TOTAL[y] > limit) {\
                 if (++outliers > s->max_outliers) { \
                     DST = last_y;\
                     break;\
@@ -193,11 +291,10 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *frame)
                 last_y = y INC;\
         }
 
-        FIND(s->y1,                 0,               y < s->y1, +1, frame->linesize[0], bpp, frame->width);
-        FIND(s->y2, frame->height - 1, y > FFMAX(s->y2, s->y1), -1, frame->linesize[0], bpp, frame->width);
-        FIND(s->x1,                 0,               y < s->x1, +1, bpp, frame->linesize[0], frame->height);
-        FIND(s->x2,  frame->width - 1, y > FFMAX(s->x2, s->x1), -1, bpp, frame->linesize[0], frame->height);
-
+        FIND(s->y1,                 0,               y < s->y1, +1, s->row_total);
+        FIND(s->y2, frame->height - 1, y > FFMAX(s->y2, s->y1), -1, s->row_total);
+        FIND(s->x1,                 0,               y < s->x1, +1, s->col_total);
+        FIND(s->x2,  frame->width - 1, y > FFMAX(s->x2, s->x1), -1, s->col_total);
 
         // round x and y (up), important for yuv colorspaces
         // make sure they stay rounded!
@@ -280,8 +377,9 @@ AVFilter ff_vf_cropdetect = {
     .priv_size     = sizeof(CropDetectContext),
     .priv_class    = &cropdetect_class,
     .init          = init,
+    .uninit        = uninit,
     .query_formats = query_formats,
     .inputs        = avfilter_vf_cropdetect_inputs,
     .outputs       = avfilter_vf_cropdetect_outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
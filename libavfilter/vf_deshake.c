@@ -225,6 +225,54 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
            diff;
 }
 
+typedef struct MotionThreadData {
+    uint8_t *src1, *src2;
+    int width, height, stride;
+    int nb_rows, nb_cols;
+} MotionThreadData;
+
+static int find_motion_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DeshakeContext *deshake = ctx->priv;
+    MotionThreadData *td = arg;
+    DeshakeSlice *slice = &deshake->slices[jobnr];
+    const int row_start = (td->nb_rows *  jobnr     ) / nb_jobs;
+    const int row_end   = (td->nb_rows * (jobnr + 1)) / nb_jobs;
+    double *angles = deshake->angles + row_start * td->nb_cols;
+    IntMotionVector mv = {0, 0};
+    int contrast;
+    int x, y, row;
+
+    for (x = 0; x < deshake->rx * 2 + 1; x++)
+        memset(slice->counts[x], 0, (deshake->ry * 2 + 1) * sizeof(slice->counts[x][0]));
+    slice->nb_angles = 0;
+    slice->center_x  = 0;
+    slice->center_y  = 0;
+
+    for (row = row_start; row < row_end; row++) {
+        y = deshake->ry + row * deshake->blocksize * 2;
+        // We use a width of 16 here to match the sad function
+        for (x = deshake->rx; x < td->width - deshake->rx - 16; x += 16) {
+            // If the contrast is too low, just skip this block as it probably
+            // won't be very useful to us.
+            contrast = block_contrast(td->src2, x, y, td->stride, deshake->blocksize);
+            if (contrast > deshake->contrast) {
+                find_block_motion(deshake, td->src1, td->src2, x, y, td->stride, &mv);
+                if (mv.x != -1 && mv.y != -1) {
+                    slice->counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
+                    if (x > deshake->rx && y > deshake->ry)
+                        angles[slice->nb_angles++] = block_angle(x, y, 0, 0, &mv);
+
+                    slice->center_x += mv.x;
+                    slice->center_y += mv.y;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
 /**
  * Find the estimated global motion for a scene given the most likely shift
  * for each block in the frame. The global motion is estimated to be the
@@ -232,19 +280,31 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
  * move one pixel to the right and two pixels down, this would yield a
  * motion vector (1, -2).
  */
-static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
-                        int width, int height, int stride, Transform *t)
+static int find_motion(AVFilterContext *ctx, uint8_t *src1, uint8_t *src2,
+                       int width, int height, int stride, Transform *t)
 {
-    int x, y;
-    IntMotionVector mv = {0, 0};
+    DeshakeContext *deshake = ctx->priv;
+    MotionThreadData td;
+    int x, y, i, j;
     int count_max_value = 0;
-    int contrast;
+    int nb_jobs;
 
     int pos;
     int center_x = 0, center_y = 0;
     double p_x, p_y;
 
-    av_fast_malloc(&deshake->angles, &deshake->angles_size, width * height / (16 * deshake->blocksize) * sizeof(*deshake->angles));
+    td.src1    = src1;
+    td.src2    = src2;
+    td.width   = width;
+    td.height  = height;
+    td.stride  = stride;
+    // Number of blocks visited by the search loops below
+    td.nb_rows = FFMAX(0, (height - 2 * deshake->ry - 1) / (deshake->blocksize * 2));
+    td.nb_cols = FFMAX(0, (width  - 2 * deshake->rx - 1) / 16);
+
+    av_fast_malloc(&deshake->angles, &deshake->angles_size, FFMAX(td.nb_rows * td.nb_cols, 1) * sizeof(*deshake->angles));
+    if (!deshake->angles)
+        return AVERROR(ENOMEM);
 
     // Reset counts to zero
     for (x = 0; x < deshake->rx * 2 + 1; x++) {
@@ -253,27 +313,27 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
         }
     }
 
-    pos = 0;
-    // Find motion for every block and store the motion vector in the counts
-    for (y = deshake->ry; y < height - deshake->ry - (deshake->blocksize * 2); y += deshake->blocksize * 2) {
-        // We use a width of 16 here to match the sad function
-        for (x = deshake->rx; x < width - deshake->rx - 16; x += 16) {
-            // If the contrast is too low, just skip this block as it probably
-            // won't be very useful to us.
-            contrast = block_contrast(src2, x, y, stride, deshake->blocksize);
-            if (contrast > deshake->contrast) {
-                //av_log(NULL, AV_LOG_ERROR, "%d\n", contrast);
-                find_block_motion(deshake, src1, src2, x, y, stride, &mv);
-                if (mv.x != -1 && mv.y != -1) {
-                    deshake->counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
-                    if (x > deshake->rx && y > deshake->ry)
-                        deshake->angles[pos++] = block_angle(x, y, 0, 0, &mv);
+    // Find motion for every block row in parallel, each job keeping its
+    // own histogram and angles, then merge them in row order so the result
+    // does not depend on the number of threads
+    nb_jobs = FFMIN(td.nb_rows, deshake->nb_threads);
+    if (nb_jobs > 0)
+        ctx->internal->execute(ctx, find_motion_slice, &td, NULL, nb_jobs);
 
-                    center_x += mv.x;
-                    center_y += mv.y;
-                }
-            }
-        }
+    pos = 0;
+    for (i = 0; i < nb_jobs; i++) {
+        const DeshakeSlice *slice = &deshake->slices[i];
+        const int row_start = (td.nb_rows * i) / nb_jobs;
+
+        for (x = 0; x < deshake->rx * 2 + 1; x++)
+            for (j = 0; j < deshake->ry * 2 + 1; j++)
+                deshake->counts[x][j] += slice->counts[x][j];
+
+        memmove(deshake->angles + pos, deshake->angles + row_start * td.nb_cols,
+                slice->nb_angles * sizeof(*deshake->angles));
+        pos      += slice->nb_angles;
+        center_x += slice->center_x;
+        center_y += slice->center_y;
     }
 
     if (pos) {
@@ -310,6 +370,34 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
     t->angle = av_clipf(t->angle, -0.1, 0.1);
 
     //av_log(NULL, AV_LOG_ERROR, "%d x %d\n", avg->x, avg->y);
+    return 0;
+}
+
+typedef struct TransformThreadData {
+    AVFrame *in, *out;
+    const float *matrix[3];
+    int plane_w[3], plane_h[3];
+    enum InterpolateMethod interpolate;
+    enum FillMethod fill;
+} TransformThreadData;
+
+static int transform_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    TransformThreadData *td = arg;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        const int h = td->plane_h[i];
+        const int slice_start = (h *  jobnr     ) / nb_jobs;
+        const int slice_end   = (h * (jobnr + 1)) / nb_jobs;
+
+        ff_transform_slice(td->in->data[i], td->out->data[i],
+                           td->in->linesize[i], td->out->linesize[i],
+                           td->plane_w[i], h, slice_start, slice_end,
+                           td->matrix[i], td->interpolate, td->fill);
+    }
+
+    return 0;
 }
 
 static int deshake_transform_c(AVFilterContext *ctx,
@@ -318,24 +406,27 @@ static int deshake_transform_c(AVFilterContext *ctx,
                                     enum InterpolateMethod interpolate,
                                     enum FillMethod fill, AVFrame *in, AVFrame *out)
 {
-    int i = 0, ret = 0;
-    const float *matrixs[3];
-    int plane_w[3], plane_h[3];
-    matrixs[0] = matrix_y;
-    matrixs[1] =  matrixs[2] = matrix_uv;
-    plane_w[0] = width;
-    plane_w[1] = plane_w[2] = cw;
-    plane_h[0] = height;
-    plane_h[1] = plane_h[2] = ch;
+    DeshakeContext *deshake = ctx->priv;
+    TransformThreadData td;
 
-    for (i = 0; i < 3; i++) {
-        // Transform the luma and chroma planes
-        ret = avfilter_transform(in->data[i], out->data[i], in->linesize[i], out->linesize[i],
-                                 plane_w[i], plane_h[i], matrixs[i], interpolate, fill);
-        if (ret < 0)
-            return ret;
-    }
-    return ret;
+    if ((unsigned)interpolate >= INTERPOLATE_COUNT)
+        return AVERROR(EINVAL);
+
+    td.in  = in;
+    td.out = out;
+    td.matrix[0] = matrix_y;
+    td.matrix[1] = td.matrix[2] = matrix_uv;
+    td.plane_w[0] = width;
+    td.plane_w[1] = td.plane_w[2] = cw;
+    td.plane_h[0] = height;
+    td.plane_h[1] = td.plane_h[2] = ch;
+    td.interpolate = interpolate;
+    td.fill        = fill;
+
+    // Transform the luma and chroma planes
+    ctx->internal->execute(ctx, transform_slice, &td, NULL,
+                           FFMIN(ch, deshake->nb_threads));
+    return 0;
 }
 
 static av_cold int init(AVFilterContext *ctx)
@@ -388,6 +479,12 @@ static int config_props(AVFilterLink *link)
 {
     DeshakeContext *deshake = link->dst->priv;
 
+    deshake->nb_threads = ff_filter_get_nb_threads(link->dst);
+    av_freep(&deshake->slices);
+    deshake->slices = av_calloc(deshake->nb_threads, sizeof(*deshake->slices));
+    if (!deshake->slices)
+        return AVERROR(ENOMEM);
+
     deshake->ref = NULL;
     deshake->last.vec.x = 0;
     deshake->last.vec.y = 0;
@@ -403,6 +500,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&deshake->ref);
     av_freep(&deshake->angles);
     deshake->angles_size = 0;
+    av_freep(&deshake->slices);
     if (deshake->fp)
         fclose(deshake->fp);
 }
@@ -437,7 +535,7 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
 
     if (deshake->cx < 0 || deshake->cy < 0 || deshake->cw < 0 || deshake->ch < 0) {
         // Find the most likely global motion for the current frame
-        find_motion(deshake, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
+        ret = find_motion(link->dst, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
     } else {
         uint8_t *src1 = (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0];
         uint8_t *src2 = in->data[0];
@@ -454,9 +552,12 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         src1 += deshake->cy * in->linesize[0] + deshake->cx;
         src2 += deshake->cy * in->linesize[0] + deshake->cx;
 
-        find_motion(deshake, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+        ret = find_motion(link->dst, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+    }
+    if (ret < 0) {
+        av_frame_free(&in);
+        goto fail;
     }
-
 
     // Copy transform so we can output it later to compare to the smoothed value
     orig.vec.x = t.vec.x;
@@ -560,4 +661,5 @@ AVFilter ff_vf_deshake = {
     .inputs        = deshake_inputs,
     .outputs       = deshake_outputs,
     .priv_class    = &deshake_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -70,6 +70,9 @@
 #include FT_GLYPH_H
 #include FT_STROKER_H
 
+/* text blocks are only blended with several threads from this height on */
+#define MIN_SLICE_ROWS 32
+
 static const char *const var_names[] = {
     "dar",
     "hsub", "vsub",
@@ -140,6 +143,18 @@ enum expansion_mode {
     EXP_STRFTIME,
 };
 
+/**
+ * Coverage of a whole laid out text block, pre-rendered from the glyph
+ * bitmaps so that it can be blended in a single pass.
+ */
+typedef struct TextMask {
+    uint8_t *data;
+    unsigned int size;
+    int linesize;
+    int x, y;                       ///< offset relative to the text origin
+    int w, h;
+} TextMask;
+
 typedef struct DrawTextContext {
     const AVClass *class;
     int exp_mode;                   ///< expansion mode to use for the text
@@ -203,6 +218,12 @@ typedef struct DrawTextContext {
     int text_shaping;               ///< 1 to shape the text before drawing it
 #endif
     AVDictionary *metadata;
+
+    char *layout_text;              ///< expanded text the cached layout was computed for
+    unsigned int layout_fontsize;   ///< font size the cached layout was computed for
+    int layout_w, layout_h;         ///< size of the cached text block
+    TextMask text_mask;             ///< pre-rendered text of the cached layout
+    TextMask border_mask;           ///< pre-rendered border of the cached layout
 } DrawTextContext;
 
 #define OFFSET(x) offsetof(DrawTextContext, x)
@@ -815,6 +836,11 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_freep(&s->positions);
     s->nb_positions = 0;
 
+    av_freep(&s->layout_text);
+    av_freep(&s->text_mask.data);
+    av_freep(&s->border_mask.data);
+    s->text_mask.size = s->border_mask.size = 0;
+
     av_tree_enumerate(s->glyphs, NULL, NULL, glyph_enu_free);
     av_tree_destroy(s->glyphs);
     s->glyphs = NULL;
@@ -1215,51 +1241,139 @@ static int expand_text(AVFilterContext *ctx, char *text, AVBPrint *bp)
     return 0;
 }
 
-static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
-                       int width, int height,
-                       FFDrawColor *color,
-                       int x, int y, int borderw)
+static int render_mask(DrawTextContext *s, TextMask *mask, int borderw)
 {
     char *text = s->expanded_text.str;
     uint32_t code = 0;
-    int i, x1, y1;
+    int i, pass, x1, y1;
+    int x_min = INT_MAX, y_min = INT_MAX, x_max = INT_MIN, y_max = INT_MIN;
     uint8_t *p;
     Glyph *glyph = NULL;
 
-    for (i = 0, p = text; *p; i++) {
-        FT_Bitmap bitmap;
-        Glyph dummy = { 0 };
-        GET_UTF8(code, *p ? *p++ : 0, code = 0xfffd; goto continue_on_invalid;);
+    mask->w = mask->h = 0;
+
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0, p = text; *p; i++) {
+            FT_Bitmap bitmap;
+            Glyph dummy = { 0 };
+            GET_UTF8(code, *p ? *p++ : 0, code = 0xfffd; goto continue_on_invalid;);
 continue_on_invalid:
 
-        /* skip new line chars, just go to new line */
-        if (code == '\n' || code == '\r' || code == '\t')
-            continue;
+            /* skip new line chars, just go to new line */
+            if (code == '\n' || code == '\r' || code == '\t')
+                continue;
 
-        dummy.code = code;
-        dummy.fontsize = s->fontsize;
-        glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
+            dummy.code = code;
+            dummy.fontsize = s->fontsize;
+            glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
 
-        bitmap = borderw ? glyph->border_bitmap : glyph->bitmap;
+            bitmap = borderw ? glyph->border_bitmap : glyph->bitmap;
 
-        if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
-            glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
-            return AVERROR(EINVAL);
+            if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
+                glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
+                return AVERROR(EINVAL);
 
-        x1 = s->positions[i].x+s->x+x - borderw;
-        y1 = s->positions[i].y+s->y+y - borderw;
+            if (!bitmap.width || !bitmap.rows)
+                continue;
+
+            x1 = s->positions[i].x - borderw;
+            y1 = s->positions[i].y - borderw;
+
+            if (!pass) {
+                x_min = FFMIN(x_min, x1);
+                y_min = FFMIN(y_min, y1);
+                x_max = FFMAX(x_max, x1 + (int)bitmap.width);
+                y_max = FFMAX(y_max, y1 + (int)bitmap.rows);
+            } else {
+                uint8_t *dst = mask->data + (y1 - mask->y) * mask->linesize + x1 - mask->x;
+                int x, y;
+
+                /* combine overlapping glyphs the same way successive
+                 * blending would */
+                for (y = 0; y < bitmap.rows; y++) {
+                    const uint8_t *src = bitmap.buffer + y * bitmap.pitch;
+                    for (x = 0; x < bitmap.width; x++) {
+                        int a = bitmap.pixel_mode == FT_PIXEL_MODE_MONO ?
+                                (src[x >> 3] >> (7 - (x & 7)) & 1) * 255 : src[x];
+                        dst[x] += ((255 - dst[x]) * a + 127) / 255;
+                    }
+                    dst += mask->linesize;
+                }
+            }
+        }
 
-        ff_blend_mask(&s->dc, color,
-                      frame->data, frame->linesize, width, height,
-                      bitmap.buffer, bitmap.pitch,
-                      bitmap.width, bitmap.rows,
-                      bitmap.pixel_mode == FT_PIXEL_MODE_MONO ? 0 : 3,
-                      0, x1, y1);
+        if (!pass) {
+            if (x_min >= x_max || y_min >= y_max)
+                return 0;
+
+            mask->x        = x_min;
+            mask->y        = y_min;
+            mask->w        = x_max - x_min;
+            mask->h        = y_max - y_min;
+            mask->linesize = FFALIGN(mask->w, 32);
+            av_fast_malloc(&mask->data, &mask->size, mask->linesize * mask->h);
+            if (!mask->data) {
+                mask->w = mask->h = 0;
+                return AVERROR(ENOMEM);
+            }
+            memset(mask->data, 0, mask->linesize * mask->h);
+        }
     }
 
     return 0;
 }
 
+typedef struct ThreadData {
+    AVFrame *frame;
+    FFDrawColor *color;
+    const TextMask *mask;
+    int x, y;
+} ThreadData;
+
+static int blend_mask_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DrawTextContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const TextMask *mask = td->mask;
+    AVFrame *frame = td->frame;
+    /* keep band boundaries on chroma rows, so no row is blended twice */
+    const int align = 1 << s->dc.vsub_max;
+    int y_start = (td->y + (mask->h *  jobnr     ) / nb_jobs) & ~(align - 1);
+    int y_end   = (td->y + (mask->h * (jobnr + 1)) / nb_jobs) & ~(align - 1);
+
+    if (!jobnr)
+        y_start = td->y;
+    if (jobnr == nb_jobs - 1)
+        y_end = td->y + mask->h;
+    y_start = FFMAX(y_start, td->y);
+    if (y_end <= y_start)
+        return 0;
+
+    ff_blend_mask(&s->dc, td->color,
+                  frame->data, frame->linesize, frame->width, frame->height,
+                  mask->data + (y_start - td->y) * mask->linesize, mask->linesize,
+                  mask->w, y_end - y_start, 3, 0, td->x, y_start);
+
+    return 0;
+}
+
+static void draw_mask(AVFilterContext *ctx, AVFrame *frame, FFDrawColor *color,
+                      const TextMask *mask, int x, int y)
+{
+    ThreadData td;
+
+    if (!mask->w || !mask->h)
+        return;
+
+    td.frame = frame;
+    td.color = color;
+    td.mask  = mask;
+    td.x     = x + mask->x;
+    td.y     = y + mask->y;
+
+    ctx->internal->execute(ctx, blend_mask_slice, &td, NULL,
+                           av_clip(mask->h / MIN_SLICE_ROWS, 1, ff_filter_get_nb_threads(ctx)));
+}
 
 static void update_color_with_alpha(DrawTextContext *s, FFDrawColor *color, const FFDrawColor incolor)
 {
@@ -1283,17 +1397,13 @@ static void update_alpha(DrawTextContext *s)
         s->alpha = 256 * alpha;
 }
 
-static int draw_text(AVFilterContext *ctx, AVFrame *frame,
-                     int width, int height)
+static int compute_layout(AVFilterContext *ctx)
 {
     DrawTextContext *s = ctx->priv;
-    AVFilterLink *inlink = ctx->inputs[0];
-
     uint32_t code = 0, prev_code = 0;
     int x = 0, y = 0, i = 0, ret;
     int max_text_line_w = 0, len;
-    int box_w, box_h;
-    char *text;
+    char *text = s->expanded_text.str;
     uint8_t *p;
     int y_min = 32000, y_max = -32000;
     int x_min = 32000, x_max = -32000;
@@ -1301,44 +1411,8 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     Glyph *glyph = NULL, *prev_glyph = NULL;
     Glyph dummy = { 0 };
 
-    time_t now = time(0);
-    struct tm ltime;
-    AVBPrint *bp = &s->expanded_text;
+    av_freep(&s->layout_text);
 
-    FFDrawColor fontcolor;
-    FFDrawColor shadowcolor;
-    FFDrawColor bordercolor;
-    FFDrawColor boxcolor;
-
-    av_bprint_clear(bp);
-
-    if(s->basetime != AV_NOPTS_VALUE)
-        now= frame->pts*av_q2d(ctx->inputs[0]->time_base) + s->basetime/1000000;
-
-    switch (s->exp_mode) {
-    case EXP_NONE:
-        av_bprintf(bp, "%s", s->text);
-        break;
-    case EXP_NORMAL:
-        if ((ret = expand_text(ctx, s->text, &s->expanded_text)) < 0)
-            return ret;
-        break;
-    case EXP_STRFTIME:
-        localtime_r(&now, &ltime);
-        av_bprint_strftime(bp, s->text, &ltime);
-        break;
-    }
-
-    if (s->tc_opt_string) {
-        char tcbuf[AV_TIMECODE_STR_SIZE];
-        av_timecode_make_string(&s->tc, tcbuf, inlink->frame_count_out);
-        av_bprint_clear(bp);
-        av_bprintf(bp, "%s%s", s->text, tcbuf);
-    }
-
-    if (!av_bprint_is_complete(bp))
-        return AVERROR(ENOMEM);
-    text = s->expanded_text.str;
     if ((len = s->expanded_text.len) > s->nb_positions) {
         if (!(s->positions =
               av_realloc(s->positions, len*sizeof(*s->positions))))
@@ -1346,26 +1420,6 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
         s->nb_positions = len;
     }
 
-    if (s->fontcolor_expr[0]) {
-        /* If expression is set, evaluate and replace the static value */
-        av_bprint_clear(&s->expanded_fontcolor);
-        if ((ret = expand_text(ctx, s->fontcolor_expr, &s->expanded_fontcolor)) < 0)
-            return ret;
-        if (!av_bprint_is_complete(&s->expanded_fontcolor))
-            return AVERROR(ENOMEM);
-        av_log(s, AV_LOG_DEBUG, "Evaluated fontcolor is '%s'\n", s->expanded_fontcolor.str);
-        ret = av_parse_color(s->fontcolor.rgba, s->expanded_fontcolor.str, -1, s);
-        if (ret)
-            return ret;
-        ff_draw_color(&s->dc, &s->fontcolor, s->fontcolor.rgba);
-    }
-
-    x = 0;
-    y = 0;
-
-    if ((ret = update_fontsize(ctx)) < 0)
-        return ret;
-
     /* load and cache glyphs */
     for (i = 0, p = text; *p; i++) {
         GET_UTF8(code, *p ? *p++ : 0, code = 0xfffd; goto continue_on_invalid;);
@@ -1440,6 +1494,94 @@ continue_on_invalid2:
 
     s->var_values[VAR_LINE_H] = s->var_values[VAR_LH] = s->max_glyph_h;
 
+    s->layout_w = max_text_line_w;
+    s->layout_h = y + s->max_glyph_h;
+
+    if ((ret = render_mask(s, &s->text_mask, 0)) < 0)
+        return ret;
+    if (s->borderw && (ret = render_mask(s, &s->border_mask, s->borderw)) < 0)
+        return ret;
+
+    s->layout_fontsize = s->fontsize;
+    s->layout_text     = av_strdup(text);
+    if (!s->layout_text)
+        return AVERROR(ENOMEM);
+
+    return 0;
+}
+
+static int draw_text(AVFilterContext *ctx, AVFrame *frame,
+                     int width, int height)
+{
+    DrawTextContext *s = ctx->priv;
+    AVFilterLink *inlink = ctx->inputs[0];
+
+    int ret;
+    int box_w, box_h;
+
+    time_t now = time(0);
+    struct tm ltime;
+    AVBPrint *bp = &s->expanded_text;
+
+    FFDrawColor fontcolor;
+    FFDrawColor shadowcolor;
+    FFDrawColor bordercolor;
+    FFDrawColor boxcolor;
+
+    av_bprint_clear(bp);
+
+    if(s->basetime != AV_NOPTS_VALUE)
+        now= frame->pts*av_q2d(ctx->inputs[0]->time_base) + s->basetime/1000000;
+
+    switch (s->exp_mode) {
+    case EXP_NONE:
+        av_bprintf(bp, "%s", s->text);
+        break;
+    case EXP_NORMAL:
+        if ((ret = expand_text(ctx, s->text, &s->expanded_text)) < 0)
+            return ret;
+        break;
+    case EXP_STRFTIME:
+        localtime_r(&now, &ltime);
+        av_bprint_strftime(bp, s->text, &ltime);
+        break;
+    }
+
+    if (s->tc_opt_string) {
+        char tcbuf[AV_TIMECODE_STR_SIZE];
+        av_timecode_make_string(&s->tc, tcbuf, inlink->frame_count_out);
+        av_bprint_clear(bp);
+        av_bprintf(bp, "%s%s", s->text, tcbuf);
+    }
+
+    if (!av_bprint_is_complete(bp))
+        return AVERROR(ENOMEM);
+
+    if (s->fontcolor_expr[0]) {
+        /* If expression is set, evaluate and replace the static value */
+        av_bprint_clear(&s->expanded_fontcolor);
+        if ((ret = expand_text(ctx, s->fontcolor_expr, &s->expanded_fontcolor)) < 0)
+            return ret;
+        if (!av_bprint_is_complete(&s->expanded_fontcolor))
+            return AVERROR(ENOMEM);
+        av_log(s, AV_LOG_DEBUG, "Evaluated fontcolor is '%s'\n", s->expanded_fontcolor.str);
+        ret = av_parse_color(s->fontcolor.rgba, s->expanded_fontcolor.str, -1, s);
+        if (ret)
+            return ret;
+        ff_draw_color(&s->dc, &s->fontcolor, s->fontcolor.rgba);
+    }
+
+    if ((ret = update_fontsize(ctx)) < 0)
+        return ret;
+
+    /* the layout only depends on the text and the font size, so reuse it
+     * as long as those do not change */
+    if (!s->layout_text || s->layout_fontsize != s->fontsize ||
+        strcmp(s->layout_text, s->expanded_text.str)) {
+        if ((ret = compute_layout(ctx)) < 0)
+            return ret;
+    }
+
     s->x = s->var_values[VAR_X] = av_expr_eval(s->x_pexpr, s->var_values, &s->prng);
     s->y = s->var_values[VAR_Y] = av_expr_eval(s->y_pexpr, s->var_values, &s->prng);
     /* It is necessary if x is expressed from y  */
@@ -1451,8 +1593,8 @@ continue_on_invalid2:
     update_color_with_alpha(s, &bordercolor, s->bordercolor);
     update_color_with_alpha(s, &boxcolor   , s->boxcolor   );
 
-    box_w = max_text_line_w;
-    box_h = y + s->max_glyph_h;
+    box_w = s->layout_w;
+    box_h = s->layout_h;
 
     if (s->fix_bounds) {
 
@@ -1487,20 +1629,14 @@ continue_on_invalid2:
                            s->x - s->boxborderw, s->y - s->boxborderw,
                            box_w + s->boxborderw * 2, box_h + s->boxborderw * 2);
 
-    if (s->shadowx || s->shadowy) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &shadowcolor, s->shadowx, s->shadowy, 0)) < 0)
-            return ret;
-    }
+    if (s->shadowx || s->shadowy)
+        draw_mask(ctx, frame, &shadowcolor, &s->text_mask,
+                  s->x + s->shadowx, s->y + s->shadowy);
 
-    if (s->borderw) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &bordercolor, 0, 0, s->borderw)) < 0)
-            return ret;
-    }
-    if ((ret = draw_glyphs(s, frame, width, height,
-                           &fontcolor, 0, 0, 0)) < 0)
-        return ret;
+    if (s->borderw)
+        draw_mask(ctx, frame, &bordercolor, &s->border_mask, s->x, s->y);
+
+    draw_mask(ctx, frame, &fontcolor, &s->text_mask, s->x, s->y);
 
     return 0;
 }
@@ -1576,5 +1712,5 @@ AVFilter ff_vf_drawtext = {
     .inputs        = avfilter_vf_drawtext_inputs,
     .outputs       = avfilter_vf_drawtext_outputs,
     .process_command = command,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -73,6 +73,11 @@ enum comb_dbg {
     NB_COMBDBG
 };
 
+typedef struct FieldMatchSums {
+    uint64_t accumPc, accumPm, accumPml;
+    uint64_t accumNc, accumNm, accumNml;
+} FieldMatchSums;
+
 typedef struct FieldMatchContext {
     const AVClass *class;
 
@@ -106,9 +111,12 @@ typedef struct FieldMatchContext {
     int map_linesize[4];
     uint8_t *cmask_data[4];
     int cmask_linesize[4];
-    int *c_array;
+    int *c_array;                   ///< per-slice combed pixel counts
+    int c_array_size;               ///< number of counts in each slice array
     int tpitchy, tpitchuv;
     uint8_t *tbuffer;
+    FieldMatchSums *sums;           ///< per-slice field comparison sums
+    int nb_threads;
 } FieldMatchContext;
 
 #define OFFSET(x) offsetof(FieldMatchContext, x)
@@ -193,81 +201,170 @@ static void fill_buf(uint8_t *data, int w, int h, int linesize, uint8_t v)
     }
 }
 
-static int calc_combed_score(const FieldMatchContext *fm, const AVFrame *src)
+static int comb_mask_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int x, y, plane, max_v = 0;
+    const FieldMatchContext *fm = ctx->priv;
+    const AVFrame *src = arg;
     const int cthresh = fm->cthresh;
     const int cthresh6 = cthresh * 6;
+    int x, y, plane;
 
     for (plane = 0; plane < (fm->chroma ? 3 : 1); plane++) {
-        const uint8_t *srcp = src->data[plane];
         const int src_linesize = src->linesize[plane];
+        const int cmk_linesize = fm->cmask_linesize[plane];
         const int width  = get_width (fm, src, plane);
         const int height = get_height(fm, src, plane);
-        uint8_t *cmkp = fm->cmask_data[plane];
-        const int cmk_linesize = fm->cmask_linesize[plane];
+        const int slice_start = (height *  jobnr   ) / nb_jobs;
+        const int slice_end   = (height * (jobnr+1)) / nb_jobs;
+        const uint8_t *srcp = src->data[plane] + slice_start * src_linesize;
+        uint8_t *cmkp = fm->cmask_data[plane] + slice_start * cmk_linesize;
 
         if (cthresh < 0) {
-            fill_buf(cmkp, width, height, cmk_linesize, 0xff);
+            fill_buf(cmkp, width, slice_end - slice_start, cmk_linesize, 0xff);
             continue;
         }
-        fill_buf(cmkp, width, height, cmk_linesize, 0);
-
-        /* [1 -3 4 -3 1] vertical filter */
-#define FILTER(xm2, xm1, xp1, xp2) \
-        abs(  4 * srcp[x] \
-             -3 * (srcp[x + (xm1)*src_linesize] + srcp[x + (xp1)*src_linesize]) \
-             +    (srcp[x + (xm2)*src_linesize] + srcp[x + (xp2)*src_linesize])) > cthresh6
-
-        /* first line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && FILTER(2, 1, 1, 2))
-                cmkp[x] = 0xff;
-        }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* second line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && s2 > cthresh && FILTER(2, -1, 1, 2))
-                cmkp[x] = 0xff;
-        }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
+        fill_buf(cmkp, width, slice_end - slice_start, cmk_linesize, 0);
+
+        for (y = slice_start; y < slice_end; y++) {
+            /* the lines above the first and below the last ones are mirrored,
+             * so the two outermost lines only compare with one neighbour */
+            const int xm2 = (y >= 2          ? -2 :  2) * src_linesize;
+            const int xm1 = (y >= 1          ? -1 :  1) * src_linesize;
+            const int xp1 = (y <  height - 1 ?  1 : -1) * src_linesize;
+            const int xp2 = (y <  height - 2 ?  2 : -2) * src_linesize;
 
-        /* all lines minus first two and last two */
-        for (y = 2; y < height-2; y++) {
             for (x = 0; x < width; x++) {
-                const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-                const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-                if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, 2))
+                const int s1 = abs(srcp[x] - srcp[x + xm1]);
+                const int s2 = abs(srcp[x] - srcp[x + xp1]);
+                /* [1 -3 4 -3 1] vertical filter */
+                if (s1 > cthresh && s2 > cthresh &&
+                    abs(  4 * srcp[x]
+                         -3 * (srcp[x + xm1] + srcp[x + xp1])
+                         +    (srcp[x + xm2] + srcp[x + xp2])) > cthresh6)
                     cmkp[x] = 0xff;
             }
             srcp += src_linesize;
             cmkp += cmk_linesize;
         }
+    }
+    return 0;
+}
+
+static int get_heighta(const FieldMatchContext *fm, int height)
+{
+    const int yhalf = fm->blocky / 2;
+    const int heighta = (height / yhalf) * yhalf;
+
+    return heighta == height ? height - yhalf : heighta;
+}
+
+#define C_ARRAY_ADD(v) do {                         \
+    const int box1 = (x / blockx) * 4;              \
+    const int box2 = ((x + xhalf) / blockx) * 4;    \
+    c_array[temp1 + box1    ] += v;                 \
+    c_array[temp1 + box2 + 1] += v;                 \
+    c_array[temp2 + box1 + 2] += v;                 \
+    c_array[temp2 + box2 + 3] += v;                 \
+} while (0)
 
-        /* before-last line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            const int s2 = abs(srcp[x] - srcp[x + src_linesize]);
-            if (s1 > cthresh && s2 > cthresh && FILTER(-2, -1, 1, -2))
-                cmkp[x] = 0xff;
+#define VERTICAL_HALF(y_start, y_end) do {                                  \
+    for (y = y_start; y < y_end; y++) {                                     \
+        const int temp1 = (y / blocky) * xblocks4;                          \
+        const int temp2 = ((y + yhalf) / blocky) * xblocks4;                \
+        for (x = 0; x < width; x++)                                         \
+            if (cmkp[x - cmk_linesize] == 0xff &&                           \
+                cmkp[x               ] == 0xff &&                           \
+                cmkp[x + cmk_linesize] == 0xff)                             \
+                C_ARRAY_ADD(1);                                             \
+        cmkp += cmk_linesize;                                               \
+    }                                                                       \
+} while (0)
+
+/**
+ * Count the combed pixels of each block into a per-slice array. The middle
+ * of the frame is split in rows of half blocks, the first slice also takes
+ * the top lines and the last slice the bottom ones.
+ */
+static int comb_count_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    const FieldMatchContext *fm = ctx->priv;
+    const AVFrame *src = arg;
+    const int blockx = fm->blockx;
+    const int blocky = fm->blocky;
+    const int xhalf = blockx/2;
+    const int yhalf = blocky/2;
+    const int cmk_linesize = fm->cmask_linesize[0];
+    const int width  = src->width;
+    const int height = src->height;
+    const int xblocks = ((width+xhalf)/blockx) + 1;
+    const int xblocks4 = xblocks<<2;
+    const int heighta = get_heighta(fm, height);
+    const int widtha  = (width /(blockx/2))*(blockx/2);
+    const int nb_rows = FFMAX(heighta / yhalf - 1, 0);
+    const int row_start = (nb_rows *  jobnr   ) / nb_jobs;
+    const int row_end   = (nb_rows * (jobnr+1)) / nb_jobs;
+    int *c_array = fm->c_array + jobnr * fm->c_array_size;
+    const uint8_t *cmkp;
+    int x, y;
+
+    memset(c_array, 0, fm->c_array_size * sizeof(*c_array));
+
+    if (jobnr == 0) {
+        cmkp = fm->cmask_data[0] + cmk_linesize;
+        VERTICAL_HALF(1, yhalf);
+    }
+
+    for (y = (row_start + 1) * yhalf; y < (row_end + 1) * yhalf; y += yhalf) {
+        const int temp1 = (y / blocky) * xblocks4;
+        const int temp2 = ((y + yhalf) / blocky) * xblocks4;
+
+        cmkp = fm->cmask_data[0] + y * cmk_linesize;
+
+        for (x = 0; x < widtha; x += xhalf) {
+            const uint8_t *cmkp_tmp = cmkp + x;
+            int u, v, sum = 0;
+            for (u = 0; u < yhalf; u++) {
+                for (v = 0; v < xhalf; v++)
+                    if (cmkp_tmp[v - cmk_linesize] == 0xff &&
+                        cmkp_tmp[v               ] == 0xff &&
+                        cmkp_tmp[v + cmk_linesize] == 0xff)
+                        sum++;
+                cmkp_tmp += cmk_linesize;
+            }
+            if (sum)
+                C_ARRAY_ADD(sum);
         }
-        srcp += src_linesize;
-        cmkp += cmk_linesize;
-
-        /* last line */
-        for (x = 0; x < width; x++) {
-            const int s1 = abs(srcp[x] - srcp[x - src_linesize]);
-            if (s1 > cthresh && FILTER(-2, -1, -1, -2))
-                cmkp[x] = 0xff;
+
+        for (x = widtha; x < width; x++) {
+            const uint8_t *cmkp_tmp = cmkp + x;
+            int u, sum = 0;
+            for (u = 0; u < yhalf; u++) {
+                if (cmkp_tmp[-cmk_linesize] == 0xff &&
+                    cmkp_tmp[            0] == 0xff &&
+                    cmkp_tmp[ cmk_linesize] == 0xff)
+                    sum++;
+                cmkp_tmp += cmk_linesize;
+            }
+            if (sum)
+                C_ARRAY_ADD(sum);
         }
     }
 
+    if (jobnr == nb_jobs - 1) {
+        cmkp = fm->cmask_data[0] + (nb_rows + 1) * yhalf * cmk_linesize;
+        VERTICAL_HALF(heighta, height - 1);
+    }
+    return 0;
+}
+
+static int calc_combed_score(AVFilterContext *ctx, AVFrame *src)
+{
+    FieldMatchContext *fm = ctx->priv;
+    int x, y, j, nb_jobs, max_v = 0;
+
+    ctx->internal->execute(ctx, comb_mask_slice, src, NULL,
+                           FFMIN(src->height, fm->nb_threads));
+
     if (fm->chroma) {
         uint8_t *cmkp  = fm->cmask_data[0];
         uint8_t *cmkpU = fm->cmask_data[1];
@@ -301,91 +398,16 @@ static int calc_combed_score(const FieldMatchContext *fm, const AVFrame *src)
         }
     }
 
-    {
-        const int blockx = fm->blockx;
-        const int blocky = fm->blocky;
-        const int xhalf = blockx/2;
-        const int yhalf = blocky/2;
-        const int cmk_linesize = fm->cmask_linesize[0];
-        const uint8_t *cmkp    = fm->cmask_data[0] + cmk_linesize;
-        const int width  = src->width;
-        const int height = src->height;
-        const int xblocks = ((width+xhalf)/blockx) + 1;
-        const int xblocks4 = xblocks<<2;
-        const int yblocks = ((height+yhalf)/blocky) + 1;
-        int *c_array = fm->c_array;
-        const int arraysize = (xblocks*yblocks)<<2;
-        int      heighta = (height/(blocky/2))*(blocky/2);
-        const int widtha = (width /(blockx/2))*(blockx/2);
-        if (heighta == height)
-            heighta = height - yhalf;
-        memset(c_array, 0, arraysize * sizeof(*c_array));
+    nb_jobs = FFMAX(get_heighta(fm, src->height) / (fm->blocky / 2) - 1, 0);
+    nb_jobs = av_clip(nb_jobs, 1, fm->nb_threads);
+    ctx->internal->execute(ctx, comb_count_slice, src, NULL, nb_jobs);
 
-#define C_ARRAY_ADD(v) do {                         \
-    const int box1 = (x / blockx) * 4;              \
-    const int box2 = ((x + xhalf) / blockx) * 4;    \
-    c_array[temp1 + box1    ] += v;                 \
-    c_array[temp1 + box2 + 1] += v;                 \
-    c_array[temp2 + box1 + 2] += v;                 \
-    c_array[temp2 + box2 + 3] += v;                 \
-} while (0)
-
-#define VERTICAL_HALF(y_start, y_end) do {                                  \
-    for (y = y_start; y < y_end; y++) {                                     \
-        const int temp1 = (y / blocky) * xblocks4;                          \
-        const int temp2 = ((y + yhalf) / blocky) * xblocks4;                \
-        for (x = 0; x < width; x++)                                         \
-            if (cmkp[x - cmk_linesize] == 0xff &&                           \
-                cmkp[x               ] == 0xff &&                           \
-                cmkp[x + cmk_linesize] == 0xff)                             \
-                C_ARRAY_ADD(1);                                             \
-        cmkp += cmk_linesize;                                               \
-    }                                                                       \
-} while (0)
-
-        VERTICAL_HALF(1, yhalf);
-
-        for (y = yhalf; y < heighta; y += yhalf) {
-            const int temp1 = (y / blocky) * xblocks4;
-            const int temp2 = ((y + yhalf) / blocky) * xblocks4;
-
-            for (x = 0; x < widtha; x += xhalf) {
-                const uint8_t *cmkp_tmp = cmkp + x;
-                int u, v, sum = 0;
-                for (u = 0; u < yhalf; u++) {
-                    for (v = 0; v < xhalf; v++)
-                        if (cmkp_tmp[v - cmk_linesize] == 0xff &&
-                            cmkp_tmp[v               ] == 0xff &&
-                            cmkp_tmp[v + cmk_linesize] == 0xff)
-                            sum++;
-                    cmkp_tmp += cmk_linesize;
-                }
-                if (sum)
-                    C_ARRAY_ADD(sum);
-            }
-
-            for (x = widtha; x < width; x++) {
-                const uint8_t *cmkp_tmp = cmkp + x;
-                int u, sum = 0;
-                for (u = 0; u < yhalf; u++) {
-                    if (cmkp_tmp[-cmk_linesize] == 0xff &&
-                        cmkp_tmp[            0] == 0xff &&
-                        cmkp_tmp[ cmk_linesize] == 0xff)
-                        sum++;
-                    cmkp_tmp += cmk_linesize;
-                }
-                if (sum)
-                    C_ARRAY_ADD(sum);
-            }
-
-            cmkp += cmk_linesize * yhalf;
-        }
-
-        VERTICAL_HALF(heighta, height - 1);
-
-        for (x = 0; x < arraysize; x++)
-            if (c_array[x] > max_v)
-                max_v = c_array[x];
+    for (x = 0; x < fm->c_array_size; x++) {
+        int sum = fm->c_array[x];
+        for (j = 1; j < nb_jobs; j++)
+            sum += fm->c_array[j * fm->c_array_size + x];
+        if (sum > max_v)
+            max_v = sum;
     }
     return max_v;
 }
@@ -410,22 +432,20 @@ static void build_abs_diff_mask(const uint8_t *prvp, int prv_linesize,
 }
 
 /**
- * Build a map over which pixels differ a lot/a little
+ * Build a map over which pixels differ a lot/a little, for the lines y_start
+ * (included) to y_end (excluded) of the plane
  */
 static void build_diff_map(FieldMatchContext *fm,
-                           const uint8_t *prvp, int prv_linesize,
-                           const uint8_t *nxtp, int nxt_linesize,
                            uint8_t *dstp, int dst_linesize, int height,
-                           int width, int plane)
+                           int width, int plane, int y_start, int y_end)
 {
     int x, y, u, diff, count;
     int tpitch = plane ? fm->tpitchuv : fm->tpitchy;
-    const uint8_t *dp = fm->tbuffer + tpitch;
+    const uint8_t *dp = fm->tbuffer + (y_start >> 1) * tpitch;
 
-    build_abs_diff_mask(prvp, prv_linesize, nxtp, nxt_linesize,
-                        fm->tbuffer, tpitch, width, height>>1);
+    dstp += ((y_start >> 1) - 1) * dst_linesize;
 
-    for (y = 2; y < height - 2; y += 2) {
+    for (y = y_start; y < y_end; y += 2) {
         for (x = 1; x < width - 1; x++) {
             diff = dp[x];
             if (diff > 3) {
@@ -484,17 +504,147 @@ static AVFrame *select_frame(FieldMatchContext *fm, int match)
     else  /* match == mC */              return fm->src;
 }
 
-static int compare_fields(FieldMatchContext *fm, int match1, int match2, int field)
+typedef struct CompareThreadData {
+    int plane, width, height;
+    const uint8_t *diffpf, *diffnf;     ///< fields the difference map is built from
+    uint8_t *diff_map;                  ///< first line of the difference map
+    const uint8_t *mapp;
+    const uint8_t *srcpf, *srcf, *srcnf;
+    const uint8_t *prvpf, *prvnf, *nxtpf, *nxtnf;
+    int map_linesize, srcf_linesize, prvf_linesize, nxtf_linesize;
+    int y0a, y1a, startx, stopx;
+} CompareThreadData;
+
+/* number of lines compared in a plane, every other line from 2 to height-2 */
+static int get_nb_compare_lines(int height)
+{
+    return FFMAX((height - 3) / 2, 0);
+}
+
+static int diff_mask_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    FieldMatchContext *fm = ctx->priv;
+    const CompareThreadData *td = arg;
+    const int tpitch = td->plane ? fm->tpitchuv : fm->tpitchy;
+    const int map_linesize = fm->map_linesize[td->plane];
+    const int nb_lines = td->height >> 1;
+    const int line_start = (nb_lines *  jobnr   ) / nb_jobs;
+    const int line_end   = (nb_lines * (jobnr+1)) / nb_jobs;
+    const int slice_start = (td->height *  jobnr   ) / nb_jobs;
+    const int slice_end   = (td->height * (jobnr+1)) / nb_jobs;
+
+    fill_buf(fm->map_data[td->plane] + slice_start * map_linesize,
+             td->width, slice_end - slice_start, map_linesize, 0);
+
+    build_abs_diff_mask(td->diffpf + line_start * td->prvf_linesize, td->prvf_linesize,
+                        td->diffnf + line_start * td->nxtf_linesize, td->nxtf_linesize,
+                        fm->tbuffer + line_start * tpitch, tpitch,
+                        td->width, line_end - line_start);
+    return 0;
+}
+
+static int diff_map_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
 {
-    int plane, ret;
+    FieldMatchContext *fm = ctx->priv;
+    const CompareThreadData *td = arg;
+    const int nb_lines = get_nb_compare_lines(td->height);
+    const int line_start = (nb_lines *  jobnr   ) / nb_jobs;
+    const int line_end   = (nb_lines * (jobnr+1)) / nb_jobs;
+
+    build_diff_map(fm, td->diff_map, td->map_linesize, td->height, td->width,
+                   td->plane, 2 + 2 * line_start, 2 + 2 * line_end);
+    return 0;
+}
+
+static int compare_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    FieldMatchContext *fm = ctx->priv;
+    const CompareThreadData *td = arg;
+    const int nb_lines = get_nb_compare_lines(td->height);
+    const int line_start = (nb_lines *  jobnr   ) / nb_jobs;
+    const int line_end   = (nb_lines * (jobnr+1)) / nb_jobs;
+    const int map_linesize  = td->map_linesize;
+    const int srcf_linesize = td->srcf_linesize;
+    const int prvf_linesize = td->prvf_linesize;
+    const int nxtf_linesize = td->nxtf_linesize;
+    const int y0a = td->y0a, y1a = td->y1a;
+    const int startx = td->startx, stopx = td->stopx;
+    const uint8_t *mapp  = td->mapp  + line_start * map_linesize;
+    const uint8_t *srcpf = td->srcpf + line_start * srcf_linesize;
+    const uint8_t *srcf  = td->srcf  + line_start * srcf_linesize;
+    const uint8_t *srcnf = td->srcnf + line_start * srcf_linesize;
+    const uint8_t *prvpf = td->prvpf + line_start * prvf_linesize;
+    const uint8_t *prvnf = td->prvnf + line_start * prvf_linesize;
+    const uint8_t *nxtpf = td->nxtpf + line_start * nxtf_linesize;
+    const uint8_t *nxtnf = td->nxtnf + line_start * nxtf_linesize;
+    uint64_t accumPc = 0, accumPm = 0, accumPml = 0;
+    uint64_t accumNc = 0, accumNm = 0, accumNml = 0;
+    FieldMatchSums *sums = &fm->sums[jobnr];
+    int x, y, temp1, temp2;
+
+    for (y = 2 + 2 * line_start; y < 2 + 2 * line_end; y += 2) {
+        if (y0a == y1a || y < y0a || y > y1a) {
+            for (x = startx; x < stopx; x++) {
+                if (mapp[x] > 0 || mapp[x + map_linesize] > 0) {
+                    temp1 = srcpf[x] + (srcf[x] << 2) + srcnf[x]; // [1 4 1]
+
+                    temp2 = abs(3 * (prvpf[x] + prvnf[x]) - temp1);
+                    if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
+                        accumPc += temp2;
+                    if (temp2 > 42) {
+                        if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
+                            accumPm += temp2;
+                        if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
+                            accumPml += temp2;
+                    }
+
+                    temp2 = abs(3 * (nxtpf[x] + nxtnf[x]) - temp1);
+                    if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
+                        accumNc += temp2;
+                    if (temp2 > 42) {
+                        if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
+                            accumNm += temp2;
+                        if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
+                            accumNml += temp2;
+                    }
+                }
+            }
+        }
+        prvpf += prvf_linesize;
+        prvnf += prvf_linesize;
+        srcpf += srcf_linesize;
+        srcf  += srcf_linesize;
+        srcnf += srcf_linesize;
+        nxtpf += nxtf_linesize;
+        nxtnf += nxtf_linesize;
+        mapp  += map_linesize;
+    }
+
+    sums->accumPc  += accumPc;
+    sums->accumPm  += accumPm;
+    sums->accumPml += accumPml;
+    sums->accumNc  += accumNc;
+    sums->accumNm  += accumNm;
+    sums->accumNml += accumNml;
+    return 0;
+}
+
+static int compare_fields(AVFilterContext *ctx, int match1, int match2, int field)
+{
+    FieldMatchContext *fm = ctx->priv;
+    int plane, ret, i;
     uint64_t accumPc = 0, accumPm = 0, accumPml = 0;
     uint64_t accumNc = 0, accumNm = 0, accumNml = 0;
     int norm1, norm2, mtn1, mtn2;
     float c1, c2, mr;
     const AVFrame *src = fm->src;
+    const int nb_jobs = av_clip(get_nb_compare_lines(src->height), 1, fm->nb_threads);
+
+    memset(fm->sums, 0, nb_jobs * sizeof(*fm->sums));
 
     for (plane = 0; plane < (fm->mchroma ? 3 : 1); plane++) {
-        int x, y, temp1, temp2, fbase;
+        CompareThreadData td;
+        int fbase;
         const AVFrame *prev, *next;
         uint8_t *mapp    = fm->map_data[plane];
         int map_linesize = fm->map_linesize[plane];
@@ -512,8 +662,6 @@ static int compare_fields(FieldMatchContext *fm, int match1, int match2, int fie
         const uint8_t *srcpf, *srcf, *srcnf;
         const uint8_t *prvpf, *prvnf, *nxtpf, *nxtnf;
 
-        fill_buf(mapp, width, height, map_linesize, 0);
-
         /* match1 */
         fbase = get_field_base(match1, field);
         srcf  = srcp + (fbase + 1) * src_linesize;
@@ -535,50 +683,50 @@ static int compare_fields(FieldMatchContext *fm, int match1, int match2, int fie
         nxtnf = nxtpf + nxtf_linesize;                      // next frame, next     field
 
         map_linesize <<= 1;
-        if ((match1 >= 3 && field == 1) || (match1 < 3 && field != 1))
-            build_diff_map(fm, prvpf, prvf_linesize, nxtpf, nxtf_linesize,
-                           mapp, map_linesize, height, width, plane);
-        else
-            build_diff_map(fm, prvnf, prvf_linesize, nxtnf, nxtf_linesize,
-                           mapp + map_linesize, map_linesize, height, width, plane);
-
-        for (y = 2; y < height - 2; y += 2) {
-            if (y0a == y1a || y < y0a || y > y1a) {
-                for (x = startx; x < stopx; x++) {
-                    if (mapp[x] > 0 || mapp[x + map_linesize] > 0) {
-                        temp1 = srcpf[x] + (srcf[x] << 2) + srcnf[x]; // [1 4 1]
-
-                        temp2 = abs(3 * (prvpf[x] + prvnf[x]) - temp1);
-                        if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
-                            accumPc += temp2;
-                        if (temp2 > 42) {
-                            if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
-                                accumPm += temp2;
-                            if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
-                                accumPml += temp2;
-                        }
-
-                        temp2 = abs(3 * (nxtpf[x] + nxtnf[x]) - temp1);
-                        if (temp2 > 23 && ((mapp[x]&1) || (mapp[x + map_linesize]&1)))
-                            accumNc += temp2;
-                        if (temp2 > 42) {
-                            if ((mapp[x]&2) || (mapp[x + map_linesize]&2))
-                                accumNm += temp2;
-                            if ((mapp[x]&4) || (mapp[x + map_linesize]&4))
-                                accumNml += temp2;
-                        }
-                    }
-                }
-            }
-            prvpf += prvf_linesize;
-            prvnf += prvf_linesize;
-            srcpf += srcf_linesize;
-            srcf  += srcf_linesize;
-            srcnf += srcf_linesize;
-            nxtpf += nxtf_linesize;
-            nxtnf += nxtf_linesize;
-            mapp  += map_linesize;
+        if ((match1 >= 3 && field == 1) || (match1 < 3 && field != 1)) {
+            td.diffpf   = prvpf;
+            td.diffnf   = nxtpf;
+            td.diff_map = mapp;
+        } else {
+            td.diffpf   = prvnf;
+            td.diffnf   = nxtnf;
+            td.diff_map = mapp + map_linesize;
         }
+
+        td.plane  = plane;
+        td.width  = width;
+        td.height = height;
+        td.mapp   = mapp;
+        td.srcpf  = srcpf;
+        td.srcf   = srcf;
+        td.srcnf  = srcnf;
+        td.prvpf  = prvpf;
+        td.prvnf  = prvnf;
+        td.nxtpf  = nxtpf;
+        td.nxtnf  = nxtnf;
+        td.map_linesize  = map_linesize;
+        td.srcf_linesize = srcf_linesize;
+        td.prvf_linesize = prvf_linesize;
+        td.nxtf_linesize = nxtf_linesize;
+        td.y0a    = y0a;
+        td.y1a    = y1a;
+        td.startx = startx;
+        td.stopx  = stopx;
+
+        /* the difference map needs the whole absolute difference mask, and
+         * the comparison the whole difference map, so they are separate passes */
+        ctx->internal->execute(ctx, diff_mask_slice, &td, NULL, nb_jobs);
+        ctx->internal->execute(ctx, diff_map_slice,  &td, NULL, nb_jobs);
+        ctx->internal->execute(ctx, compare_slice,   &td, NULL, nb_jobs);
+    }
+
+    for (i = 0; i < nb_jobs; i++) {
+        accumPc  += fm->sums[i].accumPc;
+        accumPm  += fm->sums[i].accumPm;
+        accumPml += fm->sums[i].accumPml;
+        accumNc  += fm->sums[i].accumNc;
+        accumNm  += fm->sums[i].accumNm;
+        accumNml += fm->sums[i].accumNml;
     }
 
     if (accumPm < 500 && accumNm < 500 && (accumPml >= 500 || accumNml >= 500) &&
@@ -656,7 +804,7 @@ static int checkmm(AVFilterContext *ctx, int *combs, int m1, int m2,
         if (!gen_frames[mid])                                                   \
             gen_frames[mid] = create_weave_frame(ctx, mid, field,               \
                                                  fm->prv, fm->src, fm->nxt);    \
-        combs[mid] = calc_combed_score(fm, gen_frames[mid]);                    \
+        combs[mid] = calc_combed_score(ctx, gen_frames[mid]);                   \
     }                                                                           \
 } while (0)
 
@@ -729,7 +877,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
                 ret = AVERROR(ENOMEM);
                 goto fail;
             }
-            combs[i] = calc_combed_score(fm, gen_frames[i]);
+            combs[i] = calc_combed_score(ctx, gen_frames[i]);
         }
         av_log(ctx, AV_LOG_INFO, "COMBS: %3d %3d %3d %3d %3d\n",
                combs[0], combs[1], combs[2], combs[3], combs[4]);
@@ -742,9 +890,9 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *in)
     }
 
     /* p/c selection and optional 3-way p/c/n matches */
-    match = compare_fields(fm, fxo[mC], fxo[mP], field);
+    match = compare_fields(ctx, fxo[mC], fxo[mP], field);
     if (fm->mode == MODE_PCN || fm->mode == MODE_PCN_UB)
-        match = compare_fields(fm, match, fxo[mN], field);
+        match = compare_fields(ctx, match, fxo[mN], field);
 
     /* scene change check */
     if (fm->combmatch == COMBMATCH_SC) {
@@ -950,11 +1098,15 @@ static int config_input(AVFilterLink *inlink)
     fm->tpitchy  = FFALIGN(w,      16);
     fm->tpitchuv = FFALIGN(w >> 1, 16);
 
+    fm->nb_threads = FFMAX(ff_filter_get_nb_threads(ctx), 1);
+    fm->c_array_size = (((w + fm->blockx/2)/fm->blockx)+1) *
+                       (((h + fm->blocky/2)/fm->blocky)+1) * 4;
+
     fm->tbuffer = av_calloc((h/2 + 4) * fm->tpitchy, sizeof(*fm->tbuffer));
-    fm->c_array = av_malloc_array((((w + fm->blockx/2)/fm->blockx)+1) *
-                            (((h + fm->blocky/2)/fm->blocky)+1),
-                            4 * sizeof(*fm->c_array));
-    if (!fm->tbuffer || !fm->c_array)
+    fm->c_array = av_malloc_array(fm->c_array_size,
+                                  fm->nb_threads * sizeof(*fm->c_array));
+    fm->sums    = av_calloc(fm->nb_threads, sizeof(*fm->sums));
+    if (!fm->tbuffer || !fm->c_array || !fm->sums)
         return AVERROR(ENOMEM);
 
     return 0;
@@ -1012,6 +1164,7 @@ static av_cold void fieldmatch_uninit(AVFilterContext *ctx)
     av_freep(&fm->cmask_data[0]);
     av_freep(&fm->tbuffer);
     av_freep(&fm->c_array);
+    av_freep(&fm->sums);
 }
 
 static int config_output(AVFilterLink *outlink)
@@ -1051,5 +1204,5 @@ AVFilter ff_vf_fieldmatch = {
     .inputs         = NULL,
     .outputs        = fieldmatch_outputs,
     .priv_class     = &fieldmatch_class,
-    .flags          = AVFILTER_FLAG_DYNAMIC_INPUTS,
+    .flags          = AVFILTER_FLAG_DYNAMIC_INPUTS | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -45,6 +45,8 @@ typedef struct FreezeDetectContext {
 
     double noise;
     int64_t duration;            ///< minimum duration of frozen frame until notification
+    int export_sad;
+    int reuse_sad;
 } FreezeDetectContext;
 
 #define OFFSET(x) offsetof(FreezeDetectContext, x)
@@ -56,6 +58,8 @@ static const AVOption freezedetect_options[] = {
     { "noise",               "set noise tolerance",                       OFFSET(noise),  AV_OPT_TYPE_DOUBLE,   {.dbl=0.001},     0,       1.0, V|F },
     { "d",                   "set minimum duration in seconds",        OFFSET(duration),  AV_OPT_TYPE_DURATION, {.i64=2000000},   0, INT64_MAX, V|F },
     { "duration",            "set minimum duration in seconds",        OFFSET(duration),  AV_OPT_TYPE_DURATION, {.i64=2000000},   0, INT64_MAX, V|F },
+    { "export_sad",          "export the frame SAD in the metadata",   OFFSET(export_sad), AV_OPT_TYPE_BOOL,    {.i64=0},         0,         1, V|F },
+    { "reuse_sad",           "use the frame SAD found in the metadata", OFFSET(reuse_sad), AV_OPT_TYPE_BOOL,    {.i64=0},         0,         1, V|F },
 
     {NULL}
 };
@@ -124,22 +128,17 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&s->reference_frame);
 }
 
-static int is_frozen(FreezeDetectContext *s, AVFrame *reference, AVFrame *frame)
+static int is_frozen(AVFilterContext *ctx, AVFrame *reference, AVFrame *frame)
 {
-    uint64_t sad = 0;
+    FreezeDetectContext *s = ctx->priv;
+    uint64_t sad;
     uint64_t count = 0;
     double mafd;
-    for (int plane = 0; plane < 4; plane++) {
-        if (s->width[plane]) {
-            uint64_t plane_sad;
-            s->sad(frame->data[plane], frame->linesize[plane],
-                   reference->data[plane], reference->linesize[plane],
-                   s->width[plane], s->height[plane], &plane_sad);
-            sad += plane_sad;
-            count += s->width[plane] * s->height[plane];
-        }
-    }
-    emms_c();
+    for (int plane = 0; plane < 4; plane++)
+        count += s->width[plane] * s->height[plane];
+    sad = ff_scene_sad_frame(ctx, s->sad, frame, reference, s->width, s->height,
+                             4, s->export_sad * SCENE_SAD_EXPORT |
+                                s->reuse_sad  * SCENE_SAD_REUSE);
     mafd = (double)sad / count / (1ULL << s->bitdepth);
     return (mafd <= s->noise);
 }
@@ -175,7 +174,7 @@ static int activate(AVFilterContext *ctx)
             else
                 duration = av_rescale_q(frame->pts - s->reference_frame->pts, inlink->time_base, AV_TIME_BASE_Q);
 
-            frozen = is_frozen(s, s->reference_frame, frame);
+            frozen = is_frozen(ctx, s->reference_frame, frame);
             if (duration >= s->duration) {
                 if (!s->frozen)
                     set_meta(s, frame, "lavfi.freezedetect.freeze_start", av_ts2timestr(s->reference_frame->pts, &inlink->time_base));
@@ -232,4 +231,5 @@ AVFilter ff_vf_freezedetect = {
     .inputs        = freezedetect_inputs,
     .outputs       = freezedetect_outputs,
     .activate      = activate,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
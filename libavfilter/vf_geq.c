@@ -34,6 +34,7 @@
 #include "internal.h"
 
 #define MAX_NB_THREADS 32
+#define ROW_SIZE 256     ///< number of pixels evaluated at once
 #define NB_PLANES 4
 
 enum InterpolationMethods {
@@ -48,6 +49,7 @@ enum                                   { VAR_X, VAR_Y, VAR_W, VAR_H, VAR_N, VAR_
 typedef struct GEQContext {
     const AVClass *class;
     AVExpr *e[NB_PLANES][MAX_NB_THREADS]; ///< expressions for each plane and thread
+    double *scratch[MAX_NB_THREADS];      ///< working memory of av_expr_eval_array() for each thread
     char *expr_str[4+3];        ///< expression strings for each plane
     AVFrame *picref;            ///< current input buffer
     uint8_t *dst;               ///< reference pointer to the 8bits output
@@ -224,7 +226,7 @@ static double alphasum(void *priv, double x, double y) { return getpix_integrate
 static av_cold int geq_init(AVFilterContext *ctx)
 {
     GEQContext *geq = ctx->priv;
-    int plane, ret = 0;
+    int plane, scratch_size = 0, ret = 0;
 
     if (!geq->expr_str[Y] && !geq->expr_str[G] && !geq->expr_str[B] && !geq->expr_str[R]) {
         av_log(ctx, AV_LOG_ERROR, "A luminance or RGB expression is mandatory\n");
@@ -298,6 +300,15 @@ static av_cold int geq_init(AVFilterContext *ctx)
 
         av_expr_count_func(geq->e[plane][0], counter, FF_ARRAY_ELEMS(counter), 2);
         geq->needs_sum[plane] = counter[5] + counter[6] + counter[7] + counter[8] + counter[9];
+        scratch_size = FFMAX(scratch_size, av_expr_eval_array_scratch_size(geq->e[plane][0]));
+    }
+
+    for (int i = 0; i < MAX_NB_THREADS && scratch_size; i++) {
+        geq->scratch[i] = av_malloc_array(scratch_size, sizeof(*geq->scratch[i]));
+        if (!geq->scratch[i]) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
     }
 
 end:
@@ -377,8 +388,9 @@ static int slice_geq_filter(AVFilterContext *ctx, void *arg, int jobnr, int nb_j
     const int linesize = td->linesize;
     const int slice_start = (height *  jobnr) / nb_jobs;
     const int slice_end = (height * (jobnr+1)) / nb_jobs;
-    int x, y;
+    int x, y, i;
 
+    double row[ROW_SIZE];
     double values[VAR_VARS_NB];
     values[VAR_W] = geq->values[VAR_W];
     values[VAR_H] = geq->values[VAR_H];
@@ -391,10 +403,13 @@ static int slice_geq_filter(AVFilterContext *ctx, void *arg, int jobnr, int nb_j
         uint8_t *ptr = geq->dst + linesize * slice_start;
         for (y = slice_start; y < slice_end; y++) {
             values[VAR_Y] = y;
-
-            for (x = 0; x < width; x++) {
+            for (x = 0; x < width; x += ROW_SIZE) {
+                const int len = FFMIN(width - x, ROW_SIZE);
                 values[VAR_X] = x;
-                ptr[x] = av_expr_eval(geq->e[plane][jobnr], values, geq);
+                av_expr_eval_array(geq->e[plane][jobnr], row, len, values, VAR_X, 1, geq,
+                                   geq->scratch[jobnr]);
+                for (i = 0; i < len; i++)
+                    ptr[x + i] = row[i];
             }
             ptr += linesize;
         }
@@ -402,9 +417,13 @@ static int slice_geq_filter(AVFilterContext *ctx, void *arg, int jobnr, int nb_j
         uint16_t *ptr16 = geq->dst16 + (linesize/2) * slice_start;
         for (y = slice_start; y < slice_end; y++) {
             values[VAR_Y] = y;
-            for (x = 0; x < width; x++) {
+            for (x = 0; x < width; x += ROW_SIZE) {
+                const int len = FFMIN(width - x, ROW_SIZE);
                 values[VAR_X] = x;
-                ptr16[x] = av_expr_eval(geq->e[plane][jobnr], values, geq);
+                av_expr_eval_array(geq->e[plane][jobnr], row, len, values, VAR_X, 1, geq,
+                                   geq->scratch[jobnr]);
+                for (i = 0; i < len; i++)
+                    ptr16[x + i] = row[i];
             }
             ptr16 += linesize/2;
         }
@@ -470,6 +489,8 @@ static av_cold void geq_uninit(AVFilterContext *ctx)
     for (i = 0; i < NB_PLANES; i++)
         for (int j = 0; j < MAX_NB_THREADS; j++)
             av_expr_free(geq->e[i][j]);
+    for (i = 0; i < MAX_NB_THREADS; i++)
+        av_freep(&geq->scratch[i]);
     for (i = 0; i < NB_PLANES; i++)
         av_freep(&geq->pixel_sums);
 }
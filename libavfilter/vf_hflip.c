@@ -253,5 +253,6 @@ AVFilter ff_vf_hflip = {
     .query_formats = query_formats,
     .inputs        = avfilter_vf_hflip_inputs,
     .outputs       = avfilter_vf_hflip_outputs,
+    .reconfigure   = ff_filter_reconfigure_stateless,
     .flags         = AVFILTER_FLAG_SLICE_THREADS | AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
 };
@@ -39,6 +39,16 @@ typedef enum {
     REPEAT_BOTTOM,
 } RepeatedField;
 
+/**
+ * Per-slice partial sums of the field differences, merged after the
+ * slice threads are done.
+ */
+typedef struct IDETSums {
+    int64_t alpha[2];
+    int64_t delta;
+    int64_t gamma[2];
+} IDETSums;
+
 typedef struct IDETContext {
     const AVClass *class;
     float interlace_threshold;
@@ -69,6 +79,9 @@ typedef struct IDETContext {
 
     const AVPixFmtDescriptor *csp;
     int eof;
+
+    IDETSums *sums;
+    int nb_threads;
 } IDETContext;
 
 void ff_idet_init_x86(IDETContext *idet, int for_16b);
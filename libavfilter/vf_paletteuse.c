@@ -23,10 +23,13 @@
  * Use a palette to downsample an input video stream.
  */
 
+#include <stdatomic.h>
+
 #include "libavutil/bprint.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
 #include "libavutil/qsort.h"
+#include "libavutil/thread.h"
 #include "avfilter.h"
 #include "filters.h"
 #include "framesync.h"
@@ -75,15 +78,28 @@ struct cache_node {
     int nb_entries;
 };
 
+/* number of pixels of the row above that must be dithered before a pixel
+ * can be processed, the widest kernel (sierra2) spreads 2 pixels sideways */
+#define DIFFUSION_LAG   5
+#define PROGRESS_STEP   32
+
 struct PaletteUseContext;
 
-typedef int (*set_frame_func)(struct PaletteUseContext *s, AVFrame *out, AVFrame *in,
-                              int x_start, int y_start, int width, int height);
+typedef int (*set_frame_func)(struct PaletteUseContext *s, struct cache_node *cache,
+                              AVFrame *out, AVFrame *in,
+                              int x_start, int y_start, int width, int height,
+                              int slice_start, int slice_end);
+
+typedef struct ThreadData {
+    AVFrame *in, *out;
+    int x, y, w, h;
+} ThreadData;
 
 typedef struct PaletteUseContext {
     const AVClass *class;
     FFFrameSync fs;
-    struct cache_node cache[CACHE_SIZE];    /* lookup cache */
+    struct cache_node (*cache)[CACHE_SIZE]; /* lookup caches, one per thread */
+    int nb_caches;
     struct color_node map[AVPALETTE_COUNT]; /* 3D-Tree (KD-Tree with K=3) for reverse colormap */
     uint32_t palette[AVPALETTE_COUNT];
     int transparency_index; /* index in the palette of transparency. -1 if there is no transparency in the palette. */
@@ -98,6 +114,15 @@ typedef struct PaletteUseContext {
     AVFrame *last_in;
     AVFrame *last_out;
 
+    /* error diffusion wavefront */
+    int wavefront;
+    atomic_int *row_progress;
+    int *row_ret;
+#if HAVE_THREADS
+    pthread_mutex_t progress_mutex;
+    pthread_cond_t  progress_cond;
+#endif
+
     /* debug options */
     char *dot_filename;
     int color_search_method;
@@ -332,7 +357,7 @@ end:
  * Note: a, r, g, and b are the components of color, but are passed as well to avoid
  * recomputing them (they are generally computed by the caller for other uses).
  */
-static av_always_inline int color_get(PaletteUseContext *s, uint32_t color,
+static av_always_inline int color_get(PaletteUseContext *s, struct cache_node *cache, uint32_t color,
                                       uint8_t a, uint8_t r, uint8_t g, uint8_t b,
                                       const enum color_search_method search_method)
 {
@@ -342,7 +367,7 @@ static av_always_inline int color_get(PaletteUseContext *s, uint32_t color,
     const uint8_t ghash = g & ((1<<NBITS)-1);
     const uint8_t bhash = b & ((1<<NBITS)-1);
     const unsigned hash = rhash<<(NBITS*2) | ghash<<NBITS | bhash;
-    struct cache_node *node = &s->cache[hash];
+    struct cache_node *node = &cache[hash];
     struct cached_color *e;
 
     // first, check for transparency
@@ -366,7 +391,7 @@ static av_always_inline int color_get(PaletteUseContext *s, uint32_t color,
     return e->pal_entry;
 }
 
-static av_always_inline int get_dst_color_err(PaletteUseContext *s,
+static av_always_inline int get_dst_color_err(PaletteUseContext *s, struct cache_node *cache,
                                               uint32_t c, int *er, int *eg, int *eb,
                                               const enum color_search_method search_method)
 {
@@ -375,7 +400,7 @@ static av_always_inline int get_dst_color_err(PaletteUseContext *s,
     const uint8_t g = c >>  8 & 0xff;
     const uint8_t b = c       & 0xff;
     uint32_t dstc;
-    const int dstx = color_get(s, c, a, r, g, b, search_method);
+    const int dstx = color_get(s, cache, c, a, r, g, b, search_method);
     if (dstx < 0)
         return dstx;
     dstc = s->palette[dstx];
@@ -385,24 +410,60 @@ static av_always_inline int get_dst_color_err(PaletteUseContext *s,
     return dstx;
 }
 
-static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFrame *in,
+static int wait_row(PaletteUseContext *s, int row, int progress)
+{
+    int cur = atomic_load_explicit(&s->row_progress[row], memory_order_acquire);
+
+#if HAVE_THREADS
+    if (cur < progress) {
+        pthread_mutex_lock(&s->progress_mutex);
+        while ((cur = atomic_load_explicit(&s->row_progress[row], memory_order_acquire)) < progress)
+            pthread_cond_wait(&s->progress_cond, &s->progress_mutex);
+        pthread_mutex_unlock(&s->progress_mutex);
+    }
+#endif
+
+    return cur;
+}
+
+static void report_row(PaletteUseContext *s, int row, int progress)
+{
+    atomic_store_explicit(&s->row_progress[row], progress, memory_order_release);
+
+#if HAVE_THREADS
+    pthread_mutex_lock(&s->progress_mutex);
+    pthread_cond_broadcast(&s->progress_cond);
+    pthread_mutex_unlock(&s->progress_mutex);
+#endif
+}
+
+static av_always_inline int set_frame(PaletteUseContext *s, struct cache_node *cache,
+                                      AVFrame *out, AVFrame *in,
                                       int x_start, int y_start, int w, int h,
+                                      int slice_start, int slice_end,
                                       enum dithering_mode dither,
                                       const enum color_search_method search_method)
 {
     int x, y;
+    const int width = w;
     const int src_linesize = in ->linesize[0] >> 2;
     const int dst_linesize = out->linesize[0];
-    uint32_t *src = ((uint32_t *)in ->data[0]) + y_start*src_linesize;
-    uint8_t  *dst =              out->data[0]  + y_start*dst_linesize;
+    uint32_t *src = ((uint32_t *)in ->data[0]) + slice_start*src_linesize;
+    uint8_t  *dst =              out->data[0]  + slice_start*dst_linesize;
 
     w += x_start;
     h += y_start;
 
-    for (y = y_start; y < h; y++) {
+    for (y = slice_start; y < slice_end; y++) {
+        /* part of the row above that is known to be final */
+        int above = s->wavefront && y > y_start ? 0 : width;
+
         for (x = x_start; x < w; x++) {
             int er, eg, eb;
 
+            if (above < width && above < x - x_start + DIFFUSION_LAG)
+                above = wait_row(s, y - 1, FFMIN(x - x_start + DIFFUSION_LAG, width));
+
             if (dither == DITHERING_BAYER) {
                 const int d = s->ordered_dither[(y & 7)<<3 | (x & 7)];
                 const uint8_t a8 = src[x] >> 24 & 0xff;
@@ -412,7 +473,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const uint8_t r = av_clip_uint8(r8 + d);
                 const uint8_t g = av_clip_uint8(g8 + d);
                 const uint8_t b = av_clip_uint8(b8 + d);
-                const int color = color_get(s, src[x], a8, r, g, b, search_method);
+                const int color = color_get(s, cache, src[x], a8, r, g, b, search_method);
 
                 if (color < 0)
                     return color;
@@ -420,7 +481,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_HECKBERT) {
                 const int right = x < w - 1, down = y < h - 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -432,7 +493,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_FLOYD_STEINBERG) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -446,7 +507,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
             } else if (dither == DITHERING_SIERRA2) {
                 const int right  = x < w - 1, down  = y < h - 1, left  = x > x_start;
                 const int right2 = x < w - 2,                    left2 = x > x_start + 1;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -465,7 +526,7 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
 
             } else if (dither == DITHERING_SIERRA2_4A) {
                 const int right = x < w - 1, down = y < h - 1, left = x > x_start;
-                const int color = get_dst_color_err(s, src[x], &er, &eg, &eb, search_method);
+                const int color = get_dst_color_err(s, cache, src[x], &er, &eg, &eb, search_method);
 
                 if (color < 0)
                     return color;
@@ -480,12 +541,15 @@ static av_always_inline int set_frame(PaletteUseContext *s, AVFrame *out, AVFram
                 const uint8_t r = src[x] >> 16 & 0xff;
                 const uint8_t g = src[x] >>  8 & 0xff;
                 const uint8_t b = src[x]       & 0xff;
-                const int color = color_get(s, src[x], a, r, g, b, search_method);
+                const int color = color_get(s, cache, src[x], a, r, g, b, search_method);
 
                 if (color < 0)
                     return color;
                 dst[x] = color;
             }
+
+            if (s->wavefront && !((x - x_start + 1) % PROGRESS_STEP))
+                report_row(s, y, x - x_start + 1);
         }
         src += src_linesize;
         dst += dst_linesize;
@@ -888,12 +952,42 @@ static void set_processing_window(enum diff_mode diff_mode,
     *hp = height;
 }
 
+static int set_frame_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    PaletteUseContext *s = ctx->priv;
+    ThreadData *td = arg;
+    struct cache_node *cache;
+    int slice_start, slice_end, ret;
+
+    if (s->wavefront) {
+        /* one row per job, rows are started in order and finish in order,
+         * so at most nb_caches consecutive rows are in flight */
+        slice_start = td->y + jobnr;
+        slice_end   = slice_start + 1;
+        cache       = s->cache[slice_start % s->nb_caches];
+    } else {
+        slice_start = td->y + (td->h *  jobnr     ) / nb_jobs;
+        slice_end   = td->y + (td->h * (jobnr + 1)) / nb_jobs;
+        cache       = s->cache[jobnr];
+    }
+
+    ret = s->set_frame(s, cache, td->out, td->in, td->x, td->y, td->w, td->h,
+                       slice_start, slice_end);
+
+    /* also on error, so that the rows below do not wait forever */
+    if (s->wavefront)
+        report_row(s, slice_start, td->w);
+
+    return ret;
+}
+
 static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
 {
-    int x, y, w, h, ret;
+    int x, y, w, h, i, ret, nb_jobs;
     AVFilterContext *ctx = inlink->dst;
     PaletteUseContext *s = ctx->priv;
     AVFilterLink *outlink = inlink->dst->outputs[0];
+    ThreadData td;
 
     AVFrame *out = ff_get_video_buffer(outlink, outlink->w, outlink->h);
     if (!out) {
@@ -917,11 +1011,29 @@ static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
     ff_dlog(ctx, "%dx%d rect: (%d;%d) -> (%d,%d) [area:%dx%d]\n",
             w, h, x, y, x+w, y+h, in->width, in->height);
 
-    ret = s->set_frame(s, out, in, x, y, w, h);
-    if (ret < 0) {
-        av_frame_free(&out);
-        *outf = NULL;
-        return ret;
+    td.in  = in;
+    td.out = out;
+    td.x   = x;
+    td.y   = y;
+    td.w   = w;
+    td.h   = h;
+
+    if (s->wavefront) {
+        nb_jobs = h;
+        for (i = y; i < y + h; i++)
+            atomic_store_explicit(&s->row_progress[i], 0, memory_order_relaxed);
+    } else {
+        nb_jobs = FFMIN3(h, s->nb_caches, ff_filter_get_nb_threads(ctx));
+    }
+
+    ctx->internal->execute(ctx, set_frame_slice, &td, s->row_ret, nb_jobs);
+
+    for (i = 0; i < nb_jobs; i++) {
+        if (s->row_ret[i] < 0) {
+            av_frame_free(&out);
+            *outf = NULL;
+            return s->row_ret[i];
+        }
     }
     memcpy(out->data[1], s->palette, AVPALETTE_SIZE);
     if (s->calc_mean_err)
@@ -930,6 +1042,20 @@ static int apply_palette(AVFilterLink *inlink, AVFrame *in, AVFrame **outf)
     return 0;
 }
 
+static void free_caches(PaletteUseContext *s)
+{
+    int i, j;
+
+    if (!s->cache)
+        return;
+
+    for (j = 0; j < s->nb_caches; j++) {
+        for (i = 0; i < CACHE_SIZE; i++)
+            av_freep(&s->cache[j][i].entries);
+        memset(s->cache[j], 0, sizeof(s->cache[j]));
+    }
+}
+
 static int config_output(AVFilterLink *outlink)
 {
     int ret;
@@ -946,6 +1072,23 @@ static int config_output(AVFilterLink *outlink)
     outlink->w = ctx->inputs[0]->w;
     outlink->h = ctx->inputs[0]->h;
 
+    free_caches(s);
+    av_freep(&s->cache);
+    av_freep(&s->row_progress);
+    av_freep(&s->row_ret);
+
+    /* the error diffusion wavefront maps rows onto the caches, which is only
+     * safe with a cache for every thread that may run a job */
+    s->nb_caches = ctx->thread_type & AVFILTER_THREAD_SLICE ? ctx->graph->nb_threads : 1;
+    s->wavefront = s->dither != DITHERING_NONE && s->dither != DITHERING_BAYER &&
+                   s->nb_caches > 1 && ff_filter_get_nb_threads(ctx) > 1;
+
+    s->cache        = av_calloc(s->nb_caches, sizeof(*s->cache));
+    s->row_progress = av_calloc(outlink->h, sizeof(*s->row_progress));
+    s->row_ret      = av_calloc(outlink->h, sizeof(*s->row_ret));
+    if (!s->cache || !s->row_progress || !s->row_ret)
+        return AVERROR(ENOMEM);
+
     outlink->time_base = ctx->inputs[0]->time_base;
     if ((ret = ff_framesync_configure(&s->fs)) < 0)
         return ret;
@@ -978,9 +1121,7 @@ static void load_palette(PaletteUseContext *s, const AVFrame *palette_frame)
     if (s->new) {
         memset(s->palette, 0, sizeof(s->palette));
         memset(s->map, 0, sizeof(s->map));
-        for (i = 0; i < CACHE_SIZE; i++)
-            av_freep(&s->cache[i].entries);
-        memset(s->cache, 0, sizeof(s->cache));
+        free_caches(s);
     }
 
     i = 0;
@@ -1028,10 +1169,13 @@ static int load_apply_palette(FFFrameSync *fs)
 }
 
 #define DEFINE_SET_FRAME(color_search, name, value)                             \
-static int set_frame_##name(PaletteUseContext *s, AVFrame *out, AVFrame *in,    \
-                            int x_start, int y_start, int w, int h)             \
+static int set_frame_##name(PaletteUseContext *s, struct cache_node *cache,     \
+                            AVFrame *out, AVFrame *in,                          \
+                            int x_start, int y_start, int w, int h,             \
+                            int slice_start, int slice_end)                     \
 {                                                                               \
-    return set_frame(s, out, in, x_start, y_start, w, h, value, color_search);  \
+    return set_frame(s, cache, out, in, x_start, y_start, w, h,                 \
+                     slice_start, slice_end, value, color_search);              \
 }
 
 #define DEFINE_SET_FRAME_COLOR_SEARCH(color_search, color_search_macro)                                 \
@@ -1073,6 +1217,11 @@ static av_cold int init(AVFilterContext *ctx)
 {
     PaletteUseContext *s = ctx->priv;
 
+#if HAVE_THREADS
+    pthread_mutex_init(&s->progress_mutex, NULL);
+    pthread_cond_init(&s->progress_cond, NULL);
+#endif
+
     s->last_in  = av_frame_alloc();
     s->last_out = av_frame_alloc();
     if (!s->last_in || !s->last_out) {
@@ -1102,14 +1251,20 @@ static int activate(AVFilterContext *ctx)
 
 static av_cold void uninit(AVFilterContext *ctx)
 {
-    int i;
     PaletteUseContext *s = ctx->priv;
 
     ff_framesync_uninit(&s->fs);
-    for (i = 0; i < CACHE_SIZE; i++)
-        av_freep(&s->cache[i].entries);
+    free_caches(s);
+    av_freep(&s->cache);
+    av_freep(&s->row_progress);
+    av_freep(&s->row_ret);
     av_frame_free(&s->last_in);
     av_frame_free(&s->last_out);
+
+#if HAVE_THREADS
+    pthread_mutex_destroy(&s->progress_mutex);
+    pthread_cond_destroy(&s->progress_cond);
+#endif
 }
 
 static const AVFilterPad paletteuse_inputs[] = {
@@ -1144,4 +1299,5 @@ AVFilter ff_vf_paletteuse = {
     .inputs        = paletteuse_inputs,
     .outputs       = paletteuse_outputs,
     .priv_class    = &paletteuse_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -30,12 +30,19 @@
 #include "libavutil/pixdesc.h"
 #include "avfilter.h"
 #include "drawutils.h"
+#include "filters.h"
 #include "formats.h"
 #include "framesync.h"
 #include "internal.h"
 #include "psnr.h"
 #include "video.h"
 
+typedef struct QueuedFrame {
+    AVFrame *master;
+    AVFrame *ref;
+    uint64_t score[4];
+} QueuedFrame;
+
 typedef struct PSNRContext {
     const AVClass *class;
     FFFrameSync fs;
@@ -57,6 +64,9 @@ typedef struct PSNRContext {
     double planeweight[4];
     uint64_t **score;
     PSNRDSPContext dsp;
+    int queue_size;
+    int nb_queued;
+    QueuedFrame *queue;
 } PSNRContext;
 
 #define OFFSET(x) offsetof(PSNRContext, x)
@@ -67,6 +77,7 @@ static const AVOption psnr_options[] = {
     {"f",          "Set file where to store per-frame difference information", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
     {"stats_version", "Set the format version for the stats file.",               OFFSET(stats_version),  AV_OPT_TYPE_INT,    {.i64=1},    1, 2, FLAGS },
     {"output_max",  "Add raw stats (max values) to the output log.",            OFFSET(stats_add_max), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
+    {"queue",      "Set the number of frame pairs to score concurrently",      OFFSET(queue_size), AV_OPT_TYPE_INT, {.i64=1}, 1, 1024, FLAGS },
     { NULL }
 };
 
@@ -159,42 +170,45 @@ static void set_meta(AVDictionary **metadata, const char *key, char comp, float
     }
 }
 
-static int do_psnr(FFFrameSync *fs)
+static void fill_thread_data(PSNRContext *s, ThreadData *td,
+                             const AVFrame *master, const AVFrame *ref)
+{
+    td->nb_components = s->nb_components;
+    td->dsp = &s->dsp;
+    for (int c = 0; c < s->nb_components; c++) {
+        td->main_data[c] = master->data[c];
+        td->ref_data[c] = ref->data[c];
+        td->main_linesize[c] = master->linesize[c];
+        td->ref_linesize[c] = ref->linesize[c];
+        td->planewidth[c] = s->planewidth[c];
+        td->planeheight[c] = s->planeheight[c];
+    }
+}
+
+static int compute_frames_mse(AVFilterContext *ctx, void *arg,
+                              int jobnr, int nb_jobs)
 {
-    AVFilterContext *ctx = fs->parent;
     PSNRContext *s = ctx->priv;
-    AVFrame *master, *ref;
-    double comp_mse[4], mse = 0.;
-    uint64_t comp_sum[4] = { 0 };
-    AVDictionary **metadata;
-    ThreadData td;
-    int ret;
 
-    ret = ff_framesync_dualinput_get(fs, &master, &ref);
-    if (ret < 0)
-        return ret;
-    if (ctx->is_disabled || !ref)
-        return ff_filter_frame(ctx->outputs[0], master);
-    metadata = &master->metadata;
+    for (int i = jobnr; i < s->nb_queued; i += nb_jobs) {
+        QueuedFrame *f = &s->queue[i];
+        uint64_t *score = f->score;
+        ThreadData td;
 
-    td.nb_components = s->nb_components;
-    td.dsp = &s->dsp;
-    td.score = s->score;
-    for (int c = 0; c < s->nb_components; c++) {
-        td.main_data[c] = master->data[c];
-        td.ref_data[c] = ref->data[c];
-        td.main_linesize[c] = master->linesize[c];
-        td.ref_linesize[c] = ref->linesize[c];
-        td.planewidth[c] = s->planewidth[c];
-        td.planeheight[c] = s->planeheight[c];
+        fill_thread_data(s, &td, f->master, f->ref);
+        td.score = &score;
+        compute_images_mse(ctx, &td, 0, 1);
     }
 
-    ctx->internal->execute(ctx, compute_images_mse, &td, NULL, FFMIN(s->planeheight[1], s->nb_threads));
+    return 0;
+}
 
-    for (int j = 0; j < s->nb_threads; j++) {
-        for (int c = 0; c < s->nb_components; c++)
-            comp_sum[c] += s->score[j][c];
-    }
+static void update_stats(AVFilterContext *ctx, AVFrame *master,
+                         const uint64_t *comp_sum)
+{
+    PSNRContext *s = ctx->priv;
+    AVDictionary **metadata = &master->metadata;
+    double comp_mse[4], mse = 0.;
 
     for (int c = 0; c < s->nb_components; c++)
         comp_mse[c] = comp_sum[c] / ((double)s->planewidth[c] * s->planeheight[c]);
@@ -259,6 +273,104 @@ static int do_psnr(FFFrameSync *fs)
         }
         fprintf(s->stats_file, "\n");
     }
+}
+
+static void free_queue(PSNRContext *s)
+{
+    for (int i = 0; i < s->nb_queued; i++) {
+        av_frame_free(&s->queue[i].master);
+        av_frame_free(&s->queue[i].ref);
+    }
+    av_freep(&s->queue);
+    s->nb_queued = 0;
+}
+
+/**
+ * Score all the queued frame pairs, one frame per job, then update the
+ * statistics and output the frames in order.
+ */
+static int flush_queue(AVFilterContext *ctx)
+{
+    PSNRContext *s = ctx->priv;
+    int ret = 0;
+
+    if (!s->nb_queued)
+        return 0;
+
+    ctx->internal->execute(ctx, compute_frames_mse, NULL, NULL,
+                           FFMIN(s->nb_queued, s->nb_threads));
+
+    for (int i = 0; i < s->nb_queued; i++) {
+        QueuedFrame *f = &s->queue[i];
+
+        av_frame_free(&f->ref);
+        if (ret < 0) {
+            av_frame_free(&f->master);
+            continue;
+        }
+        update_stats(ctx, f->master, f->score);
+        ret = ff_filter_frame(ctx->outputs[0], f->master);
+        f->master = NULL;
+    }
+    s->nb_queued = 0;
+
+    return ret;
+}
+
+static int flush_queue_on_eof(FFFrameSync *fs)
+{
+    return flush_queue(fs->parent);
+}
+
+static int do_psnr(FFFrameSync *fs)
+{
+    AVFilterContext *ctx = fs->parent;
+    PSNRContext *s = ctx->priv;
+    AVFrame *master, *ref;
+    uint64_t comp_sum[4] = { 0 };
+    ThreadData td;
+    int ret;
+
+    ret = ff_framesync_dualinput_get(fs, &master, &ref);
+    if (ret < 0)
+        return ret;
+    if (ctx->is_disabled || !ref) {
+        ret = flush_queue(ctx);
+        if (ret < 0) {
+            av_frame_free(&master);
+            return ret;
+        }
+        return ff_filter_frame(ctx->outputs[0], master);
+    }
+
+    if (s->queue_size > 1) {
+        QueuedFrame *f = &s->queue[s->nb_queued];
+
+        f->ref = av_frame_clone(ref);
+        if (!f->ref) {
+            av_frame_free(&master);
+            return AVERROR(ENOMEM);
+        }
+        f->master = master;
+        if (++s->nb_queued < s->queue_size) {
+            /* nothing was output, keep pulling frames */
+            ff_filter_set_ready(ctx, 100);
+            return 0;
+        }
+        return flush_queue(ctx);
+    }
+
+    fill_thread_data(s, &td, master, ref);
+    td.score = s->score;
+
+    ctx->internal->execute(ctx, compute_images_mse, &td, NULL, FFMIN(s->planeheight[1], s->nb_threads));
+
+    for (int j = 0; j < s->nb_threads; j++) {
+        for (int c = 0; c < s->nb_components; c++)
+            comp_sum[c] += s->score[j][c];
+    }
+
+    update_stats(ctx, master, comp_sum);
 
     return ff_filter_frame(ctx->outputs[0], master);
 }
@@ -292,6 +404,7 @@ static av_cold int init(AVFilterContext *ctx)
     }
 
     s->fs.on_event = do_psnr;
+    s->fs.on_eof   = flush_queue_on_eof;
     return 0;
 }
 
@@ -378,6 +491,13 @@ static int config_input_ref(AVFilterLink *inlink)
             return AVERROR(ENOMEM);
     }
 
+    free_queue(s);
+    if (s->queue_size > 1) {
+        s->queue = av_calloc(s->queue_size, sizeof(*s->queue));
+        if (!s->queue)
+            return AVERROR(ENOMEM);
+    }
+
     return 0;
 }
 
@@ -413,6 +533,7 @@ static int config_output(AVFilterLink *outlink)
 static int activate(AVFilterContext *ctx)
 {
     PSNRContext *s = ctx->priv;
+
     return ff_framesync_activate(&s->fs);
 }
 
@@ -420,6 +541,8 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     PSNRContext *s = ctx->priv;
 
+    free_queue(s);
+
     if (s->nb_frames > 0) {
         int j;
         char buf[256];
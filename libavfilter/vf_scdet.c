@@ -44,6 +44,8 @@ typedef struct SCDetContext {
     AVFrame *prev_picref;
     double threshold;
     int sc_pass;
+    int export_sad;
+    int reuse_sad;
 } SCDetContext;
 
 #define OFFSET(x) offsetof(SCDetContext, x)
@@ -55,6 +57,8 @@ static const AVOption scdet_options[] = {
     { "t",           "set scene change detect threshold",        OFFSET(threshold),  AV_OPT_TYPE_DOUBLE,   {.dbl = 10.},     0,  100., V|F },
     { "sc_pass",     "Set the flag to pass scene change frames", OFFSET(sc_pass),    AV_OPT_TYPE_BOOL,     {.dbl =  0  },    0,    1,  V|F },
     { "s",           "Set the flag to pass scene change frames", OFFSET(sc_pass),    AV_OPT_TYPE_BOOL,     {.dbl =  0  },    0,    1,  V|F },
+    { "export_sad",  "export the frame SAD in the metadata",     OFFSET(export_sad), AV_OPT_TYPE_BOOL,     {.dbl =  0  },    0,    1,  V|F },
+    { "reuse_sad",   "use the frame SAD found in the metadata",  OFFSET(reuse_sad),  AV_OPT_TYPE_BOOL,     {.dbl =  0  },    0,    1,  V|F },
     {NULL}
 };
 
@@ -121,20 +125,16 @@ static double get_scene_score(AVFilterContext *ctx, AVFrame *frame)
 
     if (prev_picref && frame->height == prev_picref->height
                     && frame->width  == prev_picref->width) {
-        uint64_t sad = 0;
+        uint64_t sad;
         double mafd, diff;
         uint64_t count = 0;
 
-        for (int plane = 0; plane < s->nb_planes; plane++) {
-            uint64_t plane_sad;
-            s->sad(prev_picref->data[plane], prev_picref->linesize[plane],
-                    frame->data[plane], frame->linesize[plane],
-                    s->width[plane], s->height[plane], &plane_sad);
-            sad += plane_sad;
+        for (int plane = 0; plane < s->nb_planes; plane++)
             count += s->width[plane] * s->height[plane];
-        }
+        sad = ff_scene_sad_frame(ctx, s->sad, frame, prev_picref, s->width, s->height,
+                                 s->nb_planes, s->export_sad * SCENE_SAD_EXPORT |
+                                               s->reuse_sad  * SCENE_SAD_REUSE);
 
-        emms_c();
         mafd = (double)sad * 100. / count / (1ULL << s->bitdepth);
         diff = fabs(mafd - s->prev_mafd);
         ret  = av_clipf(FFMIN(mafd, diff), 0, 100.);
@@ -221,4 +221,5 @@ AVFilter ff_vf_scdet = {
     .inputs        = scdet_inputs,
     .outputs       = scdet_outputs,
     .activate      = activate,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -39,12 +39,19 @@
 #include "libavutil/pixdesc.h"
 #include "avfilter.h"
 #include "drawutils.h"
+#include "filters.h"
 #include "formats.h"
 #include "framesync.h"
 #include "internal.h"
 #include "ssim.h"
 #include "video.h"
 
+typedef struct QueuedFrame {
+    AVFrame *master;
+    AVFrame *ref;
+    double score[4];
+} QueuedFrame;
+
 typedef struct SSIMContext {
     const AVClass *class;
     FFFrameSync fs;
@@ -66,6 +73,9 @@ typedef struct SSIMContext {
     int (*ssim_plane)(AVFilterContext *ctx, void *arg,
                       int jobnr, int nb_jobs);
     SSIMDSPContext dsp;
+    int queue_size;
+    int nb_queued;
+    QueuedFrame *queue;
 } SSIMContext;
 
 #define OFFSET(x) offsetof(SSIMContext, x)
@@ -74,6 +84,7 @@ typedef struct SSIMContext {
 static const AVOption ssim_options[] = {
     {"stats_file", "Set file where to store per-frame difference information", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
     {"f",          "Set file where to store per-frame difference information", OFFSET(stats_file_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    {"queue",      "Set the number of frame pairs to score concurrently",      OFFSET(queue_size), AV_OPT_TYPE_INT, {.i64=1}, 1, 1024, FLAGS },
     { NULL }
 };
 
@@ -325,47 +336,53 @@ static double ssim_db(double ssim, double weight)
     return (fabs(weight - ssim) > 1e-9) ? 10.0 * log10(weight / (weight - ssim)) : INFINITY;
 }
 
-static int do_ssim(FFFrameSync *fs)
+static void fill_thread_data(SSIMContext *s, ThreadData *td,
+                             const AVFrame *master, const AVFrame *ref)
 {
-    AVFilterContext *ctx = fs->parent;
-    SSIMContext *s = ctx->priv;
-    AVFrame *master, *ref;
-    AVDictionary **metadata;
-    double c[4] = {0}, ssimv = 0.0;
-    ThreadData td;
-    int ret, i;
+    td->nb_components = s->nb_components;
+    td->dsp = &s->dsp;
+    td->max = s->max;
 
-    ret = ff_framesync_dualinput_get(fs, &master, &ref);
-    if (ret < 0)
-        return ret;
-    if (ctx->is_disabled || !ref)
-        return ff_filter_frame(ctx->outputs[0], master);
-    metadata = &master->metadata;
+    for (int n = 0; n < s->nb_components; n++) {
+        td->main_data[n] = master->data[n];
+        td->ref_data[n] = ref->data[n];
+        td->main_linesize[n] = master->linesize[n];
+        td->ref_linesize[n] = ref->linesize[n];
+        td->planewidth[n] = s->planewidth[n];
+        td->planeheight[n] = s->planeheight[n];
+    }
+}
 
-    s->nb_frames++;
+static int ssim_frames(AVFilterContext *ctx, void *arg,
+                       int jobnr, int nb_jobs)
+{
+    SSIMContext *s = ctx->priv;
 
-    td.nb_components = s->nb_components;
-    td.dsp = &s->dsp;
-    td.score = s->score;
-    td.temp = s->temp;
-    td.max = s->max;
+    for (int i = jobnr; i < s->nb_queued; i += nb_jobs) {
+        QueuedFrame *f = &s->queue[i];
+        double *score = f->score;
+        ThreadData td;
 
-    for (int n = 0; n < s->nb_components; n++) {
-        td.main_data[n] = master->data[n];
-        td.ref_data[n] = ref->data[n];
-        td.main_linesize[n] = master->linesize[n];
-        td.ref_linesize[n] = ref->linesize[n];
-        td.planewidth[n] = s->planewidth[n];
-        td.planeheight[n] = s->planeheight[n];
+        fill_thread_data(s, &td, f->master, f->ref);
+        td.score = &score;
+        td.temp = &s->temp[jobnr];
+        s->ssim_plane(ctx, &td, 0, 1);
     }
 
-    ctx->internal->execute(ctx, s->ssim_plane, &td, NULL, FFMIN((s->planeheight[1] + 3) >> 2, s->nb_threads));
+    return 0;
+}
 
-    for (i = 0; i < s->nb_components; i++) {
-        for (int j = 0; j < s->nb_threads; j++)
-            c[i] += s->score[j][i];
+static void update_stats(AVFilterContext *ctx, AVFrame *master, double *c)
+{
+    SSIMContext *s = ctx->priv;
+    AVDictionary **metadata = &master->metadata;
+    double ssimv = 0.0;
+    int i;
+
+    s->nb_frames++;
+
+    for (i = 0; i < s->nb_components; i++)
         c[i] = c[i] / (((s->planewidth[i] >> 2) - 1) * ((s->planeheight[i] >> 2) - 1));
-    }
 
     for (i = 0; i < s->nb_components; i++) {
         ssimv += s->coefs[i] * c[i];
@@ -391,6 +408,105 @@ static int do_ssim(FFFrameSync *fs)
 
         fprintf(s->stats_file, "All:%f (%f)\n", ssimv, ssim_db(ssimv, 1.0));
     }
+}
+
+static void free_queue(SSIMContext *s)
+{
+    for (int i = 0; i < s->nb_queued; i++) {
+        av_frame_free(&s->queue[i].master);
+        av_frame_free(&s->queue[i].ref);
+    }
+    av_freep(&s->queue);
+    s->nb_queued = 0;
+}
+
+/**
+ * Score all the queued frame pairs, one frame per job, then update the
+ * statistics and output the frames in order.
+ */
+static int flush_queue(AVFilterContext *ctx)
+{
+    SSIMContext *s = ctx->priv;
+    int ret = 0;
+
+    if (!s->nb_queued)
+        return 0;
+
+    ctx->internal->execute(ctx, ssim_frames, NULL, NULL,
+                           FFMIN(s->nb_queued, s->nb_threads));
+
+    for (int i = 0; i < s->nb_queued; i++) {
+        QueuedFrame *f = &s->queue[i];
+
+        av_frame_free(&f->ref);
+        if (ret < 0) {
+            av_frame_free(&f->master);
+            continue;
+        }
+        update_stats(ctx, f->master, f->score);
+        ret = ff_filter_frame(ctx->outputs[0], f->master);
+        f->master = NULL;
+    }
+    s->nb_queued = 0;
+
+    return ret;
+}
+
+static int flush_queue_on_eof(FFFrameSync *fs)
+{
+    return flush_queue(fs->parent);
+}
+
+static int do_ssim(FFFrameSync *fs)
+{
+    AVFilterContext *ctx = fs->parent;
+    SSIMContext *s = ctx->priv;
+    AVFrame *master, *ref;
+    double c[4] = {0};
+    ThreadData td;
+    int ret, i;
+
+    ret = ff_framesync_dualinput_get(fs, &master, &ref);
+    if (ret < 0)
+        return ret;
+    if (ctx->is_disabled || !ref) {
+        ret = flush_queue(ctx);
+        if (ret < 0) {
+            av_frame_free(&master);
+            return ret;
+        }
+        return ff_filter_frame(ctx->outputs[0], master);
+    }
+
+    if (s->queue_size > 1) {
+        QueuedFrame *f = &s->queue[s->nb_queued];
+
+        f->ref = av_frame_clone(ref);
+        if (!f->ref) {
+            av_frame_free(&master);
+            return AVERROR(ENOMEM);
+        }
+        f->master = master;
+        if (++s->nb_queued < s->queue_size) {
+            /* nothing was output, keep pulling frames */
+            ff_filter_set_ready(ctx, 100);
+            return 0;
+        }
+        return flush_queue(ctx);
+    }
+
+    fill_thread_data(s, &td, master, ref);
+    td.score = s->score;
+    td.temp = s->temp;
+
+    ctx->internal->execute(ctx, s->ssim_plane, &td, NULL, FFMIN((s->planeheight[1] + 3) >> 2, s->nb_threads));
+
+    for (i = 0; i < s->nb_components; i++) {
+        for (int j = 0; j < s->nb_threads; j++)
+            c[i] += s->score[j][i];
+    }
+
+    update_stats(ctx, master, c);
 
     return ff_filter_frame(ctx->outputs[0], master);
 }
@@ -416,6 +532,7 @@ static av_cold int init(AVFilterContext *ctx)
     }
 
     s->fs.on_event = do_ssim;
+    s->fs.on_eof   = flush_queue_on_eof;
     return 0;
 }
 
@@ -502,6 +619,13 @@ static int config_input_ref(AVFilterLink *inlink)
             return AVERROR(ENOMEM);
     }
 
+    free_queue(s);
+    if (s->queue_size > 1) {
+        s->queue = av_calloc(s->queue_size, sizeof(*s->queue));
+        if (!s->queue)
+            return AVERROR(ENOMEM);
+    }
+
     return 0;
 }
 
@@ -538,6 +662,7 @@ static int config_output(AVFilterLink *outlink)
 static int activate(AVFilterContext *ctx)
 {
     SSIMContext *s = ctx->priv;
+
     return ff_framesync_activate(&s->fs);
 }
 
@@ -545,6 +670,8 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     SSIMContext *s = ctx->priv;
 
+    free_queue(s);
+
     if (s->nb_frames > 0) {
         char buf[256];
         int i;
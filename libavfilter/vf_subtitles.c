@@ -60,6 +60,13 @@ typedef struct AssContext {
     int original_w, original_h;
     int shaping;
     FFDrawContext draw;
+
+    /* composited subtitles, reused while libass reports no change */
+    int cache_overlay;          ///< pixel format allows caching the overlay
+    int overlay_valid;
+    int overlay_x, overlay_y;   ///< position of the overlay in the frame
+    AVFrame *overlay_premul;    ///< subtitles blended over a black canvas
+    AVFrame *overlay_transp;    ///< remaining weight of the background, 255 = transparent
 } AssContext;
 
 #define OFFSET(x) offsetof(AssContext, x)
@@ -118,6 +125,11 @@ static av_cold int init(AVFilterContext *ctx)
         return AVERROR(EINVAL);
     }
 
+    ass->overlay_premul = av_frame_alloc();
+    ass->overlay_transp = av_frame_alloc();
+    if (!ass->overlay_premul || !ass->overlay_transp)
+        return AVERROR(ENOMEM);
+
     return 0;
 }
 
@@ -131,6 +143,8 @@ static av_cold void uninit(AVFilterContext *ctx)
         ass_renderer_done(ass->renderer);
     if (ass->library)
         ass_library_done(ass->library);
+    av_frame_free(&ass->overlay_premul);
+    av_frame_free(&ass->overlay_transp);
 }
 
 static int query_formats(AVFilterContext *ctx)
@@ -141,9 +155,19 @@ static int query_formats(AVFilterContext *ctx)
 static int config_input(AVFilterLink *inlink)
 {
     AssContext *ass = inlink->dst->priv;
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(inlink->format);
+    int i;
 
     ff_draw_init(&ass->draw, inlink->format, ass->alpha ? FF_DRAW_PROCESS_ALPHA : 0);
 
+    /* blending is affine in every 8 bit component, so the subtitles can be
+     * stored as a premultiplied color and a transparency per component */
+    ass->cache_overlay = 1;
+    for (i = 0; i < desc->nb_components; i++)
+        if (desc->comp[i].depth != 8)
+            ass->cache_overlay = 0;
+    ass->overlay_valid = 0;
+
     ass_set_frame_size  (ass->renderer, inlink->w, inlink->h);
     if (ass->original_w && ass->original_h)
         ass_set_aspect_ratio(ass->renderer, (double)inlink->w / inlink->h,
@@ -161,7 +185,7 @@ static int config_input(AVFilterLink *inlink)
 #define AA(c)  ((0xFF-(c)) &0xFF)
 
 static void overlay_ass_image(AssContext *ass, AVFrame *picref,
-                              const ASS_Image *image)
+                              const ASS_Image *image, int x0, int y0)
 {
     for (; image; image = image->next) {
         uint8_t rgba_color[] = {AR(image->color), AG(image->color), AB(image->color), AA(image->color)};
@@ -171,7 +195,104 @@ static void overlay_ass_image(AssContext *ass, AVFrame *picref,
                       picref->data, picref->linesize,
                       picref->width, picref->height,
                       image->bitmap, image->stride, image->w, image->h,
-                      3, 0, image->dst_x, image->dst_y);
+                      3, 0, image->dst_x - x0, image->dst_y - y0);
+    }
+}
+
+/**
+ * Composite the images over the bounding box they cover, once over a black
+ * and once over a white canvas. As blending is affine in the background,
+ * the two results give the premultiplied color and the transparency.
+ */
+static int render_overlay(AssContext *ass, const ASS_Image *image, int w, int h)
+{
+    const FFDrawContext *draw = &ass->draw;
+    const ASS_Image *img;
+    int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+    int i, ret, plane, x, y;
+
+    av_frame_unref(ass->overlay_premul);
+    av_frame_unref(ass->overlay_transp);
+
+    for (img = image; img; img = img->next) {
+        if (!img->w || !img->h)
+            continue;
+        x0 = FFMIN(x0, img->dst_x);
+        y0 = FFMIN(y0, img->dst_y);
+        x1 = FFMAX(x1, img->dst_x + img->w);
+        y1 = FFMAX(y1, img->dst_y + img->h);
+    }
+
+    /* keep the chroma sample grid of the frame */
+    x0 = FFMAX(x0, 0) & ~((1 << draw->hsub_max) - 1);
+    y0 = FFMAX(y0, 0) & ~((1 << draw->vsub_max) - 1);
+    x1 = FFMIN(FFALIGN(x1, 1 << draw->hsub_max), w);
+    y1 = FFMIN(FFALIGN(y1, 1 << draw->vsub_max), h);
+    if (x0 >= x1 || y0 >= y1)
+        return 0;
+
+    for (i = 0; i < 2; i++) {
+        AVFrame *canvas = i ? ass->overlay_transp : ass->overlay_premul;
+
+        canvas->format = draw->format;
+        canvas->width  = x1 - x0;
+        canvas->height = y1 - y0;
+        if ((ret = av_frame_get_buffer(canvas, 0)) < 0)
+            return ret;
+
+        for (plane = 0; plane < draw->nb_planes; plane++)
+            memset(canvas->data[plane], i ? 0xff : 0,
+                   canvas->linesize[plane] * AV_CEIL_RSHIFT(canvas->height, draw->vsub[plane]));
+
+        overlay_ass_image(ass, canvas, image, x0, y0);
+    }
+
+    for (plane = 0; plane < draw->nb_planes; plane++) {
+        const int bytes = AV_CEIL_RSHIFT(x1 - x0, draw->hsub[plane]) * draw->pixelstep[plane];
+        const int rows  = AV_CEIL_RSHIFT(y1 - y0, draw->vsub[plane]);
+        const uint8_t *premul = ass->overlay_premul->data[plane];
+        uint8_t *transp = ass->overlay_transp->data[plane];
+
+        for (y = 0; y < rows; y++) {
+            for (x = 0; x < bytes; x++)
+                transp[x] -= premul[x];
+            premul += ass->overlay_premul->linesize[plane];
+            transp += ass->overlay_transp->linesize[plane];
+        }
+    }
+
+    ass->overlay_x = x0;
+    ass->overlay_y = y0;
+
+    return 0;
+}
+
+static void blend_overlay(AssContext *ass, AVFrame *picref)
+{
+    const FFDrawContext *draw = &ass->draw;
+    const AVFrame *premul_frame = ass->overlay_premul;
+    const AVFrame *transp_frame = ass->overlay_transp;
+    int plane, x, y;
+
+    if (!premul_frame->data[0])
+        return;
+
+    for (plane = 0; plane < draw->nb_planes; plane++) {
+        const int bytes = AV_CEIL_RSHIFT(premul_frame->width,  draw->hsub[plane]) * draw->pixelstep[plane];
+        const int rows  = AV_CEIL_RSHIFT(premul_frame->height, draw->vsub[plane]);
+        const uint8_t *premul = premul_frame->data[plane];
+        const uint8_t *transp = transp_frame->data[plane];
+        uint8_t *dst = picref->data[plane] +
+                       (ass->overlay_y >> draw->vsub[plane]) * picref->linesize[plane] +
+                       (ass->overlay_x >> draw->hsub[plane]) * draw->pixelstep[plane];
+
+        for (y = 0; y < rows; y++) {
+            for (x = 0; x < bytes; x++)
+                dst[x] = premul[x] + (dst[x] * transp[x] + 127) / 255;
+            premul += premul_frame->linesize[plane];
+            transp += transp_frame->linesize[plane];
+            dst    += picref->linesize[plane];
+        }
     }
 }
 
@@ -180,7 +301,7 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     AVFilterContext *ctx = inlink->dst;
     AVFilterLink *outlink = ctx->outputs[0];
     AssContext *ass = ctx->priv;
-    int detect_change = 0;
+    int detect_change = 0, ret;
     double time_ms = picref->pts * av_q2d(inlink->time_base) * 1000;
     ASS_Image *image = ass_render_frame(ass->renderer, ass->track,
                                         time_ms, &detect_change);
@@ -188,7 +309,21 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *picref)
     if (detect_change)
         av_log(ctx, AV_LOG_DEBUG, "Change happened at time ms:%f\n", time_ms);
 
-    overlay_ass_image(ass, picref, image);
+    if (!ass->cache_overlay) {
+        overlay_ass_image(ass, picref, image, 0, 0);
+        return ff_filter_frame(outlink, picref);
+    }
+
+    if (detect_change || !ass->overlay_valid) {
+        ass->overlay_valid = 0;
+        if ((ret = render_overlay(ass, image, picref->width, picref->height)) < 0) {
+            av_frame_free(&picref);
+            return ret;
+        }
+        ass->overlay_valid = 1;
+    }
+
+    blend_overlay(ass, picref);
 
     return ff_filter_frame(outlink, picref);
 }
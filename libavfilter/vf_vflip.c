@@ -151,5 +151,6 @@ AVFilter ff_vf_vflip = {
     .priv_class  = &vflip_class,
     .inputs      = avfilter_vf_vflip_inputs,
     .outputs     = avfilter_vf_vflip_outputs,
+    .reconfigure = ff_filter_reconfigure_stateless,
     .flags       = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
 };
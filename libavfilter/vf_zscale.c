@@ -45,6 +45,8 @@
 #include "libavutil/avassert.h"
 
 #define ZIMG_ALIGNMENT 32
+#define MAX_THREADS 32
+#define MIN_SLICE_HEIGHT 16
 
 static const char *const var_names[] = {
     "in_w",   "iw",
@@ -114,13 +116,18 @@ typedef struct ZScaleContext {
 
     int force_original_aspect_ratio;
 
-    void *tmp;
-    size_t tmp_size;
+    int nb_threads;
+    int out_slice_start[MAX_THREADS], out_slice_end[MAX_THREADS];
+    double in_slice_start[MAX_THREADS], in_slice_end[MAX_THREADS];
+
+    int slice_ret[MAX_THREADS];
+    void *tmp[MAX_THREADS];
+    size_t tmp_size[MAX_THREADS];
 
     zimg_image_format src_format, dst_format;
     zimg_image_format alpha_src_format, alpha_dst_format;
     zimg_graph_builder_params alpha_params, params;
-    zimg_filter_graph *alpha_graph, *graph;
+    zimg_filter_graph *alpha_graph[MAX_THREADS], *graph[MAX_THREADS];
 
     enum AVColorSpace in_colorspace, out_colorspace;
     enum AVColorTransferCharacteristic in_trc, out_trc;
@@ -506,6 +513,150 @@ static int graph_build(zimg_filter_graph **graph, zimg_graph_builder_params *par
     return 0;
 }
 
+/**
+ * Build the graphs of every slice job. The output of a job is a band of
+ * whole rows, and the matching part of the input is selected through the
+ * active region, so the resampler still sees the neighbouring input rows.
+ */
+static int graphs_build(ZScaleContext *s, int with_alpha)
+{
+    int i, ret;
+
+    for (i = 0; i < s->nb_threads; i++) {
+        zimg_image_format src_format = s->src_format;
+        zimg_image_format dst_format = s->dst_format;
+
+        src_format.active_region.left   = 0;
+        src_format.active_region.top    = s->in_slice_start[i];
+        src_format.active_region.width  = src_format.width;
+        src_format.active_region.height = s->in_slice_end[i] - s->in_slice_start[i];
+        dst_format.height = s->out_slice_end[i] - s->out_slice_start[i];
+
+        ret = graph_build(&s->graph[i], &s->params, &src_format, &dst_format,
+                          &s->tmp[i], &s->tmp_size[i]);
+        if (ret < 0)
+            return ret;
+
+        if (with_alpha) {
+            src_format = s->alpha_src_format;
+            dst_format = s->alpha_dst_format;
+
+            src_format.active_region.left   = 0;
+            src_format.active_region.top    = s->in_slice_start[i];
+            src_format.active_region.width  = src_format.width;
+            src_format.active_region.height = s->in_slice_end[i] - s->in_slice_start[i];
+            dst_format.height = s->out_slice_end[i] - s->out_slice_start[i];
+
+            ret = graph_build(&s->alpha_graph[i], &s->alpha_params, &src_format, &dst_format,
+                              &s->tmp[i], &s->tmp_size[i]);
+            if (ret < 0)
+                return ret;
+        }
+    }
+
+    for (; i < MAX_THREADS; i++) {
+        zimg_filter_graph_free(s->graph[i]);
+        zimg_filter_graph_free(s->alpha_graph[i]);
+        s->graph[i] = s->alpha_graph[i] = NULL;
+    }
+
+    return 0;
+}
+
+static void slices_init(AVFilterContext *ctx, int in_h, int out_h,
+                        const AVPixFmtDescriptor *odesc)
+{
+    ZScaleContext *s = ctx->priv;
+    const int align = 1 << odesc->log2_chroma_h;
+    int i;
+
+    s->nb_threads = av_clip(FFMIN(ff_filter_get_nb_threads(ctx), out_h / MIN_SLICE_HEIGHT),
+                            1, MAX_THREADS);
+    /* the dither patterns and the error diffusion would restart at every
+     * band, so dithered conversions are done as a whole */
+    if (s->dither != ZIMG_DITHER_NONE)
+        s->nb_threads = 1;
+
+    for (i = 0; i < s->nb_threads; i++) {
+        s->out_slice_start[i] = ((out_h *  i     ) / s->nb_threads) & ~(align - 1);
+        s->out_slice_end[i]   = ((out_h * (i + 1)) / s->nb_threads) & ~(align - 1);
+    }
+    s->out_slice_end[s->nb_threads - 1] = out_h;
+
+    for (i = 0; i < s->nb_threads; i++) {
+        s->in_slice_start[i] = s->out_slice_start[i] * (double)in_h / out_h;
+        s->in_slice_end[i]   = s->out_slice_end[i]   * (double)in_h / out_h;
+    }
+}
+
+typedef struct ThreadData {
+    const AVPixFmtDescriptor *desc, *odesc;
+    AVFrame *in, *out;
+} ThreadData;
+
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    ZScaleContext *s = ctx->priv;
+    ThreadData *td = arg;
+    const AVPixFmtDescriptor *desc  = td->desc;
+    const AVPixFmtDescriptor *odesc = td->odesc;
+    AVFrame *in  = td->in;
+    AVFrame *out = td->out;
+    const int out_slice_start = s->out_slice_start[jobnr];
+    const int out_slice_end   = s->out_slice_end[jobnr];
+    zimg_image_buffer_const src_buf = { ZIMG_API_VERSION };
+    zimg_image_buffer dst_buf = { ZIMG_API_VERSION };
+    int ret, plane;
+
+    for (plane = 0; plane < 3; plane++) {
+        const int vsub = plane ? odesc->log2_chroma_h : 0;
+        int p = desc->comp[plane].plane;
+
+        src_buf.plane[plane].data   = in->data[p];
+        src_buf.plane[plane].stride = in->linesize[p];
+        src_buf.plane[plane].mask   = -1;
+
+        p = odesc->comp[plane].plane;
+        dst_buf.plane[plane].data   = out->data[p] + (out_slice_start >> vsub) * out->linesize[p];
+        dst_buf.plane[plane].stride = out->linesize[p];
+        dst_buf.plane[plane].mask   = -1;
+    }
+
+    ret = zimg_filter_graph_process(s->graph[jobnr], &src_buf, &dst_buf, s->tmp[jobnr], 0, 0, 0, 0);
+    if (ret)
+        return print_zimg_error(ctx);
+
+    if (desc->flags & AV_PIX_FMT_FLAG_ALPHA && odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
+        src_buf.plane[0].data   = in->data[3];
+        src_buf.plane[0].stride = in->linesize[3];
+        src_buf.plane[0].mask   = -1;
+
+        dst_buf.plane[0].data   = out->data[3] + out_slice_start * out->linesize[3];
+        dst_buf.plane[0].stride = out->linesize[3];
+        dst_buf.plane[0].mask   = -1;
+
+        ret = zimg_filter_graph_process(s->alpha_graph[jobnr], &src_buf, &dst_buf, s->tmp[jobnr], 0, 0, 0, 0);
+        if (ret)
+            return print_zimg_error(ctx);
+    } else if (odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
+        int x, y;
+
+        if (odesc->flags & AV_PIX_FMT_FLAG_FLOAT) {
+            for (y = out_slice_start; y < out_slice_end; y++) {
+                for (x = 0; x < out->width; x++) {
+                    AV_WN32(out->data[3] + x * odesc->comp[3].step + y * out->linesize[3],
+                            av_float2int(1.0f));
+                }
+            }
+        } else {
+            for (y = out_slice_start; y < out_slice_end; y++)
+                memset(out->data[3] + y * out->linesize[3], 0xff, out->width);
+        }
+    }
+
+    return 0;
+}
+
 static int realign_frame(const AVPixFmtDescriptor *desc, AVFrame **frame)
 {
     AVFrame *aligned = NULL;
@@ -546,14 +697,14 @@ fail:
 
 static int filter_frame(AVFilterLink *link, AVFrame *in)
 {
-    ZScaleContext *s = link->dst->priv;
-    AVFilterLink *outlink = link->dst->outputs[0];
+    AVFilterContext *ctx = link->dst;
+    ZScaleContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(link->format);
     const AVPixFmtDescriptor *odesc = av_pix_fmt_desc_get(outlink->format);
-    zimg_image_buffer_const src_buf = { ZIMG_API_VERSION };
-    zimg_image_buffer dst_buf = { ZIMG_API_VERSION };
+    ThreadData td;
     char buf[32];
-    int ret = 0, plane;
+    int ret = 0, i;
     AVFrame *out = NULL;
 
     if ((ret = realign_frame(desc, &in)) < 0)
@@ -626,11 +777,6 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         if (s->chromal != -1)
             out->chroma_location = (int)s->dst_format.chroma_location - 1;
 
-        ret = graph_build(&s->graph, &s->params, &s->src_format, &s->dst_format,
-                          &s->tmp, &s->tmp_size);
-        if (ret < 0)
-            goto fail;
-
         s->in_colorspace  = in->colorspace;
         s->in_trc         = in->color_trc;
         s->in_primaries   = in->color_primaries;
@@ -660,14 +806,13 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
             s->alpha_dst_format.depth = odesc->comp[0].depth;
             s->alpha_dst_format.pixel_type = (odesc->flags & AV_PIX_FMT_FLAG_FLOAT) ? ZIMG_PIXEL_FLOAT : odesc->comp[0].depth > 8 ? ZIMG_PIXEL_WORD : ZIMG_PIXEL_BYTE;
             s->alpha_dst_format.color_family = ZIMG_COLOR_GREY;
-
-            zimg_filter_graph_free(s->alpha_graph);
-            s->alpha_graph = zimg_filter_graph_build(&s->alpha_src_format, &s->alpha_dst_format, &s->alpha_params);
-            if (!s->alpha_graph) {
-                ret = print_zimg_error(link->dst);
-                goto fail;
-            }
         }
+
+        slices_init(ctx, in->height, out->height, odesc);
+
+        ret = graphs_build(s, desc->flags & AV_PIX_FMT_FLAG_ALPHA && odesc->flags & AV_PIX_FMT_FLAG_ALPHA);
+        if (ret < 0)
+            goto fail;
     }
 
     if (s->colorspace != -1)
@@ -687,52 +832,17 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
               (int64_t)in->sample_aspect_ratio.den * outlink->w * link->h,
               INT_MAX);
 
-    for (plane = 0; plane < 3; plane++) {
-        int p = desc->comp[plane].plane;
-        src_buf.plane[plane].data   = in->data[p];
-        src_buf.plane[plane].stride = in->linesize[p];
-        src_buf.plane[plane].mask   = -1;
-
-        p = odesc->comp[plane].plane;
-        dst_buf.plane[plane].data   = out->data[p];
-        dst_buf.plane[plane].stride = out->linesize[p];
-        dst_buf.plane[plane].mask   = -1;
-    }
-
-    ret = zimg_filter_graph_process(s->graph, &src_buf, &dst_buf, s->tmp, 0, 0, 0, 0);
-    if (ret) {
-        ret = print_zimg_error(link->dst);
-        goto fail;
-    }
-
-    if (desc->flags & AV_PIX_FMT_FLAG_ALPHA && odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
-        src_buf.plane[0].data   = in->data[3];
-        src_buf.plane[0].stride = in->linesize[3];
-        src_buf.plane[0].mask   = -1;
-
-        dst_buf.plane[0].data   = out->data[3];
-        dst_buf.plane[0].stride = out->linesize[3];
-        dst_buf.plane[0].mask   = -1;
+    td.desc  = desc;
+    td.odesc = odesc;
+    td.in    = in;
+    td.out   = out;
 
-        ret = zimg_filter_graph_process(s->alpha_graph, &src_buf, &dst_buf, s->tmp, 0, 0, 0, 0);
-        if (ret) {
-            ret = print_zimg_error(link->dst);
+    ctx->internal->execute(ctx, filter_slice, &td, s->slice_ret, s->nb_threads);
+    for (i = 0; i < s->nb_threads; i++) {
+        if (s->slice_ret[i] < 0) {
+            ret = s->slice_ret[i];
             goto fail;
         }
-    } else if (odesc->flags & AV_PIX_FMT_FLAG_ALPHA) {
-        int x, y;
-
-        if (odesc->flags & AV_PIX_FMT_FLAG_FLOAT) {
-            for (y = 0; y < out->height; y++) {
-                for (x = 0; x < out->width; x++) {
-                    AV_WN32(out->data[3] + x * odesc->comp[3].step + y * out->linesize[3],
-                            av_float2int(1.0f));
-                }
-            }
-        } else {
-            for (y = 0; y < outlink->h; y++)
-                memset(out->data[3] + y * out->linesize[3], 0xff, outlink->w);
-        }
     }
 
 fail:
@@ -748,11 +858,15 @@ fail:
 static av_cold void uninit(AVFilterContext *ctx)
 {
     ZScaleContext *s = ctx->priv;
-
-    zimg_filter_graph_free(s->graph);
-    zimg_filter_graph_free(s->alpha_graph);
-    av_freep(&s->tmp);
-    s->tmp_size = 0;
+    int i;
+
+    for (i = 0; i < MAX_THREADS; i++) {
+        zimg_filter_graph_free(s->graph[i]);
+        zimg_filter_graph_free(s->alpha_graph[i]);
+        s->graph[i] = s->alpha_graph[i] = NULL;
+        av_freep(&s->tmp[i]);
+        s->tmp_size[i] = 0;
+    }
 }
 
 static int process_command(AVFilterContext *ctx, const char *cmd, const char *args,
@@ -938,4 +1052,5 @@ AVFilter ff_vf_zscale = {
     .inputs          = avfilter_vf_zscale_inputs,
     .outputs         = avfilter_vf_zscale_outputs,
     .process_command = process_command,
+    .flags           = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -19,6 +19,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "libavutil/avstring.h"
+#include "libavutil/name_table.h"
 #include "libavutil/thread.h"
 #include "libavformat/internal.h"
 #include "avformat.h"
@@ -571,6 +573,51 @@ const AVInputFormat *av_demuxer_iterate(void **opaque)
     return f;
 }
 
+/* open addressing table of demuxer_list indices plus one, with one entry
+ * per comma separated name of each demuxer */
+#define DEMUXER_HASH_SIZE (4 * FF_ARRAY_ELEMS(demuxer_list))
+static uint16_t demuxer_hash[DEMUXER_HASH_SIZE];
+static AVOnce demuxer_hash_init = AV_ONCE_INIT;
+
+static int match_demuxer_name(const char *name, int idx)
+{
+    return av_match_name(name, demuxer_list[idx]->name);
+}
+
+static void init_demuxer_hash(void)
+{
+    for (int i = 0; demuxer_list[i]; i++) {
+        const char *name = demuxer_list[i]->name;
+
+        while (*name) {
+            size_t len = strcspn(name, ",");
+            char alias[64];
+
+            av_strlcpy(alias, name, FFMIN(len + 1, sizeof(alias)));
+
+            /* several demuxers may share a name, keep the first one */
+            avpriv_name_table_add(demuxer_hash, DEMUXER_HASH_SIZE, alias, 1, i,
+                                  match_demuxer_name);
+            name += len + (name[len] == ',');
+        }
+    }
+}
+
+const AVInputFormat *ff_find_demuxer(const char *name, void **opaque)
+{
+    int idx;
+
+    ff_thread_once(&demuxer_hash_init, init_demuxer_hash);
+
+    idx = avpriv_name_table_find(demuxer_hash, DEMUXER_HASH_SIZE, name, 1,
+                                 match_demuxer_name);
+    if (idx >= 0)
+        return demuxer_list[idx];
+
+    *opaque = (void*)(uintptr_t)(FF_ARRAY_ELEMS(demuxer_list) - 1);
+    return NULL;
+}
+
 static AVMutex avpriv_register_devices_mutex = AV_MUTEX_INITIALIZER;
 
 #if FF_API_NEXT
@@ -1855,6 +1855,30 @@ typedef struct AVFormatContext {
      * - decoding: set by user
      */
     int max_probe_packets;
+
+    /**
+     * Number of threads used by avformat_find_stream_info() to decode the
+     * packets of different streams concurrently, 0 for automatic.
+     * With more than one thread, packets are decoded in batches, so slightly
+     * more data than needed may be read.
+     * - encoding: unused
+     * - decoding: set by user
+     */
+    int probe_threads;
+
+    /**
+     * If set, avformat_find_stream_info() remembers its results in a
+     * process wide cache and reuses them, without reading any packet, when
+     * the same input is opened again. Only local files are cached; they are
+     * identified by their URL, size, modification time and a checksum of the
+     * data following the header, and only reused with the same probing
+     * options (probesize, max_analyze_duration, fps_probe_size,
+     * codec_whitelist and the options given for each stream). The cache
+     * holds the last few inputs and lasts until the process exits.
+     * - encoding: unused
+     * - decoding: set by user
+     */
+    int probe_cache;
 } AVFormatContext;
 
 #if FF_API_FORMAT_GET_SET
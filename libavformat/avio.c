@@ -253,10 +253,9 @@ int ffurl_handshake(URLContext *c)
 
 static const struct URLProtocol *url_find_protocol(const char *filename)
 {
-    const URLProtocol **protocols;
+    const URLProtocol *up;
     char proto_str[128], proto_nested[128], *ptr;
     size_t proto_len = strspn(filename, URL_SCHEME_CHARS);
-    int i;
 
     if (filename[proto_len] != ':' &&
         (strncmp(filename, "subfile,", 8) || !strchr(filename + proto_len + 1, ':')) ||
@@ -270,22 +269,9 @@ static const struct URLProtocol *url_find_protocol(const char *filename)
     if ((ptr = strchr(proto_nested, '+')))
         *ptr = '\0';
 
-    protocols = ffurl_get_protocols(NULL, NULL);
-    if (!protocols)
-        return NULL;
-    for (i = 0; protocols[i]; i++) {
-            const URLProtocol *up = protocols[i];
-        if (!strcmp(proto_str, up->name)) {
-            av_freep(&protocols);
-            return up;
-        }
-        if (up->flags & URL_PROTOCOL_FLAG_NESTED_SCHEME &&
-            !strcmp(proto_nested, up->name)) {
-            av_freep(&protocols);
-            return up;
-        }
-    }
-    av_freep(&protocols);
+    up = ffurl_find_protocol(proto_str, proto_nested);
+    if (up)
+        return up;
     if (av_strstart(filename, "https:", NULL) || av_strstart(filename, "tls:", NULL))
         av_log(NULL, AV_LOG_WARNING, "https protocol not found, recompile FFmpeg with "
                                      "openssl, gnutls or securetransport enabled.\n");
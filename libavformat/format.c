@@ -119,6 +119,12 @@ ff_const59 AVInputFormat *av_find_input_format(const char *short_name)
 {
     const AVInputFormat *fmt = NULL;
     void *i = 0;
+
+    /* lists of names are rare, look them up among all formats */
+    if (short_name && !strchr(short_name, ',') &&
+        (fmt = ff_find_demuxer(short_name, &i)))
+        return (AVInputFormat*)fmt;
+
     while ((fmt = av_demuxer_iterate(&i)))
         if (av_match_name(short_name, fmt->name))
             return (AVInputFormat*)fmt;
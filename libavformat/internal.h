@@ -147,6 +147,12 @@ struct AVFormatInternal {
      * Set if chapter ids are strictly monotonic.
      */
     int chapter_ids_monotonic;
+
+    /**
+     * Queue of the probe decodes deferred by avformat_find_stream_info(),
+     * NULL if they are not deferred.
+     */
+    struct ProbeDecodeQueue *probe_decode_queue;
 };
 
 struct AVStreamInternal {
@@ -781,6 +787,16 @@ enum AVWriteUncodedFrameFlags {
  */
 int ff_copy_whiteblacklists(AVFormatContext *dst, const AVFormatContext *src);
 
+/**
+ * Find the first registered demuxer having name as one of its comma
+ * separated names, compared case insensitively.
+ *
+ * @param name name without any comma
+ * @param opaque if no demuxer is found, set so that av_demuxer_iterate()
+ *               continues with the input devices
+ */
+const AVInputFormat *ff_find_demuxer(const char *name, void **opaque);
+
 /**
  * Returned by demuxers to indicate that data was consumed but discarded
  * (ignored streams or junk data). The framework will re-call the demuxer.
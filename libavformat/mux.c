@@ -26,6 +26,7 @@
 #include "libavutil/dict.h"
 #include "libavutil/pixdesc.h"
 #include "libavutil/timestamp.h"
+#include "libavutil/trace.h"
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/internal.h"
@@ -740,6 +741,7 @@ static int write_packet(AVFormatContext *s, AVPacket *pkt)
         }
     }
 
+    av_trace_begin("mux", s->oformat->name);
     if ((pkt->flags & AV_PKT_FLAG_UNCODED_FRAME)) {
         AVFrame **frame = (AVFrame **)pkt->data;
         av_assert0(pkt->size == sizeof(*frame));
@@ -747,6 +749,7 @@ static int write_packet(AVFormatContext *s, AVPacket *pkt)
     } else {
         ret = s->oformat->write_packet(s, pkt);
     }
+    av_trace_end();
 
     if (s->pb && ret >= 0) {
         flush_if_needed(s);
@@ -20,6 +20,8 @@
 
 #include "libavutil/avstring.h"
 #include "libavutil/mem.h"
+#include "libavutil/name_table.h"
+#include "libavutil/thread.h"
 
 #include "url.h"
 
@@ -157,3 +159,45 @@ const URLProtocol **ffurl_get_protocols(const char *whitelist,
 
     return ret;
 }
+
+/* open addressing table of url_protocols indices plus one, by name */
+#define PROTOCOL_HASH_SIZE (2 * FF_ARRAY_ELEMS(url_protocols))
+static uint16_t protocol_hash[PROTOCOL_HASH_SIZE];
+static AVOnce protocol_hash_init = AV_ONCE_INIT;
+
+static int match_protocol_name(const char *name, int idx)
+{
+    return !strcmp(url_protocols[idx]->name, name);
+}
+
+static void init_protocol_hash(void)
+{
+    for (int i = 0; url_protocols[i]; i++)
+        avpriv_name_table_add(protocol_hash, PROTOCOL_HASH_SIZE, url_protocols[i]->name,
+                              0, i, match_protocol_name);
+}
+
+/* index of the first protocol with the given name, -1 if there is none */
+static int find_protocol_index(const char *name)
+{
+    return avpriv_name_table_find(protocol_hash, PROTOCOL_HASH_SIZE, name, 0,
+                                  match_protocol_name);
+}
+
+const URLProtocol *ffurl_find_protocol(const char *proto_str,
+                                       const char *proto_nested)
+{
+    int idx, idx_nested;
+
+    ff_thread_once(&protocol_hash_init, init_protocol_hash);
+
+    idx        = find_protocol_index(proto_str);
+    idx_nested = find_protocol_index(proto_nested);
+    if (idx_nested >= 0 &&
+        !(url_protocols[idx_nested]->flags & URL_PROTOCOL_FLAG_NESTED_SCHEME))
+        idx_nested = -1;
+
+    if (idx < 0 || (idx_nested >= 0 && idx_nested < idx))
+        idx = idx_nested;
+    return idx >= 0 ? url_protocols[idx] : NULL;
+}
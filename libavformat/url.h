@@ -341,6 +341,15 @@ const AVClass *ff_urlcontext_child_class_iterate(void **iter);
 const URLProtocol **ffurl_get_protocols(const char *whitelist,
                                         const char *blacklist);
 
+/**
+ * Find the first registered protocol named proto_str, or named proto_nested
+ * and accepting nested schemes (URL_PROTOCOL_FLAG_NESTED_SCHEME).
+ *
+ * @return the protocol, or NULL if there is none
+ */
+const URLProtocol *ffurl_find_protocol(const char *proto_str,
+                                       const char *proto_nested);
+
 typedef struct URLComponents {
     const char *url;        /**< whole URL, for reference */
     const char *scheme;     /**< possibly including lavf-specific options */
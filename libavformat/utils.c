@@ -20,20 +20,25 @@
  */
 
 #include <stdint.h>
+#include <sys/stat.h>
 
 #include "config.h"
 
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
+#include "libavutil/bprint.h"
+#include "libavutil/crc.h"
 #include "libavutil/dict.h"
 #include "libavutil/internal.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/pixfmt.h"
+#include "libavutil/slicethread.h"
 #include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "libavutil/timestamp.h"
+#include "libavutil/trace.h"
 
 #include "libavcodec/bytestream.h"
 #include "libavcodec/internal.h"
@@ -47,6 +52,7 @@
 #if CONFIG_NETWORK
 #include "network.h"
 #endif
+#include "os_support.h"
 #include "url.h"
 
 #include "libavutil/ffversion.h"
@@ -820,7 +826,9 @@ int ff_read_packet(AVFormatContext *s, AVPacket *pkt)
             }
         }
 
+        av_trace_begin("demux", s->iformat->name);
         ret = s->iformat->read_packet(s, pkt);
+        av_trace_end();
         if (ret < 0) {
             av_packet_unref(pkt);
 
@@ -1514,6 +1522,8 @@ static int64_t ts_to_samples(AVStream *st, int64_t ts)
     return av_rescale(ts, st->time_base.num * st->codecpar->sample_rate, st->time_base.den);
 }
 
+static void probe_decode_sync(struct ProbeDecodeQueue *q, int stream_index);
+
 static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
 {
     int ret, i, got_packet = 0;
@@ -1527,6 +1537,8 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
         if (ret < 0) {
             if (ret == AVERROR(EAGAIN))
                 return ret;
+            if (s->internal->probe_decode_queue)
+                probe_decode_sync(s->internal->probe_decode_queue, -1);
             /* flush the parsers */
             for (i = 0; i < s->nb_streams; i++) {
                 st = s->streams[i];
@@ -1540,6 +1552,11 @@ static int read_frame_internal(AVFormatContext *s, AVPacket *pkt)
         ret = 0;
         st  = s->streams[pkt->stream_index];
 
+        /* the parser and the context update below must see the state left
+         * by the deferred probe decodes of the previous packets */
+        if (s->internal->probe_decode_queue)
+            probe_decode_sync(s->internal->probe_decode_queue, pkt->stream_index);
+
         st->event_flags |= AVSTREAM_EVENT_FLAG_NEW_PACKETS;
 
         /* update context if required */
@@ -3575,6 +3592,413 @@ static int add_coded_side_data(AVStream *st, AVCodecContext *avctx)
     return 0;
 }
 
+/* Packets waiting to be decoded by try_decode_frame() when the probe decodes
+ * of the different streams run on several threads. The pending decodes of a
+ * stream are run before anything else reads or writes the codec context of
+ * that stream, so that each stream is probed in the same order as with a
+ * single thread; only the decodes of different streams overlap. */
+typedef struct ProbeDecodePacket {
+    AVPacket *pkt;
+    int stream_index;
+    int nb_frames;              ///< codec_info_nb_frames when it was read
+    AVDictionary **options;
+} ProbeDecodePacket;
+
+typedef struct ProbeDecodeQueue {
+    AVFormatContext *ic;
+    AVSliceThread *thread;
+    ProbeDecodePacket *pending;
+    int nb_pending, max_pending;
+    int *streams;               ///< distinct stream indices in pending
+    int nb_streams;
+} ProbeDecodeQueue;
+
+static void probe_decode_worker(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    ProbeDecodeQueue *q = priv;
+    const int stream_index = q->streams[jobnr];
+    AVStream *st = q->ic->streams[stream_index];
+    const int nb_frames = st->codec_info_nb_frames;
+    int i;
+
+    /* only this job touches this stream, the packets of a stream are
+     * decoded in the order they were read */
+    for (i = 0; i < q->nb_pending; i++) {
+        ProbeDecodePacket *p = &q->pending[i];
+        if (p->stream_index != stream_index)
+            continue;
+        st->codec_info_nb_frames = p->nb_frames;
+        try_decode_frame(q->ic, st, p->pkt, p->options);
+    }
+    st->codec_info_nb_frames = nb_frames;
+}
+
+static void probe_decode_flush(ProbeDecodeQueue *q)
+{
+    int i, j;
+
+    if (!q->nb_pending)
+        return;
+
+    q->nb_streams = 0;
+    for (i = 0; i < q->nb_pending; i++) {
+        for (j = 0; j < q->nb_streams; j++)
+            if (q->streams[j] == q->pending[i].stream_index)
+                break;
+        if (j == q->nb_streams)
+            q->streams[q->nb_streams++] = q->pending[i].stream_index;
+    }
+    avpriv_slicethread_execute(q->thread, q->nb_streams, 0);
+
+    for (i = 0; i < q->nb_pending; i++)
+        av_packet_free(&q->pending[i].pkt);
+    q->nb_pending = 0;
+}
+
+/**
+ * Run the pending decodes if some are for the given stream, or in any case
+ * if stream_index is negative.
+ */
+static void probe_decode_sync(ProbeDecodeQueue *q, int stream_index)
+{
+    int i;
+
+    for (i = 0; i < q->nb_pending; i++)
+        if (stream_index < 0 || q->pending[i].stream_index == stream_index)
+            break;
+    if (i < q->nb_pending)
+        probe_decode_flush(q);
+}
+
+static int probe_decode_init(ProbeDecodeQueue *q, AVFormatContext *ic)
+{
+    int ret;
+
+    memset(q, 0, sizeof(*q));
+    if (ic->probe_threads == 1)
+        return 0;
+
+    ret = avpriv_slicethread_create(&q->thread, q, probe_decode_worker, NULL,
+                                    ic->probe_threads);
+    if (ret <= 1) {
+        /* no threading support or a single core, decode serially */
+        avpriv_slicethread_free(&q->thread);
+        return 0;
+    }
+
+    ic->internal->probe_decode_queue = q;
+    q->ic          = ic;
+    q->max_pending = 16 * ret;
+    q->pending     = av_calloc(q->max_pending, sizeof(*q->pending));
+    q->streams     = av_calloc(q->max_pending, sizeof(*q->streams));
+    if (!q->pending || !q->streams)
+        return AVERROR(ENOMEM);
+    return 0;
+}
+
+static void probe_decode_uninit(ProbeDecodeQueue *q)
+{
+    int i;
+
+    if (q->ic)
+        q->ic->internal->probe_decode_queue = NULL;
+
+    for (i = 0; i < q->nb_pending; i++)
+        av_packet_free(&q->pending[i].pkt);
+    av_freep(&q->pending);
+    av_freep(&q->streams);
+    avpriv_slicethread_free(&q->thread);
+}
+
+/**
+ * Decode the packet with try_decode_frame(), or queue it for the probe
+ * decoding threads.
+ */
+static int probe_decode_packet(ProbeDecodeQueue *q, AVFormatContext *ic, AVStream *st,
+                               const AVPacket *pkt, AVDictionary **options)
+{
+    ProbeDecodePacket *p;
+
+    if (!q->thread) {
+        try_decode_frame(ic, st, pkt, options);
+        return 0;
+    }
+
+    if (q->nb_pending == q->max_pending)
+        probe_decode_flush(q);
+    p = &q->pending[q->nb_pending];
+    p->pkt = av_packet_clone(pkt);
+    if (!p->pkt)
+        return AVERROR(ENOMEM);
+    p->stream_index = st->index;
+    p->nb_frames    = st->codec_info_nb_frames;
+    p->options      = options;
+    q->nb_pending++;
+    return 0;
+}
+
+/* Results of avformat_find_stream_info(), kept when probe_cache is set.
+ * The oldest entry is replaced once all are used, and entries stay valid
+ * only as long as the size and modification time of their file match. */
+#define PROBE_CACHE_ENTRIES   16
+#define PROBE_CACHE_HASH_SIZE 4096
+
+typedef struct ProbeCacheStream {
+    enum AVMediaType codec_type; ///< as set by the demuxer before probing
+    enum AVCodecID codec_id;     ///< as set by the demuxer before probing
+    AVCodecParameters *par;
+    AVRational r_frame_rate;
+    AVRational avg_frame_rate;
+    AVRational sample_aspect_ratio;
+    AVRational time_base;        ///< of the internal codec context
+    int ticks_per_frame;
+    int coded_width, coded_height;
+    int64_t start_time;
+    int64_t duration;
+    int disposition;
+    int codec_info_nb_frames;
+} ProbeCacheStream;
+
+typedef struct ProbeCacheEntry {
+    char *url;
+    char *settings;              ///< the probing options, see probe_cache_settings()
+    const AVInputFormat *iformat;
+    int64_t size;
+    int64_t mtime;
+    uint32_t crc;
+    ProbeCacheStream *streams;
+    int nb_streams;
+    int64_t start_time;
+    int64_t duration;
+    int64_t bit_rate;
+    enum AVDurationEstimationMethod duration_estimation_method;
+} ProbeCacheEntry;
+
+static ProbeCacheEntry probe_cache[PROBE_CACHE_ENTRIES];
+static int probe_cache_next;
+static AVMutex probe_cache_mutex = AV_MUTEX_INITIALIZER;
+
+static void probe_cache_entry_free(ProbeCacheEntry *e)
+{
+    int i;
+
+    for (i = 0; i < e->nb_streams; i++)
+        avcodec_parameters_free(&e->streams[i].par);
+    av_freep(&e->streams);
+    av_freep(&e->url);
+    av_freep(&e->settings);
+    memset(e, 0, sizeof(*e));
+}
+
+/**
+ * Describe the options which change the results of probing: the limits
+ * of ic and the options given for each stream. It must be called before
+ * the codecs are opened, which take their options out of the dictionaries.
+ *
+ * @return a string to be freed with av_free(), NULL on allocation failure
+ */
+static char *probe_cache_settings(AVFormatContext *ic, AVDictionary **options,
+                                  int nb_streams)
+{
+    const AVDictionaryEntry *t;
+    AVBPrint bp;
+    char *str;
+    int i;
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprintf(&bp, "probesize=%"PRId64":analyzeduration=%"PRId64
+               ":fpsprobesize=%d:max_ts_probe=%d:skip_estimate_duration_from_pts=%d"
+               ":codec_whitelist=%s",
+               ic->probesize, ic->max_analyze_duration, ic->fps_probe_size,
+               ic->max_ts_probe, ic->skip_estimate_duration_from_pts,
+               ic->codec_whitelist ? ic->codec_whitelist : "");
+    for (i = 0; options && i < nb_streams; i++) {
+        t = NULL;
+        while ((t = av_dict_get(options[i], "", t, AV_DICT_IGNORE_SUFFIX)))
+            av_bprintf(&bp, ":%d:%s=%s", i, t->key, t->value);
+    }
+    if (av_bprint_finalize(&bp, &str) < 0)
+        return NULL;
+    return str;
+}
+
+/**
+ * Identify the input of ic by its URL, size, modification time and a
+ * checksum of the data at the current position. Only local files have a
+ * modification time, so other inputs are not cached.
+ *
+ * @return 1 if the input can be cached, 0 otherwise
+ */
+static int probe_cache_key(AVFormatContext *ic, int64_t *size, int64_t *mtime,
+                           uint32_t *crc)
+{
+    const int64_t pos = avio_tell(ic->pb);
+    URLContext *h = ffio_geturlcontext(ic->pb);
+    struct stat st;
+    uint8_t *buf;
+    int fd, len;
+
+    if (!ic->url || !*ic->url || (ic->ctx_flags & AVFMTCTX_NOHEADER) || !h)
+        return 0;
+    *size = avio_size(ic->pb);
+    if (*size < 0)
+        return 0;
+    fd = ffurl_get_file_handle(h);
+    if (fd < 0 || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode))
+        return 0;
+    *mtime = st.st_mtime;
+
+    if (ffio_ensure_seekback(ic->pb, PROBE_CACHE_HASH_SIZE) < 0)
+        return 0;
+    buf = av_malloc(PROBE_CACHE_HASH_SIZE);
+    if (!buf)
+        return 0;
+    len = avio_read(ic->pb, buf, PROBE_CACHE_HASH_SIZE);
+    *crc = av_crc(av_crc_get_table(AV_CRC_32_IEEE_LE), 0, buf, FFMAX(len, 0));
+    av_free(buf);
+
+    return avio_seek(ic->pb, pos, SEEK_SET) == pos;
+}
+
+static int probe_cache_match(const ProbeCacheEntry *e, AVFormatContext *ic,
+                             const char *settings, int64_t size, int64_t mtime,
+                             uint32_t crc)
+{
+    int i;
+
+    if (!e->url || strcmp(e->url, ic->url) || strcmp(e->settings, settings) ||
+        e->iformat != ic->iformat ||
+        e->size != size || e->mtime != mtime || e->crc != crc ||
+        e->nb_streams != ic->nb_streams)
+        return 0;
+    for (i = 0; i < ic->nb_streams; i++)
+        if (e->streams[i].codec_type != ic->streams[i]->codecpar->codec_type ||
+            e->streams[i].codec_id   != ic->streams[i]->codecpar->codec_id)
+            return 0;
+    return 1;
+}
+
+/**
+ * Apply the cached results for the input of ic, if there are any.
+ *
+ * @return 1 if they were applied, 0 if there are none, a negative AVERROR
+ *         code on failure
+ */
+static int probe_cache_load(AVFormatContext *ic, const char *settings,
+                            int64_t size, int64_t mtime, uint32_t crc)
+{
+    const ProbeCacheEntry *e = NULL;
+    int i, ret = 0;
+
+    ff_mutex_lock(&probe_cache_mutex);
+    for (i = 0; i < PROBE_CACHE_ENTRIES; i++) {
+        if (probe_cache_match(&probe_cache[i], ic, settings, size, mtime, crc)) {
+            e = &probe_cache[i];
+            break;
+        }
+    }
+    for (i = 0; e && i < ic->nb_streams; i++) {
+        const ProbeCacheStream *cs = &e->streams[i];
+        AVStream *st = ic->streams[i];
+
+        ret = avcodec_parameters_copy(st->codecpar, cs->par);
+        if (ret < 0)
+            break;
+        ret = avcodec_parameters_to_context(st->internal->avctx, st->codecpar);
+        if (ret < 0)
+            break;
+        st->internal->avctx->time_base       = cs->time_base;
+        st->internal->avctx->ticks_per_frame = cs->ticks_per_frame;
+        st->internal->avctx->coded_width     = cs->coded_width;
+        st->internal->avctx->coded_height    = cs->coded_height;
+        st->internal->avctx_inited = 1;
+        st->r_frame_rate        = cs->r_frame_rate;
+        st->avg_frame_rate      = cs->avg_frame_rate;
+        st->sample_aspect_ratio = cs->sample_aspect_ratio;
+        st->start_time          = cs->start_time;
+        st->duration            = cs->duration;
+        st->disposition         = cs->disposition;
+        st->codec_info_nb_frames = cs->codec_info_nb_frames;
+    }
+    if (e && ret >= 0) {
+        ic->start_time = e->start_time;
+        ic->duration   = e->duration;
+        ic->bit_rate   = e->bit_rate;
+        ic->duration_estimation_method = e->duration_estimation_method;
+        ret = 1;
+    }
+    ff_mutex_unlock(&probe_cache_mutex);
+
+    return ret;
+}
+
+static void probe_cache_store(AVFormatContext *ic, const char *settings,
+                              int64_t size, int64_t mtime, uint32_t crc,
+                              const ProbeCacheStream *orig)
+{
+    ProbeCacheEntry e = { 0 };
+    int i;
+
+    e.url      = av_strdup(ic->url);
+    e.settings = av_strdup(settings);
+    e.streams  = av_calloc(ic->nb_streams, sizeof(*e.streams));
+    if (!e.url || !e.settings || !e.streams)
+        goto fail;
+    for (i = 0; i < ic->nb_streams; i++) {
+        const AVStream *st = ic->streams[i];
+        ProbeCacheStream *cs = &e.streams[i];
+
+        cs->par = avcodec_parameters_alloc();
+        if (!cs->par) {
+            e.nb_streams = i;
+            goto fail;
+        }
+        e.nb_streams = i + 1;
+        if (avcodec_parameters_copy(cs->par, st->codecpar) < 0)
+            goto fail;
+        cs->codec_type          = orig[i].codec_type;
+        cs->codec_id            = orig[i].codec_id;
+        cs->r_frame_rate        = st->r_frame_rate;
+        cs->avg_frame_rate      = st->avg_frame_rate;
+        cs->sample_aspect_ratio = st->sample_aspect_ratio;
+        cs->start_time          = st->start_time;
+        cs->duration            = st->duration;
+        cs->disposition         = st->disposition;
+        cs->codec_info_nb_frames = st->codec_info_nb_frames;
+        cs->time_base           = st->internal->avctx->time_base;
+        cs->ticks_per_frame     = st->internal->avctx->ticks_per_frame;
+        cs->coded_width         = st->internal->avctx->coded_width;
+        cs->coded_height        = st->internal->avctx->coded_height;
+    }
+    e.iformat    = ic->iformat;
+    e.size       = size;
+    e.mtime      = mtime;
+    e.crc        = crc;
+    e.start_time = ic->start_time;
+    e.duration   = ic->duration;
+    e.bit_rate   = ic->bit_rate;
+    e.duration_estimation_method = ic->duration_estimation_method;
+
+    ff_mutex_lock(&probe_cache_mutex);
+    for (i = 0; i < PROBE_CACHE_ENTRIES; i++) {
+        const ProbeCacheEntry *old = &probe_cache[i];
+        if (old->url && !strcmp(old->url, e.url) && old->iformat == e.iformat &&
+            !strcmp(old->settings, e.settings))
+            break;
+    }
+    if (i == PROBE_CACHE_ENTRIES) {
+        i = probe_cache_next;
+        probe_cache_next = (probe_cache_next + 1) % PROBE_CACHE_ENTRIES;
+    }
+    probe_cache_entry_free(&probe_cache[i]);
+    probe_cache[i] = e;
+    ff_mutex_unlock(&probe_cache_mutex);
+    return;
+
+fail:
+    probe_cache_entry_free(&e);
+}
+
 int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 {
     int i, count = 0, ret = 0, j;
@@ -3592,9 +4016,20 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
     int64_t probesize = ic->probesize;
     int eof_reached = 0;
     int *missing_streams = av_opt_ptr(ic->iformat->priv_class, ic->priv_data, "missing_streams");
+    ProbeDecodeQueue decode_queue = { 0 };
+    ProbeCacheStream *orig_streams = NULL;
+    char *cache_settings = NULL;
+    int64_t cache_size = 0, cache_mtime = 0;
+    uint32_t cache_crc = 0;
 
     flush_codecs = probesize > 0;
 
+    if (ic->probe_cache) {
+        cache_settings = probe_cache_settings(ic, options, orig_nb_streams);
+        if (!cache_settings)
+            return AVERROR(ENOMEM);
+    }
+
     av_opt_set(ic, "skip_clear", "1", AV_OPT_SEARCH_CHILDREN);
 
     max_stream_analyze_duration = max_analyze_duration;
@@ -3694,6 +4129,31 @@ FF_ENABLE_DEPRECATION_WARNINGS
             av_dict_free(&thread_opt);
     }
 
+    if (cache_settings && ic->pb &&
+        probe_cache_key(ic, &cache_size, &cache_mtime, &cache_crc)) {
+        ret = probe_cache_load(ic, cache_settings, cache_size, cache_mtime, cache_crc);
+        if (ret < 0)
+            goto find_stream_info_err;
+        if (ret > 0) {
+            av_log(ic, AV_LOG_DEBUG, "Stream info found in the probe cache\n");
+            ret = 0;
+            goto probe_done;
+        }
+        orig_streams = av_calloc(ic->nb_streams, sizeof(*orig_streams));
+        if (!orig_streams) {
+            ret = AVERROR(ENOMEM);
+            goto find_stream_info_err;
+        }
+        for (i = 0; i < ic->nb_streams; i++) {
+            orig_streams[i].codec_type = ic->streams[i]->codecpar->codec_type;
+            orig_streams[i].codec_id   = ic->streams[i]->codecpar->codec_id;
+        }
+    }
+
+    ret = probe_decode_init(&decode_queue, ic);
+    if (ret < 0)
+        goto find_stream_info_err;
+
     for (i = 0; i < ic->nb_streams; i++) {
 #if FF_API_R_FRAME_RATE
         ic->streams[i]->internal->info->last_dts = AV_NOPTS_VALUE;
@@ -3798,6 +4258,10 @@ FF_ENABLE_DEPRECATION_WARNINGS
             break;
         }
 
+        /* packets split by the parser are returned without a new read */
+        if (ic->internal->probe_decode_queue)
+            probe_decode_sync(ic->internal->probe_decode_queue, pkt1.stream_index);
+
         if (!(ic->flags & AVFMT_FLAG_NOBUFFER)) {
             ret = avpriv_packet_list_put(&ic->internal->packet_buffer,
                                      &ic->internal->packet_buffer_end,
@@ -3920,16 +4384,20 @@ FF_ENABLE_DEPRECATION_WARNINGS
          * least one frame of codec data, this makes sure the codec initializes
          * the channel configuration and does not only trust the values from
          * the container. */
-        try_decode_frame(ic, st, pkt,
-                         (options && i < orig_nb_streams) ? &options[i] : NULL);
+        ret = probe_decode_packet(&decode_queue, ic, st, pkt,
+                                  (options && i < orig_nb_streams) ? &options[i] : NULL);
 
         if (ic->flags & AVFMT_FLAG_NOBUFFER)
             av_packet_unref(&pkt1);
+        if (ret < 0)
+            goto find_stream_info_err;
 
         st->codec_info_nb_frames++;
         count++;
     }
 
+    probe_decode_flush(&decode_queue);
+
     if (eof_reached) {
         int stream_index;
         for (stream_index = 0; stream_index < ic->nb_streams; stream_index++) {
@@ -4078,6 +4546,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
     if (probesize)
         estimate_timings(ic, old_offset);
 
+probe_done:
     av_opt_set(ic, "skip_clear", "0", AV_OPT_SEARCH_CHILDREN);
 
     if (ret >= 0 && ic->nb_streams)
@@ -4164,7 +4633,15 @@ FF_ENABLE_DEPRECATION_WARNINGS
         st->internal->avctx_inited = 0;
     }
 
+    /* streams added while probing would not be found when reopening */
+    if (orig_streams && ic->nb_streams == orig_nb_streams)
+        probe_cache_store(ic, cache_settings, cache_size, cache_mtime, cache_crc,
+                          orig_streams);
+
 find_stream_info_err:
+    probe_decode_uninit(&decode_queue);
+    av_freep(&orig_streams);
+    av_freep(&cache_settings);
     for (i = 0; i < ic->nb_streams; i++) {
         st = ic->streams[i];
         if (st->internal->info)
@@ -27,11 +27,120 @@
 #include "time_internal.h"
 #include "bprint.h"
 
+/* number of entries from which a hash index of the keys is maintained */
+#define INDEX_MIN_COUNT 16
+
+typedef struct DictIndexSlot {
+    unsigned hash;
+    int idx;            ///< index in elems, -1 for an empty slot
+} DictIndexSlot;
+
 struct AVDictionary {
     int count;
     AVDictionaryEntry *elems;
+
+    /* open addressing table of the entries, hashed on the case folded key,
+     * so that lookups of a full key do not compare it with every entry */
+    DictIndexSlot *index;
+    unsigned index_size; ///< power of 2, 0 if there is no index
 };
 
+static unsigned hash_key(const char *key)
+{
+    unsigned hash = 2166136261U;
+
+    while (*key)
+        hash = (hash ^ (uint8_t)av_toupper(*key++)) * 16777619U;
+    return hash;
+}
+
+static int match_key(const char *s, const char *key, int flags)
+{
+    unsigned int j;
+
+    if (flags & AV_DICT_MATCH_CASE)
+        for (j = 0; s[j] == key[j] && key[j]; j++)
+            ;
+    else
+        for (j = 0; av_toupper(s[j]) == av_toupper(key[j]) && key[j]; j++)
+            ;
+    if (key[j])
+        return 0;
+    if (s[j] && !(flags & AV_DICT_IGNORE_SUFFIX))
+        return 0;
+    return 1;
+}
+
+static void index_insert(AVDictionary *m, int idx)
+{
+    const unsigned mask = m->index_size - 1;
+    unsigned hash = hash_key(m->elems[idx].key), pos;
+
+    for (pos = hash & mask; m->index[pos].idx >= 0; pos = (pos + 1) & mask)
+        ;
+    m->index[pos].hash = hash;
+    m->index[pos].idx  = idx;
+}
+
+static unsigned index_find(const AVDictionary *m, int idx)
+{
+    const unsigned mask = m->index_size - 1;
+    unsigned pos;
+
+    for (pos = hash_key(m->elems[idx].key) & mask; m->index[pos].idx != idx; pos = (pos + 1) & mask)
+        ;
+    return pos;
+}
+
+static void index_remove(AVDictionary *m, int idx)
+{
+    const unsigned mask = m->index_size - 1;
+    unsigned i = index_find(m, idx), j = i;
+
+    /* shift back the following entries which cannot be found anymore
+     * once the slot is emptied */
+    while (1) {
+        unsigned home;
+
+        j = (j + 1) & mask;
+        if (m->index[j].idx < 0)
+            break;
+        home = m->index[j].hash & mask;
+        if (((i <= j) ? (i < home && home <= j) : (i < home || home <= j)))
+            continue;
+        m->index[i] = m->index[j];
+        i = j;
+    }
+    m->index[i].idx = -1;
+}
+
+/* Make sure the entry at index count - 1 is indexed, if there is an index.
+ * An existing index is kept up to date even after deletions brought the
+ * count below INDEX_MIN_COUNT. Failing to allocate the index is not an error, lookups just get slower. */
+static void index_add(AVDictionary *m)
+{
+    unsigned size, i;
+
+    if (m->index && 2 * m->count <= m->index_size) {
+        index_insert(m, m->count - 1);
+        return;
+    }
+    if (m->count < INDEX_MIN_COUNT)
+        return;
+
+    size = FFMAX(2 * m->index_size, 4 * INDEX_MIN_COUNT);
+    av_freep(&m->index);
+    m->index_size = 0;
+    m->index = av_malloc_array(size, sizeof(*m->index));
+    if (!m->index)
+        return;
+    m->index_size = size;
+    for (i = 0; i < size; i++)
+        m->index[i].idx = -1;
+    for (i = 0; i < m->count; i++)
+        index_insert(m, i);
+}
+
 int av_dict_count(const AVDictionary *m)
 {
     return m ? m->count : 0;
@@ -40,7 +149,7 @@ int av_dict_count(const AVDictionary *m)
 AVDictionaryEntry *av_dict_get(const AVDictionary *m, const char *key,
                                const AVDictionaryEntry *prev, int flags)
 {
-    unsigned int i, j;
+    unsigned int i;
 
     if (!m)
         return NULL;
@@ -50,19 +159,27 @@ AVDictionaryEntry *av_dict_get(const AVDictionary *m, const char *key,
     else
         i = 0;
 
+    if (m->index && key && !(flags & AV_DICT_IGNORE_SUFFIX)) {
+        const unsigned mask = m->index_size - 1;
+        const unsigned hash = hash_key(key);
+        int best = -1;
+        unsigned pos;
+
+        /* the entries sharing a key may be anywhere in the probe sequence,
+         * return the first one after prev in the elems order */
+        for (pos = hash & mask; m->index[pos].idx >= 0; pos = (pos + 1) & mask) {
+            const int idx = m->index[pos].idx;
+            if (m->index[pos].hash != hash || idx < i || (best >= 0 && idx > best))
+                continue;
+            if (match_key(m->elems[idx].key, key, flags))
+                best = idx;
+        }
+        return best >= 0 ? &m->elems[best] : NULL;
+    }
+
     for (; i < m->count; i++) {
-        const char *s = m->elems[i].key;
-        if (flags & AV_DICT_MATCH_CASE)
-            for (j = 0; s[j] == key[j] && key[j]; j++)
-                ;
-        else
-            for (j = 0; av_toupper(s[j]) == av_toupper(key[j]) && key[j]; j++)
-                ;
-        if (key[j])
-            continue;
-        if (s[j] && !(flags & AV_DICT_IGNORE_SUFFIX))
-            continue;
-        return &m->elems[i];
+        if (match_key(m->elems[i].key, key, flags))
+            return &m->elems[i];
     }
     return NULL;
 }
@@ -96,6 +213,12 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
             av_free(copy_value);
             return 0;
         }
+        if (m->index) {
+            const int idx = tag - m->elems;
+            index_remove(m, idx);
+            if (idx != m->count - 1)
+                m->index[index_find(m, m->count - 1)].idx = idx;
+        }
         if (flags & AV_DICT_APPEND)
             oldval = tag->value;
         else
@@ -124,11 +247,13 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
             av_freep(&copy_value);
         }
         m->count++;
+        index_add(m);
     } else {
         av_freep(&copy_key);
     }
     if (!m->count) {
         av_freep(&m->elems);
+        av_freep(&m->index);
         av_freep(pm);
     }
 
@@ -137,6 +262,7 @@ int av_dict_set(AVDictionary **pm, const char *key, const char *value,
 err_out:
     if (m && !m->count) {
         av_freep(&m->elems);
+        av_freep(&m->index);
         av_freep(pm);
     }
     av_free(copy_key);
@@ -210,6 +336,7 @@ void av_dict_free(AVDictionary **pm)
             av_freep(&m->elems[m->count].value);
         }
         av_freep(&m->elems);
+        av_freep(&m->index);
     }
     av_freep(pm);
 }
@@ -174,8 +174,32 @@ struct AVExpr {
     } a;
     struct AVExpr *param[3];
     double *var;
+    struct ExprProgram *prog;
 };
 
+/* Expressions without side effects are additionally compiled to a flat
+ * program: one instruction per distinct subexpression, in evaluation order,
+ * each writing its own register, which av_expr_eval_array() runs with the
+ * register storage given by its caller. Registers are blocks of EXPR_BLOCK values so
+ * that a row of results is computed with one tight loop per instruction. */
+#define EXPR_BLOCK     64
+#define EXPR_MAX_INSNS 1024
+
+typedef struct ExprInsn {
+    int type;           ///< node type of the compiled AVExpr
+    int src[3];         ///< source registers, the zero register if unused
+    int const_index;
+    double value;
+    double (*func0)(double);
+} ExprInsn;
+
+typedef struct ExprProgram {
+    ExprInsn *insns;
+    int nb_insns;       ///< 0 if the expression could not be compiled
+    int result;         ///< register holding the value of the expression
+    int nb_consts;
+} ExprProgram;
+
 static double etime(double v)
 {
     return av_gettime() * 0.000001;
@@ -340,6 +364,10 @@ void av_expr_free(AVExpr *e)
     av_expr_free(e->param[1]);
     av_expr_free(e->param[2]);
     av_freep(&e->var);
+    if (e->prog) {
+        av_freep(&e->prog->insns);
+        av_freep(&e->prog);
+    }
     av_freep(&e);
 }
 
@@ -682,6 +710,223 @@ static int verify_expr(AVExpr *e)
     }
 }
 
+/* true if evaluating e has no side effects and depends only on the constants */
+static int is_pure(const AVExpr *e)
+{
+    if (!e) return 1;
+    switch (e->type) {
+        case e_func1:
+        case e_func2:
+        case e_ld:
+        case e_st:
+        case e_random:
+        case e_while:
+        case e_taylor:
+        case e_root:
+        case e_print:
+            return 0;
+        case e_func0:
+            if (e->a.func0 == etime)
+                return 0;
+            break;
+    }
+    return is_pure(e->param[0]) && is_pure(e->param[1]) && is_pure(e->param[2]);
+}
+
+static void fold_constants(AVExpr *e)
+{
+    Parser p = { 0 };
+    int i;
+
+    if (!e || e->type == e_value || e->type == e_const)
+        return;
+    for (i = 0; i < 3; i++)
+        fold_constants(e->param[i]);
+    for (i = 0; i < 3; i++)
+        if (e->param[i] && e->param[i]->type != e_value)
+            return;
+    if (!is_pure(e))
+        return;
+
+    e->value = eval_expr(&p, e);
+    e->type  = e_value;
+    for (i = 0; i < 3; i++) {
+        av_expr_free(e->param[i]);
+        e->param[i] = NULL;
+    }
+}
+
+static int count_consts(const AVExpr *e)
+{
+    int i, nb = 0;
+
+    if (!e) return 0;
+    if (e->type == e_const)
+        nb = e->const_index + 1;
+    for (i = 0; i < 3; i++)
+        nb = FFMAX(nb, count_consts(e->param[i]));
+    return nb;
+}
+
+static int same_insn(const ExprInsn *a, const ExprInsn *b)
+{
+    return a->type        == b->type        &&
+           a->src[0]      == b->src[0]      &&
+           a->src[1]      == b->src[1]      &&
+           a->src[2]      == b->src[2]      &&
+           a->const_index == b->const_index &&
+           a->func0       == b->func0       &&
+           !memcmp(&a->value, &b->value, sizeof(a->value));
+}
+
+/**
+ * Append the instructions computing e to the program, reusing the register
+ * of an identical subexpression if there is one.
+ *
+ * @return the register holding the value of e, or a negative AVERROR code
+ */
+static int compile_expr(ExprProgram *prog, const AVExpr *e)
+{
+    ExprInsn insn = { .type = e->type, .value = e->value };
+    ExprInsn *insns;
+    int i, ret;
+
+    for (i = 0; i < 3; i++) {
+        insn.src[i] = EXPR_MAX_INSNS;
+        if (e->param[i]) {
+            if ((ret = compile_expr(prog, e->param[i])) < 0)
+                return ret;
+            insn.src[i] = ret;
+        }
+    }
+    /* the left operand of ';' only matters for its side effects */
+    if (e->type == e_last && e->value == 1)
+        return insn.src[1];
+    if (e->type == e_const)
+        insn.const_index = e->const_index;
+    if (e->type == e_func0)
+        insn.func0 = e->a.func0;
+
+    for (i = 0; i < prog->nb_insns; i++)
+        if (same_insn(&prog->insns[i], &insn))
+            return i;
+
+    if (prog->nb_insns >= EXPR_MAX_INSNS)
+        return AVERROR(ENOSPC);
+    insns = av_realloc_array(prog->insns, prog->nb_insns + 1, sizeof(*insns));
+    if (!insns)
+        return AVERROR(ENOMEM);
+    prog->insns = insns;
+    prog->insns[prog->nb_insns] = insn;
+    return prog->nb_insns++;
+}
+
+static int compile_program(AVExpr *e)
+{
+    ExprProgram *prog = av_mallocz(sizeof(*prog));
+    int i, j, ret;
+
+    if (!prog)
+        return AVERROR(ENOMEM);
+    e->prog = prog;
+
+    prog->nb_consts = count_consts(e);
+    if (!is_pure(e))
+        return 0;
+    ret = compile_expr(prog, e);
+    if (ret == AVERROR(ENOSPC)) {
+        av_freep(&prog->insns);
+        prog->nb_insns = 0;
+        return 0;
+    }
+    if (ret < 0)
+        return ret;
+    prog->result = ret;
+
+    /* the unused operands point to the zero register after the last one */
+    for (i = 0; i < prog->nb_insns; i++)
+        for (j = 0; j < 3; j++)
+            if (prog->insns[i].src[j] == EXPR_MAX_INSNS)
+                prog->insns[i].src[j] = prog->nb_insns;
+    return 0;
+}
+
+/**
+ * Run the program for nb <= EXPR_BLOCK sets of constants, which only differ
+ * in the constant at index var, set to start + (first + i) * step for the
+ * i-th set. regs holds (nb_insns + 1) * EXPR_BLOCK values, the last block
+ * being zero; it is owned by the caller so that one AVExpr can be evaluated
+ * from several threads at once.
+ */
+static void run_program(const ExprProgram *prog, double *regs, const double *const_values,
+                        int var, double start, double step, int first, int nb)
+{
+    int i, j;
+
+    for (i = 0; i < prog->nb_insns; i++) {
+        const ExprInsn *insn = &prog->insns[i];
+        const double *a = regs + insn->src[0] * EXPR_BLOCK;
+        const double *b = regs + insn->src[1] * EXPR_BLOCK;
+        const double *c = regs + insn->src[2] * EXPR_BLOCK;
+        const double v = insn->value;
+        double *dst = regs + i * EXPR_BLOCK;
+
+#define OP(expr)                                                    \
+        for (j = 0; j < nb; j++) {                                  \
+            av_unused const double d = a[j], d2 = b[j], d3 = c[j];  \
+            dst[j] = expr;                                          \
+        }                                                           \
+        break
+
+        switch (insn->type) {
+            case e_value:  OP(v);
+            case e_const:
+                if (insn->const_index == var) {
+                    OP(v * (start + (first + j) * step));
+                } else {
+                    OP(v * const_values[insn->const_index]);
+                }
+            case e_func0:  OP(v * insn->func0(d));
+            case e_squish: OP(1/(1+exp(4*d)));
+            case e_gauss:  OP(exp(-d*d/2)/sqrt(2*M_PI));
+            case e_isnan:  OP(v * !!isnan(d));
+            case e_isinf:  OP(v * !!isinf(d));
+            case e_floor:  OP(v * floor(d));
+            case e_ceil :  OP(v * ceil (d));
+            case e_trunc:  OP(v * trunc(d));
+            case e_round:  OP(v * round(d));
+            case e_sgn:    OP(v * FFDIFFSIGN(d, 0));
+            case e_sqrt:   OP(v * sqrt (d));
+            case e_not:    OP(v * (d == 0));
+            case e_if:     OP(v * ( d ? d2 : d3));
+            case e_ifnot:  OP(v * (!d ? d2 : d3));
+            case e_clip:   OP(isnan(d2) || isnan(d3) || isnan(d) || d2 > d3 ? NAN : v * av_clipd(d, d2, d3));
+            case e_between:OP(v * (d >= d2 && d <= d3));
+            case e_lerp:   OP(d + (d2 - d) * d3);
+            case e_mod:    OP(v * (d - floor(d2 ? d / d2 : d * INFINITY) * d2));
+            case e_gcd:    OP(v * av_gcd(d,d2));
+            case e_max:    OP(v * (d >  d2 ?   d : d2));
+            case e_min:    OP(v * (d <  d2 ?   d : d2));
+            case e_eq:     OP(v * (d == d2 ? 1.0 : 0.0));
+            case e_gt:     OP(v * (d >  d2 ? 1.0 : 0.0));
+            case e_gte:    OP(v * (d >= d2 ? 1.0 : 0.0));
+            case e_lt:     OP(v * (d <  d2 ? 1.0 : 0.0));
+            case e_lte:    OP(v * (d <= d2 ? 1.0 : 0.0));
+            case e_pow:    OP(v * pow(d, d2));
+            case e_mul:    OP(v * (d * d2));
+            case e_div:    OP(v * (d2 ? (d / d2) : d * INFINITY));
+            case e_add:    OP(v * (d + d2));
+            case e_last:   OP(v * d2);
+            case e_hypot:  OP(v * hypot(d, d2));
+            case e_atan2:  OP(v * atan2(d, d2));
+            case e_bitand: OP(isnan(d) || isnan(d2) ? NAN : v * ((long int)d & (long int)d2));
+            case e_bitor:  OP(isnan(d) || isnan(d2) ? NAN : v * ((long int)d | (long int)d2));
+            default:       OP(NAN);
+        }
+#undef OP
+    }
+}
+
 int av_expr_parse(AVExpr **expr, const char *s,
                   const char * const *const_names,
                   const char * const *func1_names, double (* const *funcs1)(void *, double),
@@ -724,6 +969,9 @@ int av_expr_parse(AVExpr **expr, const char *s,
         ret = AVERROR(EINVAL);
         goto end;
     }
+    fold_constants(e);
+    if ((ret = compile_program(e)) < 0)
+        goto end;
     e->var= av_mallocz(sizeof(double) *VARS);
     if (!e->var) {
         ret = AVERROR(ENOMEM);
@@ -766,6 +1014,7 @@ int av_expr_count_func(AVExpr *e, unsigned *counter, int size, int arg)
 double av_expr_eval(AVExpr *e, const double *const_values, void *opaque)
 {
     Parser p = { 0 };
+
     p.var= e->var;
 
     p.const_values = const_values;
@@ -773,6 +1022,56 @@ double av_expr_eval(AVExpr *e, const double *const_values, void *opaque)
     return eval_expr(&p, e);
 }
 
+int av_expr_eval_array_scratch_size(const AVExpr *e)
+{
+    const ExprProgram *prog = e->prog;
+
+    if (!prog)
+        return 0;
+    if (prog->nb_insns)
+        return (prog->nb_insns + 1) * EXPR_BLOCK;
+    return prog->nb_consts;
+}
+
+void av_expr_eval_array(AVExpr *e, double *dst, int nb,
+                        const double *const_values, int var, double step,
+                        void *opaque, double *scratch)
+{
+    const ExprProgram *prog = e->prog;
+    const double start = var >= 0 && prog && var < prog->nb_consts ?
+                         const_values[var] : 0;
+    const int size = av_expr_eval_array_scratch_size(e);
+    double *buf = scratch;
+    int i;
+
+    if (!buf && size)
+        buf = av_malloc_array(size, sizeof(*buf));
+
+    if (buf && prog->nb_insns) {
+        memset(buf + prog->nb_insns * EXPR_BLOCK, 0, EXPR_BLOCK * sizeof(*buf));
+        for (i = 0; i < nb; i += EXPR_BLOCK) {
+            const int len = FFMIN(nb - i, EXPR_BLOCK);
+            run_program(prog, buf, const_values, var, start, step, i, len);
+            memcpy(dst + i, buf + prog->result * EXPR_BLOCK, len * sizeof(*dst));
+        }
+    } else if (var < 0 || !prog || var >= prog->nb_consts) {
+        for (i = 0; i < nb; i++)
+            dst[i] = av_expr_eval(e, const_values, opaque);
+    } else if (buf) {
+        memcpy(buf, const_values, prog->nb_consts * sizeof(*buf));
+        for (i = 0; i < nb; i++) {
+            buf[var] = start + i * step;
+            dst[i] = av_expr_eval(e, buf, opaque);
+        }
+    } else {
+        for (i = 0; i < nb; i++)
+            dst[i] = NAN;
+    }
+
+    if (buf != scratch)
+        av_free(buf);
+}
+
 int av_expr_parse_and_eval(double *d, const char *s,
                            const char * const *const_names, const double *const_values,
                            const char * const *func1_names, double (* const *funcs1)(void *, double),
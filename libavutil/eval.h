@@ -86,6 +86,39 @@ int av_expr_parse(AVExpr **expr, const char *s,
  */
 double av_expr_eval(AVExpr *e, const double *const_values, void *opaque);
 
+/**
+ * Evaluate a previously parsed expression for a range of values of one of
+ * its constants, e.g. for a row of pixels.
+ *
+ * The i-th result is the value of the expression with the constant at index
+ * var set to const_values[var] + i * step, and all the other constants taken
+ * from const_values. This is equivalent to calling av_expr_eval() for each
+ * value in turn, but expressions without side effects are evaluated for
+ * many values at once.
+ *
+ * @param dst array where the nb results are stored
+ * @param nb number of values to evaluate
+ * @param const_values a zero terminated array of values for the identifiers from av_expr_parse() const_names
+ * @param var index in const_values of the constant which is varied
+ * @param step increment of the varied constant between two results
+ * @param opaque a pointer which will be passed to all functions from funcs1 and funcs2
+ * @param scratch NULL or an array of av_expr_eval_array_scratch_size() values
+ *                used as working memory, so that no memory is allocated by
+ *                the call; a caller evaluating the same expression from
+ *                several threads must give each thread its own array
+ */
+void av_expr_eval_array(AVExpr *e, double *dst, int nb,
+                        const double *const_values, int var, double step,
+                        void *opaque, double *scratch);
+
+/**
+ * Get the size of the working memory of av_expr_eval_array().
+ *
+ * @return the number of values of the scratch array of av_expr_eval_array()
+ *         for this expression, may be 0
+ */
+int av_expr_eval_array_scratch_size(const AVExpr *e);
+
 /**
  * Track the presence of variables and their number of occurrences in a parsed expression
  *
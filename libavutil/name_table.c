@@ -0,0 +1,55 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "avstring.h"
+#include "name_table.h"
+
+/* FNV-1a */
+static unsigned hash_name(const char *name, int icase, unsigned size)
+{
+    unsigned hash = 2166136261U;
+
+    while (*name) {
+        const uint8_t c = icase ? av_tolower(*name) : *name;
+        hash = (hash ^ c) * 16777619U;
+        name++;
+    }
+    return hash % size;
+}
+
+void avpriv_name_table_add(uint16_t *table, unsigned size, const char *name,
+                           int icase, int idx, AVPrivNameMatch match)
+{
+    unsigned pos;
+
+    for (pos = hash_name(name, icase, size); table[pos]; pos = (pos + 1) % size)
+        if (match(name, table[pos] - 1))
+            return;
+    table[pos] = idx + 1;
+}
+
+int avpriv_name_table_find(const uint16_t *table, unsigned size,
+                           const char *name, int icase, AVPrivNameMatch match)
+{
+    unsigned pos;
+
+    for (pos = hash_name(name, icase, size); table[pos]; pos = (pos + 1) % size)
+        if (match(name, table[pos] - 1))
+            return table[pos] - 1;
+    return -1;
+}
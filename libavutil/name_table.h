@@ -0,0 +1,58 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_NAME_TABLE_H
+#define AVUTIL_NAME_TABLE_H
+
+#include <stdint.h>
+
+/**
+ * @file
+ * Lookup by name in the static registries of the libraries, such as the
+ * lists of codecs, demuxers, filters and protocols.
+ *
+ * A name table is an open addressing table of size slots, each holding the
+ * index of an entry in the registry plus one, or 0 for an empty slot. It
+ * should have about twice as many slots as there are names to add.
+ */
+
+/**
+ * Callback checking whether the registry entry at index idx matches name.
+ */
+typedef int (*AVPrivNameMatch)(const char *name, int idx);
+
+/**
+ * Add the registry entry at index idx to a name table, unless an entry
+ * matching name was added before, so that the first entry of several with
+ * the same name is found.
+ *
+ * @param icase hash name case insensitively, match must then be case
+ *              insensitive as well
+ */
+void avpriv_name_table_add(uint16_t *table, unsigned size, const char *name,
+                           int icase, int idx, AVPrivNameMatch match);
+
+/**
+ * Find the first entry added to a name table which matches name.
+ *
+ * @return the index of the entry in the registry, -1 if there is none
+ */
+int avpriv_name_table_find(const uint16_t *table, unsigned size,
+                           const char *name, int icase, AVPrivNameMatch match);
+
+#endif /* AVUTIL_NAME_TABLE_H */
@@ -19,6 +19,7 @@
  */
 
 #include "libavutil/dict.c"
+#include "libavutil/timer.h"
 
 static void print_dict(const AVDictionary *m)
 {
@@ -49,12 +50,126 @@ static void test_separators(const AVDictionary *m, const char pair, const char v
     av_dict_free(&dict);
 }
 
-int main(void)
+/* check the indexed lookups against a plain scan of the entries */
+static void check_lookup(const AVDictionary *m, const char *key, int flags)
+{
+    AVDictionaryEntry *e = NULL, *ref = NULL;
+    int i;
+
+    do {
+        e = av_dict_get(m, key, e, flags);
+        for (i = ref ? ref - m->elems + 1 : 0; i < m->count; i++)
+            if (match_key(m->elems[i].key, key, flags))
+                break;
+        ref = i < m->count ? &m->elems[i] : NULL;
+        if (e != ref)
+            printf("Mismatch looking up '%s'\n", key);
+    } while (e && e == ref);
+}
+
+static void test_index(void)
+{
+    AVDictionary *dict = NULL;
+    AVDictionaryEntry *e = NULL;
+    char key[32];
+    int i;
+
+    printf("\nTesting av_dict_get() with many entries\n");
+    for (i = 0; i < 200; i++) {
+        snprintf(key, sizeof(key), "key%d", i);
+        av_dict_set_int(&dict, key, i, 0);
+    }
+    for (i = 0; i < 200; i += 3) {
+        snprintf(key, sizeof(key), "KEY%d", i);
+        av_dict_set_int(&dict, key, -i, 0);
+    }
+    for (i = 0; i < 200; i += 5) {
+        snprintf(key, sizeof(key), "key%d", i);
+        av_dict_set(&dict, key, NULL, 0);
+    }
+    for (i = 0; i < 4; i++)
+        av_dict_set_int(&dict, "multi", i, AV_DICT_MULTIKEY);
+    av_dict_set(&dict, "multi", "last", AV_DICT_MULTIKEY | AV_DICT_APPEND);
+
+    for (i = 0; i < 210; i++) {
+        snprintf(key, sizeof(key), "kEy%d", i);
+        check_lookup(dict, key, 0);
+        check_lookup(dict, key, AV_DICT_MATCH_CASE);
+        snprintf(key, sizeof(key), "key%d", i);
+        check_lookup(dict, key, AV_DICT_MATCH_CASE);
+    }
+    check_lookup(dict, "multi", 0);
+    check_lookup(dict, "key1", AV_DICT_IGNORE_SUFFIX);
+
+    printf("%d entries\n", av_dict_count(dict));
+    printf("key9 %s, KEY9 %s, key10 %s\n",
+           av_dict_get(dict, "key9", NULL, 0)->value,
+           av_dict_get(dict, "KEY9", NULL, AV_DICT_MATCH_CASE)->value,
+           av_dict_get(dict, "key10", NULL, 0) ? "present" : "absent");
+    while ((e = av_dict_get(dict, "multi", e, 0)))
+        printf("%s %s\n", e->key, e->value);
+
+    /* delete below the index threshold, then add and overwrite entries */
+    while ((e = av_dict_get(dict, "", NULL, AV_DICT_IGNORE_SUFFIX)) &&
+           av_dict_count(dict) > 4)
+        av_dict_set(&dict, e->key, NULL, 0);
+    for (i = 0; i < 8; i++) {
+        snprintf(key, sizeof(key), "new%d", i);
+        av_dict_set_int(&dict, key, i, 0);
+    }
+    av_dict_set(&dict, "new3", "overwritten", 0);
+    for (i = 0; i < 8; i++) {
+        snprintf(key, sizeof(key), "new%d", i);
+        check_lookup(dict, key, 0);
+    }
+    check_lookup(dict, "multi", 0);
+    printf("%d entries after deleting, new3 %s, new7 %s\n", av_dict_count(dict),
+           av_dict_get(dict, "new3", NULL, 0) ? av_dict_get(dict, "new3", NULL, 0)->value : "absent",
+           av_dict_get(dict, "new7", NULL, 0) ? av_dict_get(dict, "new7", NULL, 0)->value : "absent");
+    av_dict_free(&dict);
+}
+
+static void bench_get(int nb_entries)
+{
+    AVDictionary *dict = NULL;
+    char key[32];
+    int i;
+
+    for (i = 0; i < nb_entries; i++) {
+        snprintf(key, sizeof(key), "lavfi.key%d", i);
+        av_dict_set_int(&dict, key, i, 0);
+    }
+    for (i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "lavfi.key%d", i * 7 % nb_entries);
+        {
+            START_TIMER;
+            av_dict_get(dict, key, NULL, 0);
+            STOP_TIMER("av_dict_get");
+        }
+    }
+    for (i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), "lavfi.key%d", i * 7 % nb_entries);
+        {
+            START_TIMER;
+            av_dict_set(&dict, key, "value", 0);
+            STOP_TIMER("av_dict_set");
+        }
+    }
+    av_dict_free(&dict);
+}
+
+int main(int argc, char **argv)
 {
     AVDictionary *dict = NULL;
     AVDictionaryEntry *e;
     char *buffer = NULL;
 
+    if (argc > 1 && !strcmp(argv[1], "-t")) {
+        int nb_entries = argc > 2 ? atoi(argv[2]) : 64;
+        bench_get(FFMAX(nb_entries, 1));
+        return 0;
+    }
+
     printf("Testing av_dict_get_string() and av_dict_parse_string()\n");
     av_dict_get_string(dict, &buffer, '=', ',');
     printf("%s\n", buffer);
@@ -132,5 +247,7 @@ int main(void)
     printf("%s\n", e->value);
     av_dict_free(&dict);
 
+    test_index();
+
     return 0;
 }
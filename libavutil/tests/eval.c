@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "libavutil/common.h"
 #include "libavutil/libm.h"
 #include "libavutil/eval.h"
 
@@ -42,6 +43,13 @@ int main(int argc, char **argv)
     int i;
     double d;
     const char *const *expr;
+    static const char *const array_exprs[] = {
+        "X*Y+1",
+        "if(gt(X,2),sqrt(X),-X)",
+        "hypot(X,X);X*X+X*X",
+        "st(0,ld(0)+X)",
+        NULL
+    };
     static const char *const exprs[] = {
         "",
         "1;2",
@@ -168,6 +176,35 @@ int main(int argc, char **argv)
     if (ret < 0)
         printf("av_expr_parse_and_eval failed\n");
 
+    for (expr = array_exprs; *expr; expr++) {
+        static const char *const array_names[] = { "X", "Y", 0 };
+        const double array_values[] = { 1, 0.5 };
+        double res[5], res2[5], *scratch;
+        AVExpr *e;
+
+        printf("Evaluating '%s' for X = 1..5\n", *expr);
+        if (av_expr_parse(&e, *expr, array_names, NULL, NULL, NULL, NULL, 0, NULL) < 0) {
+            printf("av_expr_parse failed\n");
+            continue;
+        }
+        av_expr_eval_array(e, res, FF_ARRAY_ELEMS(res), array_values, 0, 1, NULL, NULL);
+        for (i = 0; i < FF_ARRAY_ELEMS(res); i++)
+            printf("%f%s", res[i], i < FF_ARRAY_ELEMS(res) - 1 ? " " : "\n\n");
+        av_expr_free(e);
+
+        /* again from a fresh expression, with the working memory given */
+        if (av_expr_parse(&e, *expr, array_names, NULL, NULL, NULL, NULL, 0, NULL) < 0)
+            continue;
+        scratch = av_malloc_array(av_expr_eval_array_scratch_size(e) + 1, sizeof(*scratch));
+        if (scratch) {
+            av_expr_eval_array(e, res2, FF_ARRAY_ELEMS(res2), array_values, 0, 1, NULL, scratch);
+            if (memcmp(res, res2, sizeof(res)))
+                printf("av_expr_eval_array with a scratch array differs\n");
+            av_free(scratch);
+        }
+        av_expr_free(e);
+    }
+
     if (argc > 1 && !strcmp(argv[1], "-t")) {
         for (i = 0; i < 1050; i++) {
             START_TIMER;
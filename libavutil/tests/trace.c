@@ -0,0 +1,104 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libavutil/internal.h"
+#include "libavutil/mem.h"
+#include "libavutil/trace.h"
+
+/* print the trace with the timestamps masked */
+static void print_trace(const char *filename)
+{
+    char line[256];
+    FILE *f;
+
+    if (av_trace_write_json(filename) < 0) {
+        printf("error writing the trace\n");
+        return;
+    }
+    f = fopen(filename, "r");
+    if (!f)
+        return;
+    while (fgets(line, sizeof(line), f)) {
+        char *ts = strstr(line, "\"ts\":");
+
+        if (ts) {
+            char *end = ts + 5;
+            while (*end >= '0' && *end <= '9')
+                end++;
+            memmove(ts + 6, end, strlen(end) + 1);
+            ts[5] = 'T';
+        }
+        printf("%s", line);
+    }
+    fclose(f);
+}
+
+int main(void)
+{
+    char *filename;
+    int fd, i;
+
+    fd = avpriv_tempfile("trace", &filename, 0, NULL);
+    if (fd < 0)
+        return 1;
+    close(fd);
+
+    printf("Testing disabled tracing\n");
+    av_trace_begin("test", "ignored");
+    av_trace_end();
+    print_trace(filename);
+
+    printf("\nTesting nested steps\n");
+    av_trace_start(0);
+    av_trace_begin("demux", "outer");
+    av_trace_begin("decode", "inner \"quoted\"\\");
+    av_trace_end();
+    av_trace_end();
+    av_trace_stop();
+    av_trace_begin("test", "after stop");
+    av_trace_end();
+    print_trace(filename);
+
+    printf("\nTesting a full ring\n");
+    av_trace_start(3);
+    for (i = 0; i < 5; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "step %d", i);
+        av_trace_begin("test", name);
+        av_trace_end();
+    }
+    av_trace_stop();
+    print_trace(filename);
+
+    printf("\nTesting a long name\n");
+    av_trace_start(0);
+    av_trace_begin("test", "a name that is too long to be stored completely");
+    av_trace_end();
+    av_trace_stop();
+    print_trace(filename);
+
+    av_trace_free();
+    unlink(filename);
+    av_free(filename);
+
+    return 0;
+}
@@ -0,0 +1,311 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+#include "config.h"
+#include "avstring.h"
+#include "avutil.h"
+#include "common.h"
+#include "error.h"
+#include "mem.h"
+#include "thread.h"
+#include "time.h"
+#include "trace.h"
+
+#define DEFAULT_EVENTS (1 << 16)
+#define MAX_EVENTS     (1 << 24)
+#define NAME_SIZE      32
+
+typedef struct TraceEvent {
+    int64_t ts;
+    const char *category;       ///< NULL for the end of a step
+    char name[NAME_SIZE];
+} TraceEvent;
+
+/**
+ * Events of one thread. Only the owning thread writes to it, the list of
+ * rings is only modified under trace_mutex.
+ */
+typedef struct TraceRing {
+    struct TraceRing *next;
+    TraceEvent *events;
+    unsigned nb_events;         ///< a power of two
+    uint64_t pos;               ///< number of events recorded so far
+    int tid;
+    char thread_name[NAME_SIZE];
+} TraceRing;
+
+static atomic_int trace_enabled;
+static AVMutex trace_mutex = AV_MUTEX_INITIALIZER;
+static TraceRing *trace_rings;
+static int trace_nb_threads;
+static unsigned trace_nb_events = DEFAULT_EVENTS;
+static unsigned trace_generation;
+static int64_t trace_start_time;
+
+static TraceRing *trace_ring_alloc(void)
+{
+    TraceRing *ring = av_mallocz(sizeof(*ring));
+
+    if (!ring)
+        return NULL;
+    ring->events = av_malloc_array(trace_nb_events, sizeof(*ring->events));
+    if (!ring->events) {
+        av_free(ring);
+        return NULL;
+    }
+    ring->nb_events = trace_nb_events;
+
+    ff_mutex_lock(&trace_mutex);
+    ring->tid   = trace_nb_threads++;
+    ring->next  = trace_rings;
+    trace_rings = ring;
+    ff_mutex_unlock(&trace_mutex);
+
+    return ring;
+}
+
+static void trace_rings_free(void)
+{
+    while (trace_rings) {
+        TraceRing *next = trace_rings->next;
+        av_freep(&trace_rings->events);
+        av_freep(&trace_rings);
+        trace_rings = next;
+    }
+    trace_nb_threads = 0;
+}
+
+#if HAVE_PTHREADS
+/* The thread-local state outlives the rings, so it is tagged with the trace
+ * generation instead of pointing to a ring that may have been freed. */
+typedef struct TraceThread {
+    TraceRing *ring;
+    unsigned generation;
+} TraceThread;
+
+static pthread_key_t trace_key;
+static AVOnce trace_key_once = AV_ONCE_INIT;
+static int trace_key_ret;
+
+static void trace_key_init(void)
+{
+    trace_key_ret = pthread_key_create(&trace_key, av_free);
+}
+
+static TraceRing *trace_get_ring(void)
+{
+    TraceThread *t = pthread_getspecific(trace_key);
+
+    if (t && t->generation == trace_generation)
+        return t->ring;
+
+    if (!t) {
+        t = av_mallocz(sizeof(*t));
+        if (!t || pthread_setspecific(trace_key, t)) {
+            av_free(t);
+            return NULL;
+        }
+    }
+    /* a failed allocation is not retried for every event */
+    t->ring       = trace_ring_alloc();
+    t->generation = trace_generation;
+
+    return t->ring;
+}
+
+#define trace_lock()
+#define trace_unlock()
+#else
+/* without thread-local storage all threads share one locked ring */
+static TraceRing *trace_shared_ring;
+
+static TraceRing *trace_get_ring(void)
+{
+    return trace_shared_ring;
+}
+
+#define trace_lock()   ff_mutex_lock(&trace_mutex)
+#define trace_unlock() ff_mutex_unlock(&trace_mutex)
+#endif
+
+static void trace_record(const char *category, const char *name)
+{
+    int64_t ts;
+    TraceRing *ring;
+    TraceEvent *ev;
+
+    if (!atomic_load_explicit(&trace_enabled, memory_order_acquire))
+        return;
+
+    ts = av_gettime_relative();
+    trace_lock();
+    ring = trace_get_ring();
+    if (ring) {
+        ev = &ring->events[ring->pos++ & (ring->nb_events - 1)];
+        ev->ts       = ts;
+        ev->category = category;
+        if (name)
+            av_strlcpy(ev->name, name, sizeof(ev->name));
+        else
+            ev->name[0] = 0;
+    }
+    trace_unlock();
+}
+
+int av_trace_start(int nb_events)
+{
+    int ret = 0;
+
+    if (nb_events < 0 || nb_events > MAX_EVENTS)
+        return AVERROR(EINVAL);
+
+#if HAVE_PTHREADS
+    ff_thread_once(&trace_key_once, trace_key_init);
+    if (trace_key_ret)
+        return AVERROR(trace_key_ret);
+#endif
+
+    av_trace_stop();
+    ff_mutex_lock(&trace_mutex);
+    trace_rings_free();
+    trace_nb_events  = nb_events ? 1U << av_ceil_log2(nb_events) : DEFAULT_EVENTS;
+    trace_generation++;
+    trace_start_time = av_gettime_relative();
+    ff_mutex_unlock(&trace_mutex);
+
+#if !HAVE_PTHREADS
+    trace_shared_ring = trace_ring_alloc();
+    if (!trace_shared_ring)
+        ret = AVERROR(ENOMEM);
+#endif
+
+    if (ret >= 0)
+        atomic_store_explicit(&trace_enabled, 1, memory_order_release);
+    return ret;
+}
+
+void av_trace_stop(void)
+{
+    atomic_store_explicit(&trace_enabled, 0, memory_order_release);
+}
+
+void av_trace_begin(const char *category, const char *name)
+{
+    trace_record(category ? category : "", name);
+}
+
+void av_trace_end(void)
+{
+    trace_record(NULL, NULL);
+}
+
+void av_trace_set_thread_name(const char *name)
+{
+#if HAVE_PTHREADS
+    TraceRing *ring;
+
+    if (!atomic_load_explicit(&trace_enabled, memory_order_acquire))
+        return;
+
+    ring = trace_get_ring();
+    if (ring)
+        av_strlcpy(ring->thread_name, name, sizeof(ring->thread_name));
+#endif
+}
+
+static void write_string(FILE *f, const char *str)
+{
+    fputc('"', f);
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\')
+            fprintf(f, "\\%c", *str);
+        else if ((unsigned char)*str < 0x20)
+            fprintf(f, "\\u%04x", *str);
+        else
+            fputc(*str, f);
+    }
+    fputc('"', f);
+}
+
+int av_trace_write_json(const char *filename)
+{
+    const TraceRing *ring;
+    const char *sep = "\n";
+    FILE *f;
+    int ret = 0;
+
+    f = av_fopen_utf8(filename, "w");
+    if (!f)
+        return AVERROR(errno);
+
+    ff_mutex_lock(&trace_mutex);
+    fprintf(f, "{\"traceEvents\":[");
+    for (ring = trace_rings; ring; ring = ring->next) {
+        uint64_t i = ring->pos > ring->nb_events ? ring->pos - ring->nb_events : 0;
+
+        if (ring->thread_name[0]) {
+            fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,"
+                    "\"args\":{\"name\":", sep, ring->tid);
+            write_string(f, ring->thread_name);
+            fprintf(f, "}}");
+            sep = ",\n";
+        }
+
+        for (; i < ring->pos; i++) {
+            const TraceEvent *ev = &ring->events[i & (ring->nb_events - 1)];
+
+            fprintf(f, "%s{", sep);
+            if (ev->category) {
+                fprintf(f, "\"name\":");
+                write_string(f, ev->name);
+                fprintf(f, ",\"cat\":");
+                write_string(f, ev->category);
+                fprintf(f, ",\"ph\":\"B\",");
+            } else {
+                fprintf(f, "\"ph\":\"E\",");
+            }
+            fprintf(f, "\"ts\":%"PRId64",\"pid\":0,\"tid\":%d}",
+                    ev->ts - trace_start_time, ring->tid);
+            sep = ",\n";
+        }
+    }
+    fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    ff_mutex_unlock(&trace_mutex);
+
+    if (ferror(f))
+        ret = AVERROR(EIO);
+    if (fclose(f) && ret >= 0)
+        ret = AVERROR(errno);
+
+    return ret;
+}
+
+void av_trace_free(void)
+{
+    av_trace_stop();
+    ff_mutex_lock(&trace_mutex);
+    trace_rings_free();
+#if !HAVE_PTHREADS
+    trace_shared_ring = NULL;
+#endif
+    ff_mutex_unlock(&trace_mutex);
+}
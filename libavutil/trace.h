@@ -0,0 +1,107 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * @ingroup lavu_trace
+ * Timeline tracing
+ */
+
+#ifndef AVUTIL_TRACE_H
+#define AVUTIL_TRACE_H
+
+/**
+ * @defgroup lavu_trace Timeline tracing
+ * @ingroup lavu_misc
+ *
+ * Record the begin and end of processing steps (demuxing, decoding,
+ * filtering, ...) from any thread and export them as a timeline in the
+ * Chrome trace event format, which can be viewed with chrome://tracing or
+ * https://ui.perfetto.dev.
+ *
+ * Each thread records into its own ring buffer without locking, when the
+ * buffer is full the oldest events are overwritten. Recording is a no-op
+ * while tracing is not started.
+ *
+ * @{
+ */
+
+/**
+ * Start recording trace events, discarding the events of a previous trace.
+ *
+ * This must not be called while other threads may still record events of
+ * a previous trace.
+ *
+ * @param nb_events number of events kept per thread, rounded up to a power
+ *                  of two; 0 selects a default of 65536
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int av_trace_start(int nb_events);
+
+/**
+ * Stop recording trace events. The events recorded so far are kept until
+ * av_trace_start() or av_trace_free() is called.
+ */
+void av_trace_stop(void);
+
+/**
+ * Record the beginning of a processing step on the calling thread.
+ * Steps may be nested and every call must be matched by av_trace_end()
+ * on the same thread.
+ *
+ * @param category category of the step, e.g. "decode"; must be a string
+ *                 that stays valid until the trace is written, such as a
+ *                 string literal
+ * @param name     name of the step, e.g. the codec or filter name; it is
+ *                 copied and may be truncated
+ */
+void av_trace_begin(const char *category, const char *name);
+
+/**
+ * Record the end of the innermost processing step begun on the calling
+ * thread.
+ */
+void av_trace_end(void);
+
+/**
+ * Set the name shown for the calling thread in the trace. This has no
+ * effect while tracing is not started.
+ */
+void av_trace_set_thread_name(const char *name);
+
+/**
+ * Write the recorded events to a file in the Chrome trace event format.
+ *
+ * This should only be called after av_trace_stop(), once the other threads
+ * have finished recording.
+ *
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int av_trace_write_json(const char *filename);
+
+/**
+ * Free the recorded events. The same restrictions as for av_trace_start()
+ * apply.
+ */
+void av_trace_free(void);
+
+/**
+ * @}
+ */
+
+#endif /* AVUTIL_TRACE_H */
@@ -0,0 +1,165 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ * Check that the probe_threads and probe_cache options of
+ * avformat_find_stream_info() give the same stream information as the
+ * default serial probing.
+ */
+
+#include "libavutil/bprint.h"
+#include "libavutil/pixdesc.h"
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+
+static void print_rational(AVBPrint *bp, const char *name, AVRational q)
+{
+    av_bprintf(bp, " %s=%d/%d", name, q.num, q.den);
+}
+
+static void describe(AVBPrint *bp, const AVFormatContext *fmt_ctx)
+{
+    int i;
+
+    av_bprintf(bp, "format=%s start_time=%"PRId64" duration=%"PRId64" bit_rate=%"PRId64"\n",
+               fmt_ctx->iformat->name, fmt_ctx->start_time, fmt_ctx->duration,
+               fmt_ctx->bit_rate);
+    for (i = 0; i < fmt_ctx->nb_streams; i++) {
+        const AVStream *st = fmt_ctx->streams[i];
+        const AVCodecParameters *par = st->codecpar;
+
+        av_bprintf(bp, "stream %d: %s %s", i,
+                   av_get_media_type_string(par->codec_type),
+                   avcodec_get_name(par->codec_id));
+        print_rational(bp, "time_base", st->time_base);
+        print_rational(bp, "r_frame_rate", st->r_frame_rate);
+        print_rational(bp, "avg_frame_rate", st->avg_frame_rate);
+        av_bprintf(bp, " start_time=%"PRId64" duration=%"PRId64" bit_rate=%"PRId64
+                   " profile=%d level=%d extradata_size=%d",
+                   st->start_time, st->duration, par->bit_rate,
+                   par->profile, par->level, par->extradata_size);
+        if (par->codec_type == AVMEDIA_TYPE_VIDEO) {
+            av_bprintf(bp, " %dx%d pix_fmt=%s field_order=%d",
+                       par->width, par->height,
+                       av_get_pix_fmt_name(par->format), par->field_order);
+            print_rational(bp, "sar", par->sample_aspect_ratio);
+        } else if (par->codec_type == AVMEDIA_TYPE_AUDIO) {
+            av_bprintf(bp, " sample_rate=%d channels=%d channel_layout=0x%"PRIx64
+                       " sample_fmt=%s frame_size=%d",
+                       par->sample_rate, par->channels, par->channel_layout,
+                       av_get_sample_fmt_name(par->format), par->frame_size);
+        }
+        av_bprintf(bp, "\n");
+    }
+}
+
+/**
+ * Open the input with the given options and describe its streams.
+ *
+ * @param cache_hit set to 1 if no data was read by avformat_find_stream_info()
+ */
+static int probe(AVFormatContext **fmt_ctx, const char *input, const char *opts,
+                 AVBPrint *bp, int *cache_hit)
+{
+    AVDictionary *dict = NULL;
+    int64_t pos;
+    int ret;
+
+    ret = av_dict_parse_string(&dict, opts, "=", ":", 0);
+    if (ret < 0)
+        return ret;
+    ret = avformat_open_input(fmt_ctx, input, NULL, &dict);
+    av_dict_free(&dict);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Could not open %s\n", input);
+        return ret;
+    }
+
+    pos = avio_tell((*fmt_ctx)->pb);
+    ret = avformat_find_stream_info(*fmt_ctx, NULL);
+    if (ret < 0) {
+        av_log(NULL, AV_LOG_ERROR, "Could not find stream info of %s\n", input);
+        return ret;
+    }
+    *cache_hit = avio_tell((*fmt_ctx)->pb) == pos;
+
+    describe(bp, *fmt_ctx);
+    return av_bprint_is_complete(bp) ? 0 : AVERROR(ENOMEM);
+}
+
+static int test_input(const char *input)
+{
+    static const char *const options[] = {
+        "probe_threads=4",
+        "probe_threads=0",
+        "probe_cache=1",
+        "probe_cache=1",
+        "probe_cache=1:probe_threads=4",
+        "probe_cache=1:analyzeduration=10000000",
+        "probe_cache=1:analyzeduration=10000000",
+    };
+    AVFormatContext *ref_ctx = NULL, *fmt_ctx = NULL;
+    AVBPrint ref, bp;
+    int i, cache_hit, ret;
+
+    av_bprint_init(&ref, 0, AV_BPRINT_SIZE_UNLIMITED);
+    av_bprint_init(&bp,  0, AV_BPRINT_SIZE_UNLIMITED);
+
+    ret = probe(&ref_ctx, input, "", &ref, &cache_hit);
+    if (ret < 0)
+        goto end;
+    printf("%s", ref.str);
+
+    /* each context is closed before the next is opened, the cache outlives them */
+    for (i = 0; i < FF_ARRAY_ELEMS(options); i++) {
+        av_bprint_clear(&bp);
+        ret = probe(&fmt_ctx, input, options[i], &bp, &cache_hit);
+        avformat_close_input(&fmt_ctx);
+        if (ret < 0)
+            goto end;
+        printf("%s: %s%s\n", options[i],
+               strcmp(ref.str, bp.str) ? "differs" : "identical",
+               cache_hit ? ", from the cache" : "");
+        if (strcmp(ref.str, bp.str))
+            printf("%s", bp.str);
+    }
+
+end:
+    avformat_close_input(&ref_ctx);
+    av_bprint_finalize(&ref, NULL);
+    av_bprint_finalize(&bp,  NULL);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int i;
+
+    if (argc < 2) {
+        av_log(NULL, AV_LOG_ERROR, "Usage: %s <input> [<input>...]\n", argv[0]);
+        return 1;
+    }
+
+    for (i = 1; i < argc; i++)
+        if (test_input(argv[i]) < 0)
+            return 1;
+
+    return 0;
+}
@@ -0,0 +1,340 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Kernel and component benchmarks on generated content.
+ *
+ * Every benchmark is calibrated so that one repetition runs for about
+ * --time milliseconds, then --warmup repetitions are discarded and
+ * --repetitions are measured. The per-run times are summarized as JSON.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+#include "libavutil/common.h"
+#include "libavutil/cpu.h"
+#include "libavutil/error.h"
+#include "libavutil/ffversion.h"
+#include "libavutil/lfg.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/time.h"
+
+#define MAX_REPETITIONS 1000
+
+static const BenchDef *const suites[] = {
+#if CONFIG_H264DSP && CONFIG_H264QPEL
+    bench_h264dsp,
+#endif
+#if CONFIG_SWSCALE
+    bench_swscale,
+#endif
+#if CONFIG_SWRESAMPLE
+    bench_swresample,
+#endif
+#if CONFIG_AVCODEC
+    bench_codec,
+#endif
+    NULL
+};
+
+static struct {
+    const char *pattern;
+    int repetitions;
+    int warmup;
+    int64_t rep_time;       ///< target duration of a repetition in ns
+    int list;
+} state = {
+    .repetitions = 10,
+    .warmup      = 2,
+    .rep_time    = 20 * 1000000,
+};
+
+typedef struct BenchResult {
+    int64_t iterations;     ///< run() calls per repetition
+    int nb_reps;
+    double time[MAX_REPETITIONS];   ///< ns per run() call
+    double mean, median, min, max, stddev;
+} BenchResult;
+
+static int64_t time_ns(void)
+{
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    if (!clock_gettime(CLOCK_MONOTONIC, &ts))
+        return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+    return av_gettime_relative() * 1000;
+}
+
+int bench_alloc_frame(AVFrame *frame, enum AVPixelFormat format,
+                      int width, int height, int index)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+    AVLFG lfg;
+    int ret, p, x, y;
+
+    frame->format = format;
+    frame->width  = width;
+    frame->height = height;
+    ret = av_frame_get_buffer(frame, 0);
+    if (ret < 0)
+        return ret;
+
+    /* only planar 8-bit formats are used */
+    av_lfg_init(&lfg, index);
+    for (p = 0; p < desc->nb_components; p++) {
+        int w = p ? AV_CEIL_RSHIFT(width,  desc->log2_chroma_w) : width;
+        int h = p ? AV_CEIL_RSHIFT(height, desc->log2_chroma_h) : height;
+        uint8_t *dst = frame->data[p];
+
+        for (y = 0; y < h; y++, dst += frame->linesize[p])
+            for (x = 0; x < w; x++)
+                dst[x] = ((x + y + 4 * index) * (p + 1) >> 2) +
+                         (av_lfg_get(&lfg) >> 29);
+    }
+
+    return 0;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    const double *da = a, *db = b;
+    return FFDIFFSIGN(*da, *db);
+}
+
+static void compute_stats(BenchResult *r)
+{
+    double sorted[MAX_REPETITIONS], sum = 0, var = 0;
+    int i, n = r->nb_reps;
+
+    memcpy(sorted, r->time, n * sizeof(*sorted));
+    qsort(sorted, n, sizeof(*sorted), cmp_double);
+
+    for (i = 0; i < n; i++)
+        sum += sorted[i];
+    r->mean   = sum / n;
+    r->median = n & 1 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+    r->min    = sorted[0];
+    r->max    = sorted[n - 1];
+    for (i = 0; i < n; i++)
+        var += (sorted[i] - r->mean) * (sorted[i] - r->mean);
+    r->stddev = n > 1 ? sqrt(var / (n - 1)) : 0;
+}
+
+static int run_batch(const BenchDef *b, void *priv, int64_t iterations, int64_t *elapsed)
+{
+    int64_t i, start = time_ns();
+    int ret;
+
+    for (i = 0; i < iterations; i++) {
+        ret = b->run(priv);
+        if (ret < 0)
+            return ret;
+    }
+    *elapsed = time_ns() - start;
+    return 0;
+}
+
+static int measure(const BenchDef *b, void *priv, BenchResult *r)
+{
+    int64_t elapsed;
+    int i, ret;
+
+    /* calibration, which also warms up the caches */
+    r->iterations = 1;
+    while (1) {
+        ret = run_batch(b, priv, r->iterations, &elapsed);
+        if (ret < 0)
+            return ret;
+        if (elapsed >= state.rep_time || r->iterations >= INT64_MAX / 4)
+            break;
+        if (elapsed > state.rep_time / 16)
+            r->iterations = FFMAX(r->iterations * state.rep_time / elapsed, r->iterations + 1);
+        else
+            r->iterations *= 4;
+    }
+
+    for (i = 0; i < state.warmup; i++) {
+        ret = run_batch(b, priv, r->iterations, &elapsed);
+        if (ret < 0)
+            return ret;
+    }
+
+    for (i = 0; i < state.repetitions; i++) {
+        ret = run_batch(b, priv, r->iterations, &elapsed);
+        if (ret < 0)
+            return ret;
+        r->time[i] = (double)elapsed / r->iterations;
+    }
+    r->nb_reps = state.repetitions;
+    compute_stats(r);
+
+    return 0;
+}
+
+static void print_result(FILE *out, const BenchDef *b, const BenchResult *r, int first)
+{
+    int i;
+
+    fprintf(out, "%s    {\n", first ? "" : ",\n");
+    fprintf(out, "      \"name\": \"%s\",\n", b->name);
+    fprintf(out, "      \"group\": \"%s\",\n", b->group);
+    fprintf(out, "      \"unit\": \"%s\",\n", b->unit);
+    fprintf(out, "      \"items_per_run\": %"PRId64",\n", b->items);
+    fprintf(out, "      \"runs_per_repetition\": %"PRId64",\n", r->iterations);
+    fprintf(out, "      \"repetitions\": %d,\n", r->nb_reps);
+    fprintf(out, "      \"mean_ns\": %.1f,\n", r->mean);
+    fprintf(out, "      \"median_ns\": %.1f,\n", r->median);
+    fprintf(out, "      \"min_ns\": %.1f,\n", r->min);
+    fprintf(out, "      \"max_ns\": %.1f,\n", r->max);
+    fprintf(out, "      \"stddev_ns\": %.1f,\n", r->stddev);
+    fprintf(out, "      \"cv\": %.4f,\n", r->mean > 0 ? r->stddev / r->mean : 0);
+    fprintf(out, "      \"items_per_second\": %.1f,\n",
+            r->median > 0 ? b->items * 1e9 / r->median : 0);
+    fprintf(out, "      \"samples_ns\": [");
+    for (i = 0; i < r->nb_reps; i++)
+        fprintf(out, "%s%.1f", i ? ", " : "", r->time[i]);
+    fprintf(out, "]\n    }");
+}
+
+static int run_bench(FILE *out, const BenchDef *b, int *first)
+{
+    BenchResult *r = NULL;
+    void *priv = NULL;
+    int ret;
+
+    if (b->priv_size && !(priv = av_mallocz(b->priv_size)))
+        return AVERROR(ENOMEM);
+    r = av_mallocz(sizeof(*r));
+    if (!r) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    ret = b->init ? b->init(priv) : 0;
+    if (ret == AVERROR(ENOSYS)) {
+        fprintf(stderr, "%-32s skipped\n", b->name);
+        ret = 0;
+        goto end;
+    }
+    if (ret >= 0)
+        ret = measure(b, priv, r);
+    if (ret < 0) {
+        fprintf(stderr, "%-32s failed: %s\n", b->name, av_err2str(ret));
+    } else {
+        fprintf(stderr, "%-32s %12.1f ns/run  cv %5.2f%%  %12.1f %s/s\n",
+                b->name, r->median, r->mean > 0 ? 100 * r->stddev / r->mean : 0,
+                b->items * 1e9 / r->median, b->unit);
+        print_result(out, b, r, *first);
+        *first = 0;
+    }
+
+end:
+    if (b->uninit && priv)
+        b->uninit(priv);
+    av_free(priv);
+    av_free(r);
+    return ret;
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --list             list the benchmarks\n"
+            "  --bench=<pattern>  only run benchmarks whose name contains pattern\n"
+            "  --repetitions=<n>  measured repetitions (default %d)\n"
+            "  --warmup=<n>       discarded repetitions (default %d)\n"
+            "  --time=<ms>        target duration of a repetition (default %d)\n"
+            "  --output=<file>    write the JSON report to file instead of stdout\n",
+            name, state.repetitions, state.warmup, (int)(state.rep_time / 1000000));
+}
+
+int main(int argc, char *argv[])
+{
+    const char *output = NULL;
+    FILE *out = stdout;
+    int i, j, first = 1, ret = 0;
+
+    for (i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+
+        if (!strcmp(arg, "--list")) {
+            state.list = 1;
+        } else if (!strncmp(arg, "--bench=", 8)) {
+            state.pattern = arg + 8;
+        } else if (!strncmp(arg, "--repetitions=", 14)) {
+            state.repetitions = av_clip(atoi(arg + 14), 1, MAX_REPETITIONS);
+        } else if (!strncmp(arg, "--warmup=", 9)) {
+            state.warmup = FFMAX(atoi(arg + 9), 0);
+        } else if (!strncmp(arg, "--time=", 7)) {
+            state.rep_time = FFMAX(atoi(arg + 7), 1) * INT64_C(1000000);
+        } else if (!strncmp(arg, "--output=", 9)) {
+            output = arg + 9;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (state.list) {
+        for (i = 0; suites[i]; i++)
+            for (j = 0; suites[i][j].name; j++)
+                printf("%-10s %s\n", suites[i][j].group, suites[i][j].name);
+        return 0;
+    }
+
+    /* keep the output of the libraries from interleaving with the results */
+    av_log_set_level(AV_LOG_ERROR);
+
+    if (output && !(out = fopen(output, "w"))) {
+        fprintf(stderr, "Could not open %s\n", output);
+        return 1;
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"version\": \"%s\",\n", FFMPEG_VERSION);
+    fprintf(out, "  \"arch\": \"%s\",\n", ARCH_X86_64 ? "x86_64" : ARCH_X86_32 ? "x86_32" :
+                                         ARCH_AARCH64 ? "aarch64" : ARCH_ARM ? "arm" :
+                                         ARCH_PPC ? "ppc" : "other");
+    fprintf(out, "  \"cpu_flags\": %d,\n", av_get_cpu_flags());
+    fprintf(out, "  \"benchmarks\": [\n");
+    for (i = 0; suites[i]; i++) {
+        for (j = 0; suites[i][j].name; j++) {
+            const BenchDef *b = &suites[i][j];
+
+            if (state.pattern && !strstr(b->name, state.pattern))
+                continue;
+            if (run_bench(out, b, &first) < 0)
+                ret = 1;
+        }
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    if (output && fclose(out))
+        ret = 1;
+
+    return ret;
+}
@@ -0,0 +1,57 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef TESTS_BENCH_BENCH_H
+#define TESTS_BENCH_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "libavutil/frame.h"
+
+typedef struct BenchDef {
+    const char *name;
+    const char *group;      ///< "kernel" or "component"
+    const char *unit;       ///< what is counted by items, e.g. "block" or "frame"
+    int64_t items;          ///< number of units processed by one run() call
+
+    size_t priv_size;
+    /**
+     * Prepare the test content, priv is zeroed. Return a negative AVERROR
+     * code on failure or AVERROR(ENOSYS) to skip the benchmark.
+     */
+    int  (*init)(void *priv);
+    int  (*run)(void *priv);
+    void (*uninit)(void *priv);
+} BenchDef;
+
+/* NULL-terminated suites, one per file */
+extern const BenchDef bench_h264dsp[];
+extern const BenchDef bench_swscale[];
+extern const BenchDef bench_swresample[];
+extern const BenchDef bench_codec[];
+
+/**
+ * Allocate the buffers of a video frame and fill it with synthetic content:
+ * a gradient moving with index, with some noise on top.
+ */
+int bench_alloc_frame(AVFrame *frame, enum AVPixelFormat format,
+                      int width, int height, int index);
+
+#endif /* TESTS_BENCH_BENCH_H */
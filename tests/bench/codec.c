@@ -0,0 +1,348 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Encoding and decoding of generated content, single-threaded unless the
+ * name ends with _mt. The encoder is opened by init() and every run feeds
+ * it the frames again, continuing their timestamps, so that its setup is
+ * not measured. The streams to decode are encoded in memory by init(), so
+ * only codecs with a native encoder can be covered.
+ */
+
+#include <math.h>
+
+#include "bench.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/cpu.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libavutil/mem.h"
+#include "libavcodec/avcodec.h"
+
+#define MAX_FRAMES 64
+
+typedef struct CodecBench {
+    const AVCodec *encoder;
+    int threads;            ///< slice threads for a single slice, 0 for none
+    AVFrame *frames[MAX_FRAMES];
+    int nb_frames;
+    int64_t pts_span;       ///< duration of all the frames in their time base
+    AVCodecContext *enc;
+    AVPacket *enc_pkt;
+    AVPacket *pkts[MAX_FRAMES + 16];
+    int nb_pkts;
+    AVCodecContext *dec;
+    AVFrame *out;
+} CodecBench;
+
+static AVCodecContext *alloc_encoder(CodecBench *s)
+{
+    AVCodecContext *enc = avcodec_alloc_context3(s->encoder);
+    const AVFrame *f = s->frames[0];
+
+    if (!enc)
+        return NULL;
+    enc->thread_count = 1;
+    if (s->threads) {
+        enc->thread_count = s->threads;
+        enc->thread_type  = FF_THREAD_SLICE;
+        enc->slices       = 1;
+    }
+    if (s->encoder->type == AVMEDIA_TYPE_VIDEO) {
+        enc->width          = f->width;
+        enc->height         = f->height;
+        enc->pix_fmt        = f->format;
+        enc->time_base      = (AVRational){ 1, 25 };
+        enc->gop_size       = 12;
+        enc->max_b_frames   = 2;
+        enc->flags         |= AV_CODEC_FLAG_QSCALE;
+        enc->global_quality = FF_QP2LAMBDA * 4;
+    } else {
+        enc->sample_fmt     = f->format;
+        enc->sample_rate    = f->sample_rate;
+        enc->channel_layout = f->channel_layout;
+        enc->channels       = f->channels;
+        enc->time_base      = (AVRational){ 1, f->sample_rate };
+    }
+    if (avcodec_open2(enc, NULL, NULL) < 0)
+        avcodec_free_context(&enc);
+    return enc;
+}
+
+/* encode all the frames and keep the packets for the decoding benchmarks */
+static int encode_all(CodecBench *s)
+{
+    AVCodecContext *enc = alloc_encoder(s);
+    AVPacket *pkt = av_packet_alloc();
+    int i = 0, ret = 0;
+
+    if (!enc || !pkt) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    while (ret >= 0) {
+        if (i <= s->nb_frames) {
+            ret = avcodec_send_frame(enc, i < s->nb_frames ? s->frames[i] : NULL);
+            if (ret < 0)
+                break;
+            i++;
+        }
+        while ((ret = avcodec_receive_packet(enc, pkt)) >= 0) {
+            if (s->nb_pkts < FF_ARRAY_ELEMS(s->pkts)) {
+                s->pkts[s->nb_pkts++] = pkt;
+                pkt = av_packet_alloc();
+                if (!pkt) {
+                    ret = AVERROR(ENOMEM);
+                    goto end;
+                }
+            } else {
+                av_packet_unref(pkt);
+            }
+        }
+        if (ret == AVERROR(EAGAIN))
+            ret = 0;
+    }
+    if (ret == AVERROR_EOF)
+        ret = 0;
+
+end:
+    if (ret >= 0 && enc && enc->extradata_size) {
+        /* decoders may need the stream header */
+        s->dec->extradata = av_mallocz(enc->extradata_size + AV_INPUT_BUFFER_PADDING_SIZE);
+        if (!s->dec->extradata)
+            ret = AVERROR(ENOMEM);
+        else
+            memcpy(s->dec->extradata, enc->extradata, enc->extradata_size);
+        s->dec->extradata_size = enc->extradata_size;
+    }
+    av_packet_free(&pkt);
+    avcodec_free_context(&enc);
+    return ret;
+}
+
+static int alloc_video_frames(CodecBench *s, int width, int height, int nb_frames)
+{
+    int i, ret;
+
+    for (i = 0; i < nb_frames; i++) {
+        if (!(s->frames[i] = av_frame_alloc()))
+            return AVERROR(ENOMEM);
+        s->nb_frames++;
+        ret = bench_alloc_frame(s->frames[i], AV_PIX_FMT_YUV420P, width, height, i);
+        if (ret < 0)
+            return ret;
+        s->frames[i]->pts = i;
+    }
+    s->pts_span = nb_frames;
+    return 0;
+}
+
+static int alloc_audio_frames(CodecBench *s, int frame_size, int nb_frames)
+{
+    int i, j, ret;
+
+    for (i = 0; i < nb_frames; i++) {
+        AVFrame *f = s->frames[i] = av_frame_alloc();
+        int16_t *dst;
+
+        if (!f)
+            return AVERROR(ENOMEM);
+        s->nb_frames++;
+        f->format         = AV_SAMPLE_FMT_S16;
+        f->sample_rate    = 44100;
+        f->channel_layout = AV_CH_LAYOUT_STEREO;
+        f->channels       = 2;
+        f->nb_samples     = frame_size;
+        ret = av_frame_get_buffer(f, 0);
+        if (ret < 0)
+            return ret;
+        f->pts = (int64_t)i * frame_size;
+
+        dst = (int16_t *)f->data[0];
+        for (j = 0; j < frame_size; j++) {
+            int64_t t = f->pts + j;
+            dst[2 * j]     = lrint(12000 * sin(2 * M_PI * 440 * t / 44100.0));
+            dst[2 * j + 1] = lrint( 9000 * sin(2 * M_PI * 997 * t / 44100.0)) + (t * 7919 % 257 - 128);
+        }
+    }
+    s->pts_span = (int64_t)nb_frames * frame_size;
+    return 0;
+}
+
+static int codec_bench_init(CodecBench *s, enum AVCodecID id, int decode)
+{
+    const AVCodec *decoder;
+    int ret;
+
+    if (decode) {
+        decoder = avcodec_find_decoder(id);
+        if (!decoder)
+            return AVERROR(ENOSYS);
+        s->dec = avcodec_alloc_context3(decoder);
+        s->out = av_frame_alloc();
+        if (!s->dec || !s->out)
+            return AVERROR(ENOMEM);
+        s->dec->thread_count = 1;
+
+        ret = encode_all(s);
+        if (ret < 0)
+            return ret;
+        return avcodec_open2(s->dec, NULL, NULL);
+    }
+
+    s->enc_pkt = av_packet_alloc();
+    if (!s->enc_pkt)
+        return AVERROR(ENOMEM);
+    s->enc = alloc_encoder(s);
+    return s->enc ? 0 : AVERROR(EINVAL);
+}
+
+static int init_video(void *priv, enum AVCodecID id, int decode)
+{
+    CodecBench *s = priv;
+    int ret;
+
+    s->encoder = avcodec_find_encoder(id);
+    if (!s->encoder)
+        return AVERROR(ENOSYS);
+    ret = alloc_video_frames(s, 720, 576, 25);
+    if (ret < 0)
+        return ret;
+    return codec_bench_init(s, id, decode);
+}
+
+static int init_audio(void *priv, enum AVCodecID id, int decode)
+{
+    CodecBench *s = priv;
+    int ret;
+
+    s->encoder = avcodec_find_encoder(id);
+    if (!s->encoder)
+        return AVERROR(ENOSYS);
+    /* about one second */
+    ret = alloc_audio_frames(s, 4608, 10);
+    if (ret < 0)
+        return ret;
+    return codec_bench_init(s, id, decode);
+}
+
+static int init_mpeg2video_encode(void *priv)
+{
+    return init_video(priv, AV_CODEC_ID_MPEG2VIDEO, 0);
+}
+
+/* the same fixed quality as above, with the motion estimation spread over
+ * the threads while the frame is still coded as one slice */
+static int init_mpeg2video_encode_mt(void *priv)
+{
+    CodecBench *s = priv;
+
+    s->threads = FFMAX(av_cpu_count(), 2);
+    return init_video(priv, AV_CODEC_ID_MPEG2VIDEO, 0);
+}
+
+static int init_mpeg2video_decode(void *priv)
+{
+    return init_video(priv, AV_CODEC_ID_MPEG2VIDEO, 1);
+}
+
+static int init_mpeg4_decode(void *priv)
+{
+    return init_video(priv, AV_CODEC_ID_MPEG4, 1);
+}
+
+static int init_flac_encode(void *priv)
+{
+    return init_audio(priv, AV_CODEC_ID_FLAC, 0);
+}
+
+static int init_flac_decode(void *priv)
+{
+    return init_audio(priv, AV_CODEC_ID_FLAC, 1);
+}
+
+static int run_encode(void *priv)
+{
+    CodecBench *s = priv;
+    int i, ret;
+
+    for (i = 0; i < s->nb_frames; i++) {
+        ret = avcodec_send_frame(s->enc, s->frames[i]);
+        if (ret < 0)
+            return ret;
+        /* the next run continues the stream */
+        s->frames[i]->pts += s->pts_span;
+        while ((ret = avcodec_receive_packet(s->enc, s->enc_pkt)) >= 0)
+            av_packet_unref(s->enc_pkt);
+        if (ret != AVERROR(EAGAIN))
+            return ret;
+    }
+
+    return 0;
+}
+
+static int run_decode(void *priv)
+{
+    CodecBench *s = priv;
+    int i, ret;
+
+    for (i = 0; i <= s->nb_pkts; i++) {
+        ret = avcodec_send_packet(s->dec, i < s->nb_pkts ? s->pkts[i] : NULL);
+        if (ret < 0)
+            return ret;
+        while ((ret = avcodec_receive_frame(s->dec, s->out)) >= 0)
+            av_frame_unref(s->out);
+        if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF)
+            return ret;
+    }
+    avcodec_flush_buffers(s->dec);
+
+    return 0;
+}
+
+static void codec_bench_uninit(void *priv)
+{
+    CodecBench *s = priv;
+    int i;
+
+    for (i = 0; i < s->nb_frames; i++)
+        av_frame_free(&s->frames[i]);
+    for (i = 0; i < s->nb_pkts; i++)
+        av_packet_free(&s->pkts[i]);
+    avcodec_free_context(&s->enc);
+    av_packet_free(&s->enc_pkt);
+    avcodec_free_context(&s->dec);
+    av_frame_free(&s->out);
+}
+
+const BenchDef bench_codec[] = {
+    { "mpeg2video_encode_576p", "component", "frame", 25,
+      sizeof(CodecBench), init_mpeg2video_encode, run_encode, codec_bench_uninit },
+    { "mpeg2video_encode_576p_mt", "component", "frame", 25,
+      sizeof(CodecBench), init_mpeg2video_encode_mt, run_encode, codec_bench_uninit },
+    { "mpeg2video_decode_576p", "component", "frame", 25,
+      sizeof(CodecBench), init_mpeg2video_decode, run_decode, codec_bench_uninit },
+    { "mpeg4_decode_576p",      "component", "frame", 25,
+      sizeof(CodecBench), init_mpeg4_decode, run_decode, codec_bench_uninit },
+    { "flac_encode",            "component", "sample", 4608 * 10,
+      sizeof(CodecBench), init_flac_encode, run_encode, codec_bench_uninit },
+    { "flac_decode",            "component", "sample", 4608 * 10,
+      sizeof(CodecBench), init_flac_decode, run_decode, codec_bench_uninit },
+    { NULL }
+};
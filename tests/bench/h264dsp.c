@@ -0,0 +1,139 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * The inner loops of H.264 decoding, each applied to a whole 1080p luma
+ * plane per run so that the memory traffic is realistic.
+ */
+
+#include <string.h>
+
+#include "bench.h"
+#include "libavutil/error.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavutil/mem_internal.h"
+#include "libavcodec/h264dsp.h"
+#include "libavcodec/h264qpel.h"
+
+#define WIDTH   1920
+#define HEIGHT  1088
+#define PAD     32
+#define STRIDE  (WIDTH + 2 * PAD)
+#define MB_W    (WIDTH  / 16)
+#define MB_H    (HEIGHT / 16)
+
+typedef struct H264DSPBench {
+    H264DSPContext  dsp;
+    H264QpelContext qpel;
+    uint8_t *buf[2];
+    uint8_t *ref, *dst;         ///< top left pixel of the planes in buf
+    DECLARE_ALIGNED(16, int16_t, coeffs)[64];
+    DECLARE_ALIGNED(16, int16_t, block)[64];
+} H264DSPBench;
+
+static int h264dsp_init(void *priv)
+{
+    H264DSPBench *s = priv;
+    const size_t size = (size_t)STRIDE * (HEIGHT + 2 * PAD);
+    AVLFG lfg;
+    int i, x, y;
+
+    ff_h264dsp_init(&s->dsp, 8, 1);
+    ff_h264qpel_init(&s->qpel, 8);
+
+    for (i = 0; i < 2; i++) {
+        s->buf[i] = av_malloc(size);
+        if (!s->buf[i])
+            return AVERROR(ENOMEM);
+    }
+    s->ref = s->buf[0] + PAD * STRIDE + PAD;
+    s->dst = s->buf[1] + PAD * STRIDE + PAD;
+
+    /* smooth content with some noise, so that the loop filter is applied */
+    av_lfg_init(&lfg, 0x264);
+    for (y = -PAD; y < HEIGHT + PAD; y++)
+        for (x = -PAD; x < WIDTH + PAD; x++)
+            s->ref[y * STRIDE + x] = 64 + ((x + 2 * y) & 127) + (av_lfg_get(&lfg) >> 29);
+    memcpy(s->buf[1], s->buf[0], size);
+
+    for (i = 0; i < 64; i++)
+        s->coeffs[i] = (int)(av_lfg_get(&lfg) >> 25) - 64 >> (i >> 3);
+
+    return 0;
+}
+
+static void h264dsp_uninit(void *priv)
+{
+    H264DSPBench *s = priv;
+    av_freep(&s->buf[0]);
+    av_freep(&s->buf[1]);
+}
+
+static int run_qpel16_mc22(void *priv)
+{
+    H264DSPBench *s = priv;
+    qpel_mc_func mc = s->qpel.put_h264_qpel_pixels_tab[0][2 + 2 * 4];
+    int x, y;
+
+    for (y = 0; y < MB_H; y++)
+        for (x = 0; x < MB_W; x++)
+            mc(s->dst + 16 * (y * STRIDE + x), s->ref + 16 * (y * STRIDE + x) + 1, STRIDE);
+    return 0;
+}
+
+static int run_idct8_add(void *priv)
+{
+    H264DSPBench *s = priv;
+    int x, y;
+
+    for (y = 0; y < HEIGHT; y += 8) {
+        for (x = 0; x < WIDTH; x += 8) {
+            /* the transform clears the block */
+            memcpy(s->block, s->coeffs, sizeof(s->block));
+            s->dsp.h264_idct8_add(s->dst + y * STRIDE + x, s->block, STRIDE);
+        }
+    }
+    return 0;
+}
+
+static int run_loop_filter_luma(void *priv)
+{
+    H264DSPBench *s = priv;
+    int8_t tc0[4] = { 1, 2, 1, 2 };
+    int x, y;
+
+    for (y = 1; y < MB_H; y++) {
+        for (x = 0; x < MB_W; x++) {
+            uint8_t *pix = s->dst + 16 * (y * STRIDE + x);
+            s->dsp.h264_v_loop_filter_luma(pix, STRIDE, 40, 10, tc0);
+            s->dsp.h264_h_loop_filter_luma(pix, STRIDE, 40, 10, tc0);
+        }
+    }
+    return 0;
+}
+
+const BenchDef bench_h264dsp[] = {
+    { "h264_qpel16_mc22",      "kernel", "block", MB_W * MB_H,
+      sizeof(H264DSPBench), h264dsp_init, run_qpel16_mc22, h264dsp_uninit },
+    { "h264_idct8_add",        "kernel", "block", WIDTH * HEIGHT / 64,
+      sizeof(H264DSPBench), h264dsp_init, run_idct8_add, h264dsp_uninit },
+    { "h264_loop_filter_luma", "kernel", "macroblock", MB_W * (MB_H - 1),
+      sizeof(H264DSPBench), h264dsp_init, run_loop_filter_luma, h264dsp_uninit },
+    { NULL }
+};
@@ -0,0 +1,116 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <math.h>
+
+#include "bench.h"
+#include "libavutil/channel_layout.h"
+#include "libavutil/common.h"
+#include "libavutil/error.h"
+#include "libavutil/mem.h"
+#include "libavutil/samplefmt.h"
+#include "libswresample/swresample.h"
+
+/* one run converts one second of stereo audio */
+#define IN_RATE     48000
+#define CHANNELS    2
+
+typedef struct SwrBench {
+    struct SwrContext *swr;
+    uint8_t **src, **dst;
+    int dst_samples;
+} SwrBench;
+
+static int swr_bench_init(SwrBench *s, enum AVSampleFormat src_fmt,
+                          enum AVSampleFormat dst_fmt, int out_rate)
+{
+    int ret, i;
+
+    s->swr = swr_alloc_set_opts(NULL, AV_CH_LAYOUT_STEREO, dst_fmt, out_rate,
+                                AV_CH_LAYOUT_STEREO, src_fmt, IN_RATE, 0, NULL);
+    if (!s->swr)
+        return AVERROR(ENOMEM);
+    ret = swr_init(s->swr);
+    if (ret < 0)
+        return ret;
+
+    ret = av_samples_alloc_array_and_samples(&s->src, NULL, CHANNELS, IN_RATE, src_fmt, 0);
+    if (ret < 0)
+        return ret;
+    s->dst_samples = swr_get_out_samples(s->swr, IN_RATE) + 256;
+    ret = av_samples_alloc_array_and_samples(&s->dst, NULL, CHANNELS, s->dst_samples, dst_fmt, 0);
+    if (ret < 0)
+        return ret;
+
+    /* two sine waves with a little noise */
+    for (i = 0; i < IN_RATE * CHANNELS; i++) {
+        double v = 0.4 * sin(i / 2 * 2 * M_PI * (i & 1 ? 997 : 440) / IN_RATE) +
+                   0.01 * ((i * 7919) % 201 - 100) / 100.0;
+        if (src_fmt == AV_SAMPLE_FMT_S16)
+            ((int16_t *)s->src[0])[i] = lrint(v * 32767);
+        else
+            ((float *)s->src[i & 1])[i / 2] = v;
+    }
+
+    return 0;
+}
+
+static int init_s16_48000_44100(void *priv)
+{
+    return swr_bench_init(priv, AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_S16, 44100);
+}
+
+static int init_fltp_48000_44100(void *priv)
+{
+    return swr_bench_init(priv, AV_SAMPLE_FMT_FLTP, AV_SAMPLE_FMT_FLTP, 44100);
+}
+
+static int init_s16_fltp_48000(void *priv)
+{
+    return swr_bench_init(priv, AV_SAMPLE_FMT_S16, AV_SAMPLE_FMT_FLTP, 48000);
+}
+
+static int run_swr(void *priv)
+{
+    SwrBench *s = priv;
+    int ret = swr_convert(s->swr, s->dst, s->dst_samples,
+                          (const uint8_t **)s->src, IN_RATE);
+    return FFMIN(ret, 0);
+}
+
+static void swr_bench_uninit(void *priv)
+{
+    SwrBench *s = priv;
+    swr_free(&s->swr);
+    if (s->src)
+        av_freep(&s->src[0]);
+    av_freep(&s->src);
+    if (s->dst)
+        av_freep(&s->dst[0]);
+    av_freep(&s->dst);
+}
+
+const BenchDef bench_swresample[] = {
+    { "swr_s16_48000_44100",  "component", "sample", IN_RATE,
+      sizeof(SwrBench), init_s16_48000_44100, run_swr, swr_bench_uninit },
+    { "swr_fltp_48000_44100", "component", "sample", IN_RATE,
+      sizeof(SwrBench), init_fltp_48000_44100, run_swr, swr_bench_uninit },
+    { "swr_s16_to_fltp",      "component", "sample", IN_RATE,
+      sizeof(SwrBench), init_s16_fltp_48000, run_swr, swr_bench_uninit },
+    { NULL }
+};
@@ -0,0 +1,96 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "bench.h"
+#include "libavutil/error.h"
+#include "libavutil/frame.h"
+#include "libswscale/swscale.h"
+
+typedef struct SwsBench {
+    struct SwsContext *sws;
+    AVFrame *src, *dst;
+} SwsBench;
+
+static int sws_bench_init(SwsBench *s, enum AVPixelFormat src_fmt, int src_w, int src_h,
+                          enum AVPixelFormat dst_fmt, int dst_w, int dst_h, int flags)
+{
+    int ret;
+
+    s->src = av_frame_alloc();
+    s->dst = av_frame_alloc();
+    if (!s->src || !s->dst)
+        return AVERROR(ENOMEM);
+
+    ret = bench_alloc_frame(s->src, src_fmt, src_w, src_h, 0);
+    if (ret < 0)
+        return ret;
+    s->dst->format = dst_fmt;
+    s->dst->width  = dst_w;
+    s->dst->height = dst_h;
+    ret = av_frame_get_buffer(s->dst, 0);
+    if (ret < 0)
+        return ret;
+
+    s->sws = sws_getContext(src_w, src_h, src_fmt, dst_w, dst_h, dst_fmt,
+                            flags, NULL, NULL, NULL);
+    return s->sws ? 0 : AVERROR(EINVAL);
+}
+
+static int init_yuv420p_nv12(void *priv)
+{
+    return sws_bench_init(priv, AV_PIX_FMT_YUV420P, 1920, 1080,
+                          AV_PIX_FMT_NV12, 1920, 1080, SWS_BILINEAR);
+}
+
+static int init_yuv420p_rgb24(void *priv)
+{
+    return sws_bench_init(priv, AV_PIX_FMT_YUV420P, 1920, 1080,
+                          AV_PIX_FMT_RGB24, 1920, 1080, SWS_BILINEAR);
+}
+
+static int init_bicubic_1080p_720p(void *priv)
+{
+    return sws_bench_init(priv, AV_PIX_FMT_YUV420P, 1920, 1080,
+                          AV_PIX_FMT_YUV420P, 1280, 720, SWS_BICUBIC);
+}
+
+static int run_sws(void *priv)
+{
+    SwsBench *s = priv;
+    int ret = sws_scale(s->sws, (const uint8_t * const *)s->src->data, s->src->linesize,
+                        0, s->src->height, s->dst->data, s->dst->linesize);
+    return ret > 0 ? 0 : AVERROR_EXTERNAL;
+}
+
+static void sws_bench_uninit(void *priv)
+{
+    SwsBench *s = priv;
+    sws_freeContext(s->sws);
+    av_frame_free(&s->src);
+    av_frame_free(&s->dst);
+}
+
+const BenchDef bench_swscale[] = {
+    { "sws_yuv420p_nv12_1080p",   "component", "frame", 1,
+      sizeof(SwsBench), init_yuv420p_nv12, run_sws, sws_bench_uninit },
+    { "sws_yuv420p_rgb24_1080p",  "component", "frame", 1,
+      sizeof(SwsBench), init_yuv420p_rgb24, run_sws, sws_bench_uninit },
+    { "sws_bicubic_1080p_720p",   "component", "frame", 1,
+      sizeof(SwsBench), init_bicubic_1080p_720p, run_sws, sws_bench_uninit },
+    { NULL }
+};
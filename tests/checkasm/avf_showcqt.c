@@ -0,0 +1,105 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <float.h>
+#include <string.h>
+
+#include "libavfilter/avf_showcqt.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem_internal.h"
+#include "checkasm.h"
+
+#define FFT_LEN   2048
+#define CQT_LEN   64
+#define MAX_COEFF 96
+
+#define randomize_float(buf, len)                               \
+    do {                                                        \
+        for (int i = 0; i < len; i++)                           \
+            buf[i] = (float)rnd() / (UINT_MAX >> 1) - 1.0f;     \
+    } while (0)
+
+static void test_cqt_calc(ShowCQTContext *s)
+{
+    LOCAL_ALIGNED_32(FFTComplex, src,  [FFT_LEN + 64]);
+    LOCAL_ALIGNED_32(FFTComplex, dst0, [CQT_LEN]);
+    LOCAL_ALIGNED_32(FFTComplex, dst1, [CQT_LEN]);
+    LOCAL_ALIGNED_32(float, val0, [CQT_LEN * MAX_COEFF]);
+    LOCAL_ALIGNED_32(float, val1, [CQT_LEN * MAX_COEFF]);
+    Coeffs coeffs0[CQT_LEN], coeffs1[CQT_LEN];
+    const int align = s->cqt_align;
+
+    declare_func(void, FFTComplex *dst, const FFTComplex *src, const Coeffs *coeffs,
+                 int len, int fft_len);
+
+    randomize_float(((float *)src), 2 * (FFT_LEN + 64));
+    src[FFT_LEN] = src[0];
+    randomize_float(val0, CQT_LEN * MAX_COEFF);
+
+    for (int k = 0; k < CQT_LEN; k++) {
+        /* stay away from the edges, the SIMD versions read vectors
+         * around fft_len - i */
+        int start = 8 + rnd() % (FFT_LEN - MAX_COEFF - 16);
+        int len   = rnd() % (MAX_COEFF - 8);
+
+        /* some coefficients are empty above the Nyquist frequency */
+        if (!(rnd() & 15))
+            len = 0;
+
+        coeffs0[k].start = start & ~(align - 1);
+        coeffs0[k].len   = len ? FFALIGN(len, align) : 0;
+        coeffs0[k].val   = val0 + k * MAX_COEFF;
+        coeffs1[k]       = coeffs0[k];
+        coeffs1[k].val   = val1 + k * MAX_COEFF;
+    }
+
+    /* the SIMD versions may expect the values in a permuted order */
+    memcpy(val1, val0, CQT_LEN * MAX_COEFF * sizeof(*val1));
+    if (s->permute_coeffs)
+        for (int k = 0; k < CQT_LEN; k++)
+            s->permute_coeffs(coeffs1[k].val, coeffs1[k].len);
+
+    call_ref(dst0, src, coeffs0, CQT_LEN, FFT_LEN);
+    call_new(dst1, src, coeffs1, CQT_LEN, FFT_LEN);
+
+    for (int k = 0; k < CQT_LEN; k++) {
+        /* the results are squared sums of up to MAX_COEFF products */
+        const float eps = MAX_COEFF * 8 * FLT_EPSILON;
+
+        if (!float_near_abs_eps(dst0[k].re, dst1[k].re, eps * (1.0f + fabsf(dst0[k].re))) ||
+            !float_near_abs_eps(dst0[k].im, dst1[k].im, eps * (1.0f + fabsf(dst0[k].im)))) {
+            fprintf(stderr, "%d: %f %f - %f %f\n",
+                    k, dst0[k].re, dst0[k].im, dst1[k].re, dst1[k].im);
+            fail();
+            break;
+        }
+    }
+
+    bench_new(dst1, src, coeffs1, CQT_LEN, FFT_LEN);
+}
+
+void checkasm_check_showcqt(void)
+{
+    ShowCQTContext s = { 0 };
+
+    ff_showcqt_init_cqt(&s);
+
+    if (check_func(s.cqt_calc, "cqt_calc"))
+        test_cqt_calc(&s);
+    report("cqt_calc");
+}
@@ -0,0 +1,96 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "libavutil/mem_internal.h"
+
+#include "libavcodec/opus_pvq.h"
+
+#include "checkasm.h"
+
+#define randomize_float(buf, len)                               \
+    do {                                                        \
+        for (int i = 0; i < len; i++) {                         \
+            float f = (float)rnd() / (UINT_MAX >> 1) - 1.0f;    \
+            buf[i] = f;                                         \
+        }                                                       \
+    } while (0)
+
+/* The SIMD versions overread the input, so keep the buffers padded */
+#define MAX_SIZE 256
+
+/* The SSE2/SSE4 versions are approximate searches and may pick a different
+ * (slightly worse) pulse vector than the C version, so only validate the
+ * properties the encoder relies on: exactly K pulses are placed and the
+ * returned value is the energy of the pulse vector. */
+static int check_pulses(const int *y, float y_norm, int K, int N)
+{
+    int pulses = 0, energy = 0;
+
+    for (int i = 0; i < N; i++) {
+        pulses += FFABS(y[i]);
+        energy += y[i] * y[i];
+    }
+
+    return pulses == K && y_norm == (float)energy;
+}
+
+static void test_pvq_search(int K, int N)
+{
+    LOCAL_ALIGNED_32(float, X0, [MAX_SIZE]);
+    LOCAL_ALIGNED_32(float, X1, [MAX_SIZE]);
+    LOCAL_ALIGNED_32(int,   y0, [MAX_SIZE]);
+    LOCAL_ALIGNED_32(int,   y1, [MAX_SIZE]);
+    float norm0, norm1;
+
+    declare_func_float(float, float *X, int *y, int K, int N);
+
+    randomize_float(X0, MAX_SIZE);
+    memcpy(X1, X0, MAX_SIZE * sizeof(float));
+    memset(y0, 0, MAX_SIZE * sizeof(int));
+    memset(y1, 0, MAX_SIZE * sizeof(int));
+
+    norm0 = call_ref(X0, y0, K, N);
+    norm1 = call_new(X1, y1, K, N);
+
+    if (!check_pulses(y0, norm0, K, N) || !check_pulses(y1, norm1, K, N))
+        fail();
+
+    bench_new(X1, y1, K, N);
+}
+
+void checkasm_check_celt_pvq(void)
+{
+    static const struct {
+        int K, N;
+    } tests[] = {
+        {  1,   2 }, {  4,   8 }, { 10,  16 }, {  5,  24 },
+        { 32,  36 }, { 12,  72 }, { 40,  96 }, { 64, 176 },
+    };
+    CeltPVQ *pvq;
+
+    if (ff_celt_pvq_init(&pvq, 1) < 0)
+        return;
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(tests); i++) {
+        if (check_func(pvq->pvq_search, "pvq_search_%d_%d", tests[i].K, tests[i].N))
+            test_pvq_search(tests[i].K, tests[i].N);
+    }
+    report("pvq_search");
+
+    ff_celt_pvq_uninit(&pvq);
+}
@@ -46,6 +46,7 @@ void checkasm_check_audiodsp(void);
 void checkasm_check_blend(void);
 void checkasm_check_blockdsp(void);
 void checkasm_check_bswapdsp(void);
+void checkasm_check_celt_pvq(void);
 void checkasm_check_colorspace(void);
 void checkasm_check_exrdsp(void);
 void checkasm_check_fixed_dsp(void);
@@ -77,6 +78,7 @@ void checkasm_check_nlmeans(void);
 void checkasm_check_opusdsp(void);
 void checkasm_check_pixblockdsp(void);
 void checkasm_check_sbrdsp(void);
+void checkasm_check_showcqt(void);
 void checkasm_check_synth_filter(void);
 void checkasm_check_sw_rgb(void);
 void checkasm_check_sw_scale(void);
@@ -392,6 +392,25 @@ video_filter(){
         $FLAGS $ENC_OPTS -vf "$filters" -vcodec rawvideo -frames:v 5 $* -f nut md5:
 }
 
+filter_reinit(){
+    filters=$1
+    outdir="tests/data/filter-reinit"
+    logfile="${outdir}/${test}.log"
+    cleanfiles="$cleanfiles $logfile"
+    mkdir -p "$outdir"
+    raw_src="${target_path}/tests/vsynth1/%02d.pgm"
+    # three frames of each size
+    for part in 1:176x144 4:352x288 7:128x96; do
+        first=${part%:*}
+        ffmpeg -f image2 -c:v pgmyuv -start_number $first -i $raw_src \
+            -sws_flags +accurate_rnd+bitexact -vf scale=${part#*:} -frames:v 3 \
+            -c:v pgmyuv -start_number $first -y $target_path/$outdir/%02d.pgm
+    done
+    framecrc -v verbose -f image2 -c:v pgmyuv -i $target_path/$outdir/%02d.pgm \
+        -sws_flags +accurate_rnd+bitexact -vf "$filters" -c:v rawvideo 2> $logfile
+    sed -n 's/^\(Filtergraph #[0-9]* [a-z ]*\) in [0-9]* us$/\1/p' $logfile
+}
+
 pixfmts(){
     filter=${test#filter-pixfmts-}
     filter=${filter%_*}
@@ -498,6 +517,72 @@ venc_data(){
     run tools/venc_data_dump${EXECSUF} ${file} ${stream} ${frames} ${threads} ${thread_type}
 }
 
+# $1=dec|enc, remaining arguments are passed to ffmpeg
+# Print the throughput in frames per second, the user time and the peak
+# memory use of the best of $BENCH_RUNS runs, and compare them to the line
+# of the same test in $BENCH_BASELINE if it is set. Decoded frames are
+# counted for dec and encoded packets for enc, so that audio frames are
+# codec frames in both cases.
+bench(){
+    counter="frames decoded"
+    test $1 = enc && counter="packets muxed"
+    shift
+    benchlog="${outdir}/${test}.log"
+    benchfile="${outdir}/${test}.bench"
+    cleanfiles="$cleanfiles $benchlog"
+
+    best=
+    i=0
+    while [ $i -lt ${BENCH_RUNS:-3} ]; do
+        if ! ffmpeg -auto_conversion_filters -benchmark -v verbose "$@" 2>"$benchlog"; then
+            cat "$benchlog" >&2
+            return 1
+        fi
+        result=$(awk -v test="$test" -v counter="$counter" '
+            match($0, "[0-9]+ " counter) { frames += substr($0, RSTART, RLENGTH) }
+            /^bench: utime=/ { utime = substr($2, 7) + 0; rtime = substr($4, 7) + 0 }
+            /^bench: maxrss=/ { maxrss = substr($2, 8) + 0 }
+            END {
+                if (!frames || !rtime) exit 1
+                printf "%s fps=%.2f utime=%.3f maxrss=%d\n", test, frames / rtime, utime, maxrss
+            }' "$benchlog") || return 1
+        best=$(printf '%s\n%s\n' "$best" "$result" | awk '
+            { split($2, f, "="); if (f[2] + 0 > max) { max = f[2] + 0; line = $0 } }
+            END { print line }')
+        i=$((i + 1))
+    done
+
+    echo "$best" > "$benchfile"
+    echo "$best"
+
+    test -n "$BENCH_BASELINE" || return 0
+    baseline=$(grep "^${test} " "$BENCH_BASELINE") || return 0
+    printf '%s\n%s\n' "$baseline" "$best" | awk -v tol="${BENCH_TOLERANCE:-5}" '
+        {
+            for (i = 2; i <= NF; i++) {
+                split($i, kv, "=")
+                v[NR, kv[1]] = kv[2] + 0
+            }
+        }
+        function check(key, sign,    b, c, d) {
+            b = v[1, key]
+            c = v[2, key]
+            if (!b)
+                return
+            d = 100 * (c - b) / b
+            if (sign * d > tol) {
+                printf "%s: %g -> %g (%+.1f%%, tolerance %g%%)\n", key, b, c, d, tol
+                err = 1
+            }
+        }
+        END {
+            check("fps", -1)
+            check("utime", 1)
+            check("maxrss", 1)
+            exit err
+        }'
+}
+
 null(){
     :
 }
@@ -16,6 +16,10 @@ FATE_API_SAMPLES_LIBAVFORMAT-$(call DEMDEC, H264, H264) += fate-api-h264-slice
 fate-api-h264-slice: $(APITESTSDIR)/api-h264-slice-test$(EXESUF)
 fate-api-h264-slice: CMD = run $(APITESTSDIR)/api-h264-slice-test$(EXESUF) 2 $(TARGET_SAMPLES)/h264/crew_cif.nal
 
+FATE_API_LIBAVFORMAT-$(call ALLYES, MATROSKA_DEMUXER NUT_DEMUXER AVI_DEMUXER MPEG4_DECODER MP2_DECODER) += fate-api-probe
+fate-api-probe: $(APITESTSDIR)/api-probe-test$(EXESUF) fate-lavf-mkv fate-lavf-nut fate-lavf-avi
+fate-api-probe: CMD = run $(APITESTSDIR)/api-probe-test$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.mkv $(TARGET_PATH)/tests/data/lavf/lavf.nut $(TARGET_PATH)/tests/data/lavf/lavf.avi
+
 FATE_API_LIBAVFORMAT-$(call DEMDEC, FLV, FLV) += fate-api-seek
 fate-api-seek: $(APITESTSDIR)/api-seek-test$(EXESUF) fate-lavf-flv
 fate-api-seek: CMD = run $(APITESTSDIR)/api-seek-test$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.flv 0 720
@@ -0,0 +1,67 @@
+# Decoding and encoding throughput of representative samples. These tests
+# are not part of a default fate run; "make fate-bench" runs them and
+# collects the results in $(BENCH_REPORT).
+
+BENCH_RUNS      ?= 3
+BENCH_TOLERANCE ?= 5
+BENCH_REPORT    ?= tests/data/fate/bench.report
+export BENCH_RUNS BENCH_TOLERANCE BENCH_BASELINE
+
+FATE_BENCH_DEC-$(call ALLYES, H264_DEMUXER H264_DECODER NULL_MUXER) += fate-bench-h264-dec
+fate-bench-h264-dec: CMD = bench dec -i $(TARGET_SAMPLES)/h264/bbc2.sample.h264 -f null -
+
+FATE_BENCH_DEC-$(call ALLYES, HEVC_DEMUXER HEVC_DECODER NULL_MUXER) += fate-bench-hevc-dec
+fate-bench-hevc-dec: CMD = bench dec -i $(TARGET_SAMPLES)/hevc-conformance/AMP_E_Hisilicon.bit -f null -
+
+FATE_BENCH_DEC-$(call ALLYES, MATROSKA_DEMUXER VP9_DECODER NULL_MUXER) += fate-bench-vp9-dec
+fate-bench-vp9-dec: CMD = bench dec -i $(TARGET_SAMPLES)/vp9-test-vectors/vp90-2-15-segkey_adpq.webm -f null -
+
+FATE_BENCH_DEC-$(call ALLYES, MOV_DEMUXER PRORES_DECODER NULL_MUXER) += fate-bench-prores-dec
+fate-bench-prores-dec: CMD = bench dec -i $(TARGET_SAMPLES)/prores/Sequence_1-Apple_ProRes_422_HQ.mov -f null -
+
+FATE_BENCH_DEC-$(call ALLYES, MOV_DEMUXER AAC_DECODER NULL_MUXER) += fate-bench-aac-dec
+fate-bench-aac-dec: CMD = bench dec -i $(TARGET_SAMPLES)/aac/al04_44.mp4 -f null -
+
+FATE_BENCH_DEC-$(call ALLYES, FLAC_DEMUXER FLAC_DECODER NULL_MUXER) += fate-bench-flac-dec
+fate-bench-flac-dec: CMD = bench dec -i $(TARGET_SAMPLES)/filter/hdcd-mix.flac -f null -
+
+FATE_BENCH_DEC-$(call ALLYES, MATROSKA_DEMUXER OPUS_DECODER NULL_MUXER) += fate-bench-opus-dec
+fate-bench-opus-dec: CMD = bench dec -i $(TARGET_SAMPLES)/opus/testvector11.mka -f null -
+
+# The encoders are fed with decoded samples, so their figures include the
+# cost of decoding the source, which is small in comparison.
+BENCH_VSRC = -i $(TARGET_SAMPLES)/h264/crew_cif_timecode-2.h264
+BENCH_ASRC = -i $(TARGET_SAMPLES)/audio-reference/luckynight_2ch_44kHz_s16.wav
+
+FATE_BENCH_ENC-$(call ALLYES, H264_DEMUXER H264_DECODER LIBX264_ENCODER NULL_MUXER) += fate-bench-h264-enc
+fate-bench-h264-enc: CMD = bench enc $(BENCH_VSRC) -c:v libx264 -f null -
+
+FATE_BENCH_ENC-$(call ALLYES, H264_DEMUXER H264_DECODER LIBX265_ENCODER NULL_MUXER) += fate-bench-hevc-enc
+fate-bench-hevc-enc: CMD = bench enc $(BENCH_VSRC) -c:v libx265 -f null -
+
+FATE_BENCH_ENC-$(call ALLYES, H264_DEMUXER H264_DECODER LIBVPX_VP9_ENCODER NULL_MUXER) += fate-bench-vp9-enc
+fate-bench-vp9-enc: CMD = bench enc $(BENCH_VSRC) -c:v libvpx-vp9 -deadline good -cpu-used 4 -f null -
+
+FATE_BENCH_ENC-$(call ALLYES, MOV_DEMUXER PRORES_DECODER PRORES_KS_ENCODER NULL_MUXER) += fate-bench-prores-enc
+fate-bench-prores-enc: CMD = bench enc -i $(TARGET_SAMPLES)/prores/Sequence_1-Apple_ProRes_422_HQ.mov -c:v prores_ks -f null -
+
+FATE_BENCH_ENC-$(call ALLYES, WAV_DEMUXER PCM_S16LE_DECODER AAC_ENCODER NULL_MUXER) += fate-bench-aac-enc
+fate-bench-aac-enc: CMD = bench enc $(BENCH_ASRC) -c:a aac -b:a 128k -f null -
+
+FATE_BENCH_ENC-$(call ALLYES, WAV_DEMUXER PCM_S16LE_DECODER FLAC_ENCODER NULL_MUXER) += fate-bench-flac-enc
+fate-bench-flac-enc: CMD = bench enc $(BENCH_ASRC) -c:a flac -f null -
+
+FATE_BENCH_ENC-$(call ALLYES, WAV_DEMUXER PCM_S16LE_DECODER OPUS_ENCODER ARESAMPLE_FILTER NULL_MUXER) += fate-bench-opus-enc
+fate-bench-opus-enc: CMD = bench enc $(BENCH_ASRC) -c:a opus -strict experimental -f null -
+
+FATE_BENCH-$(CONFIG_FFMPEG) += $(FATE_BENCH_DEC-yes) $(FATE_BENCH_ENC-yes)
+FATE_BENCH += $(FATE_BENCH-yes)
+
+$(FATE_BENCH): ffmpeg$(PROGSSUF)$(EXESUF)
+$(FATE_BENCH): CMP = null
+
+fate-bench-dec: $(FATE_BENCH_DEC-yes)
+fate-bench-enc: $(FATE_BENCH_ENC-yes)
+fate-bench: $(FATE_BENCH)
+	$(Q)cat /dev/null $(FATE_BENCH:fate-%=tests/data/fate/%.bench) > $(BENCH_REPORT)
+	@echo "Benchmark report written to $(BENCH_REPORT)"
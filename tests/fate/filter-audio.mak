@@ -397,6 +397,10 @@ FATE_AFILTER-yes += fate-filter-formats
 fate-filter-formats: libavfilter/tests/formats$(EXESUF)
 fate-filter-formats: CMD = run libavfilter/tests/formats$(EXESUF)
 
+FATE_AFILTER-$(call ALLYES, FORMAT_FILTER HFLIP_FILTER SCALE_FILTER AFORMAT_FILTER ARESAMPLE_FILTER) += fate-filter-formats-cache
+fate-filter-formats-cache: libavfilter/tests/formatscache$(EXESUF)
+fate-filter-formats-cache: CMD = run libavfilter/tests/formatscache$(EXESUF)
+
 FATE_SAMPLES_AVCONV += $(FATE_AFILTER_SAMPLES-yes)
 FATE_FFMPEG += $(FATE_AFILTER-yes)
 fate-afilter: $(FATE_AFILTER-yes) $(FATE_AFILTER_SAMPLES-yes)
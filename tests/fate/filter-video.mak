@@ -672,6 +672,15 @@ fate-filter-thumbnail: CMD = video_filter "scale,thumbnail=10"
 FATE_FILTER_VSYNTH-$(CONFIG_TILE_FILTER) += fate-filter-tile
 fate-filter-tile: CMD = video_filter "tile=3x3:nb_frames=5:padding=7:margin=2"
 
+# the frame size changes twice and the graph is reconfigured in place, the
+# trim filter keeps counting frames across the changes
+FATE_FILTER_VSYNTH-$(call ALLYES, TRIM_FILTER HFLIP_FILTER SCALE_FILTER PGMYUV_ENCODER IMAGE2_MUXER) += fate-filter-reinit-in-place
+fate-filter-reinit-in-place: CMD = filter_reinit "trim=end_frame=7,hflip,scale=176:144"
+
+FATE_FILTER-$(call ALLYES, HFLIP_FILTER VFLIP_FILTER SCALE_FILTER CROP_FILTER) += fate-filter-reconfigure
+fate-filter-reconfigure: libavfilter/tests/reconfigure$(EXESUF)
+fate-filter-reconfigure: CMD = run libavfilter/tests/reconfigure$(EXESUF)
+
 
 tests/pixfmts.mak: TAG = GEN
 tests/pixfmts.mak: ffmpeg$(PROGSSUF)$(EXESUF) | tests
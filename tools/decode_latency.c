@@ -0,0 +1,261 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Measure decoder latency and throughput on a send_packet/receive_frame
+ * cadence, e.g. to compare frame_thread_delay settings:
+ *
+ *   decode_latency input.mkv 0 8 frame -1
+ *   decode_latency input.mkv 0 8 frame 1
+ *
+ * With realtime set to 1, the packets are sent at the pace given by their
+ * timestamps, as they would arrive from a live source, instead of as fast
+ * as the decoder accepts them.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "libavutil/common.h"
+#include "libavutil/dict.h"
+#include "libavutil/error.h"
+#include "libavutil/mathematics.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+
+#include "libavformat/avformat.h"
+
+#include "libavcodec/avcodec.h"
+
+typedef struct LatencyStats {
+    int64_t *send_time;     ///< send time of each packet, indexed by packet number
+    int      nb_sent;
+    int      send_time_size;
+
+    int      nb_frames;
+    int      nb_measured;   ///< frames whose packet could be identified
+    int64_t  latency_sum;
+    int64_t  latency_max;
+} LatencyStats;
+
+static int record_send(LatencyStats *st, AVPacket *pkt)
+{
+    if (st->nb_sent >= st->send_time_size) {
+        int size = FFMAX(2 * st->send_time_size, 256);
+        int64_t *tmp = av_realloc_array(st->send_time, size, sizeof(*tmp));
+        if (!tmp)
+            return AVERROR(ENOMEM);
+        st->send_time      = tmp;
+        st->send_time_size = size;
+    }
+
+    /* tag the packet so the matching frame can be found after reordering */
+    pkt->pos = st->nb_sent;
+    st->send_time[st->nb_sent++] = av_gettime_relative();
+
+    return 0;
+}
+
+static int decode_read(AVCodecContext *decoder, AVFrame *frame, int flush,
+                       LatencyStats *st)
+{
+    const int ret_done = flush ? AVERROR_EOF : AVERROR(EAGAIN);
+    int ret;
+
+    while (1) {
+        int64_t latency;
+
+        ret = avcodec_receive_frame(decoder, frame);
+        if (ret < 0)
+            return (ret == ret_done) ? 0 : ret;
+
+        if (frame->pkt_pos >= 0 && frame->pkt_pos < st->nb_sent) {
+            latency = av_gettime_relative() - st->send_time[frame->pkt_pos];
+            st->latency_sum += latency;
+            st->latency_max  = FFMAX(st->latency_max, latency);
+            st->nb_measured++;
+        }
+        st->nb_frames++;
+
+        av_frame_unref(frame);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    AVFormatContext *demuxer = NULL;
+    AVCodecContext  *decoder = NULL;
+    const AVCodec   *codec;
+    AVDictionary    *opts = NULL;
+    LatencyStats     st   = { 0 };
+
+    AVPacket *pkt   = NULL;
+    AVFrame  *frame = NULL;
+
+    const char *filename, *nb_threads = "0", *thread_type = "frame", *delay = "-1";
+    int64_t start, elapsed, first_ts = AV_NOPTS_VALUE;
+    int stream_idx, realtime = 0, ret;
+    AVRational time_base;
+
+    if (argc <= 2) {
+        fprintf(stderr, "Usage: %s <input file> <stream index> [<thread count> <thread type> <frame thread delay> <realtime>]\n", argv[0]);
+        return 0;
+    }
+
+    filename   = argv[1];
+    stream_idx = strtol(argv[2], NULL, 0);
+    if (argc > 3)
+        nb_threads  = argv[3];
+    if (argc > 4)
+        thread_type = argv[4];
+    if (argc > 5)
+        delay       = argv[5];
+    if (argc > 6)
+        realtime    = strtol(argv[6], NULL, 0);
+
+    ret  = av_dict_set(&opts, "threads",            nb_threads,  0);
+    ret |= av_dict_set(&opts, "thread_type",        thread_type, 0);
+    ret |= av_dict_set(&opts, "frame_thread_delay", delay,       0);
+    if (ret < 0)
+        goto finish;
+
+    ret = avformat_open_input(&demuxer, filename, NULL, NULL);
+    if (ret < 0) {
+        fprintf(stderr, "Error opening input file: %d\n", ret);
+        goto finish;
+    }
+
+    if (stream_idx < 0 || stream_idx >= demuxer->nb_streams) {
+        ret = AVERROR(EINVAL);
+        goto finish;
+    }
+
+    time_base = demuxer->streams[stream_idx]->time_base;
+
+    codec = avcodec_find_decoder(demuxer->streams[stream_idx]->codecpar->codec_id);
+    if (!codec) {
+        ret = AVERROR_DECODER_NOT_FOUND;
+        goto finish;
+    }
+
+    decoder = avcodec_alloc_context3(codec);
+    if (!decoder) {
+        ret = AVERROR(ENOMEM);
+        goto finish;
+    }
+
+    ret = avcodec_parameters_to_context(decoder, demuxer->streams[stream_idx]->codecpar);
+    if (ret < 0)
+        goto finish;
+
+    ret = avcodec_open2(decoder, NULL, &opts);
+    if (ret < 0) {
+        fprintf(stderr, "Error initializing decoder\n");
+        goto finish;
+    }
+
+    pkt   = av_packet_alloc();
+    frame = av_frame_alloc();
+    if (!pkt || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto finish;
+    }
+
+    start = av_gettime_relative();
+
+    while (ret >= 0) {
+        ret = av_read_frame(demuxer, pkt);
+        if (ret < 0)
+            break;
+        if (pkt->stream_index != stream_idx) {
+            av_packet_unref(pkt);
+            continue;
+        }
+
+        if (realtime) {
+            int64_t ts = pkt->dts != AV_NOPTS_VALUE ? pkt->dts : pkt->pts;
+
+            if (ts != AV_NOPTS_VALUE) {
+                int64_t due;
+
+                if (first_ts == AV_NOPTS_VALUE)
+                    first_ts = ts;
+                due = start + av_rescale_q(ts - first_ts, time_base, AV_TIME_BASE_Q);
+                /* collect the frames finished while waiting for the packet */
+                while (due > av_gettime_relative()) {
+                    ret = decode_read(decoder, frame, 0, &st);
+                    if (ret < 0) {
+                        fprintf(stderr, "Error decoding: %d\n", ret);
+                        goto finish;
+                    }
+                    av_usleep(FFMIN(due - av_gettime_relative(), 1000));
+                }
+            }
+        }
+
+        ret = record_send(&st, pkt);
+        if (ret < 0)
+            goto finish;
+
+        ret = avcodec_send_packet(decoder, pkt);
+        av_packet_unref(pkt);
+        if (ret < 0) {
+            fprintf(stderr, "Error decoding: %d\n", ret);
+            goto finish;
+        }
+
+        ret = decode_read(decoder, frame, 0, &st);
+        if (ret < 0) {
+            fprintf(stderr, "Error decoding: %d\n", ret);
+            goto finish;
+        }
+    }
+
+    avcodec_send_packet(decoder, NULL);
+    ret = decode_read(decoder, frame, 1, &st);
+    if (ret < 0) {
+        fprintf(stderr, "Error flushing: %d\n", ret);
+        goto finish;
+    }
+
+    elapsed = FFMAX(av_gettime_relative() - start, 1);
+
+    printf("threads %d (%s), frame_thread_delay %s%s\n",
+           decoder->thread_count,
+           decoder->active_thread_type == FF_THREAD_FRAME ? "frame" :
+           decoder->active_thread_type == FF_THREAD_SLICE ? "slice" : "none",
+           delay, realtime ? ", realtime" : "");
+    printf("frames %d, time %.3f s, %.2f fps\n", st.nb_frames,
+           elapsed / 1000000.0, st.nb_frames * 1000000.0 / elapsed);
+    if (st.nb_measured)
+        printf("latency avg %.3f ms, max %.3f ms over %d frames\n",
+               st.latency_sum / 1000.0 / st.nb_measured, st.latency_max / 1000.0,
+               st.nb_measured);
+    ret = 0;
+
+finish:
+    av_dict_free(&opts);
+    av_packet_free(&pkt);
+    av_frame_free(&frame);
+    avcodec_free_context(&decoder);
+    avformat_close_input(&demuxer);
+    av_freep(&st.send_time);
+
+    return ret;
+}